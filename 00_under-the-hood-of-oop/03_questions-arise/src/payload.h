@@ -22,6 +22,25 @@ struct message_receiving_entity_vtable {
 	void (*destroy)(const struct message_receiving_entity *self);
 };
 
+/** @brief Receivers stored without allocating, see receiver_list.h. */
+#define INLINE_RECEIVERS 4
+
+/**
+ * @brief Growable array of receivers, whose first few live inline.
+ *
+ * There is no pointer to the inline items, since payloads are copied around
+ * by value. The capacity tells where the receivers are.
+ */
+struct receiver_list {
+	int count;
+	int cap;  /**< INLINE_RECEIVERS while inline */
+
+	union {
+		struct message_receiving_entity *heap;
+		struct message_receiving_entity inline_items[INLINE_RECEIVERS];
+	};
+};
+
 union payload_data {
 	struct {
 		char *username;
@@ -33,9 +52,8 @@ union payload_data {
 	} command_join;
 
 	struct {
-		struct message_receiving_entity *receivers;
+		struct receiver_list receivers;
 		char *content;
-		int receiver_count;
 	} message;
 };
 
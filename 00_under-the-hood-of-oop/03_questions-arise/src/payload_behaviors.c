@@ -1,6 +1,7 @@
 // "behavioral" functions
 
 #include "payload.h"
+#include "receiver_list.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,10 +30,10 @@ void process_command_logout([[maybe_unused]] const struct payload *self)
 
 void process_message(const struct payload *self)
 {
-	struct message_receiving_entity *receivers = \
-		self->data.message.receivers;
+	const struct message_receiving_entity *receivers = \
+		receiver_list_const_data(&self->data.message.receivers);
 
-	for (int i = 0; i < self->data.message.receiver_count; i++)
+	for (int i = 0; i < self->data.message.receivers.count; i++)
 		receivers[i].vtable->transmit_message(&receivers[i],
 						      self->data.message.content);
 }
@@ -72,14 +73,14 @@ void destroy_command_logout([[maybe_unused]] const struct payload *self)
 
 void destroy_message(const struct payload *self)
 {
-	struct message_receiving_entity *receivers = \
-		self->data.message.receivers;
+	const struct message_receiving_entity *receivers = \
+		receiver_list_const_data(&self->data.message.receivers);
 
-	for (int i = 0; i < self->data.message.receiver_count; i++)
+	for (int i = 0; i < self->data.message.receivers.count; i++)
 		receivers[i].vtable->destroy(&receivers[i]);
 
 	free(self->data.message.content);
-	free(receivers);
+	receiver_list_destroy(&self->data.message.receivers);
 }
 
 void destroy_global_message([[maybe_unused]] const struct message_receiving_entity *self)
@@ -12,6 +12,7 @@
 // parsers (http://github.com/metwse/rdesc)
 
 #include "payload.h"
+#include "receiver_list.h"
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -48,10 +49,9 @@ static void message_constructor(struct payload *p, const char *raw)
 	// They can be direct (@user), group (#channel), or global (no prefix)
 	// Each receiver knows how to transmit and destroy itself shorthand
 	// variable for receivers field
-	struct message_receiving_entity *receivers;
-	assert((receivers = malloc(sizeof(struct message_receiving_entity))));
+	struct receiver_list *receivers = &p->data.message.receivers;
 
-	int receiver_count = 0;
+	receiver_list_init(receivers);
 
 	int content_offset = 0;
 	while (raw[content_offset] == '@' || raw[content_offset] == '#') {
@@ -69,28 +69,21 @@ static void message_constructor(struct payload *p, const char *raw)
 
 		receiver_name[name_end - content_offset - 1] = '\0';
 
-		if (receiver_count >= 1) {
-			assert((receivers = realloc(receivers,
-				sizeof(struct message_receiving_entity) *
-			        (receiver_count + 1))));
-		}
-
-		receivers[receiver_count] = (struct message_receiving_entity) {
+		receiver_list_push(receivers, (struct message_receiving_entity) {
 			.additional_info = receiver_name,
 			.vtable = \
 				raw[content_offset] == '@' ?
 				&direct_message_vtable : &group_message_vtable,
-		};
-
-		receiver_count++;
+		});
 
 		content_offset = name_end + 1;
 	}
 
 	// fallback to global message if no receiver found
 	if (content_offset == 0) {
-		receivers->vtable = &global_message_vtable;
-		receiver_count = 1;
+		receiver_list_push(receivers, (struct message_receiving_entity) {
+			.vtable = &global_message_vtable,
+		});
 	};
 
 
@@ -98,8 +91,6 @@ static void message_constructor(struct payload *p, const char *raw)
 		malloc(sizeof(char) * (strlen(raw) - content_offset + 1))));
 
 	strcpy(p->data.message.content, raw + content_offset);
-	p->data.message.receivers = receivers;
-	p->data.message.receiver_count = receiver_count;
 }
 
 bool parse_payload(struct payload *p, const char *raw)
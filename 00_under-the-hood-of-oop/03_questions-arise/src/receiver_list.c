@@ -0,0 +1,48 @@
+#include "receiver_list.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void receiver_list_init(struct receiver_list *list)
+{
+	list->count = 0;
+	list->cap = INLINE_RECEIVERS;
+}
+
+void receiver_list_push(struct receiver_list *list,
+			struct message_receiving_entity receiver)
+{
+	if (list->count == list->cap) {
+		// doubling keeps the number of reallocations logarithmic, a
+		// 20 receiver message moves its receivers 3 times, not 20
+		int cap = list->cap * 2;
+
+		if (list->cap == INLINE_RECEIVERS) {
+			struct message_receiving_entity *heap =
+				malloc(sizeof(struct message_receiving_entity) *
+				       cap);
+			assert(heap);
+
+			memcpy(heap, list->inline_items,
+			       sizeof(struct message_receiving_entity) *
+			       list->count);
+			list->heap = heap;
+		} else {
+			assert((list->heap = realloc(list->heap,
+				sizeof(struct message_receiving_entity) *
+				cap)));
+		}
+
+		list->cap = cap;
+	}
+
+	receiver_list_data(list)[list->count++] = receiver;
+}
+
+void receiver_list_destroy(const struct receiver_list *list)
+{
+	if (list->cap > INLINE_RECEIVERS)
+		free(list->heap);
+}
@@ -0,0 +1,56 @@
+/**
+ * @file receiver_list.h
+ * @brief Methods of struct receiver_list, see payload.h.
+ *
+ * Nearly every message has a single receiver. Up to INLINE_RECEIVERS of them
+ * are stored inside the list itself, i.e. inside the payload, without any
+ * allocation. Beyond that, receivers move to the heap, and the capacity
+ * doubles every time it is exceeded.
+ */
+
+#ifndef RECEIVER_LIST_H
+#define RECEIVER_LIST_H
+
+
+#include "payload.h"
+
+
+/**
+ * @brief Initializes an empty list, stored inline.
+ */
+void receiver_list_init(struct receiver_list *list);
+
+/**
+ * @brief Appends a receiver, copied into the list.
+ *
+ * Amortized O(1): the heap array is only reallocated when full, to twice its
+ * capacity.
+ */
+void receiver_list_push(struct receiver_list *list,
+			struct message_receiving_entity receiver);
+
+/**
+ * @brief First receiver of the list, the others follow it.
+ *
+ * The pointer is invalidated by receiver_list_push(), and by copying the
+ * list while it is inline.
+ */
+static inline struct message_receiving_entity *
+receiver_list_data(struct receiver_list *list)
+{
+	return list->cap > INLINE_RECEIVERS ? list->heap : list->inline_items;
+}
+
+static inline const struct message_receiving_entity *
+receiver_list_const_data(const struct receiver_list *list)
+{
+	return list->cap > INLINE_RECEIVERS ? list->heap : list->inline_items;
+}
+
+/**
+ * @brief Frees the heap array, if any. Receivers are not destroyed.
+ */
+void receiver_list_destroy(const struct receiver_list *list);
+
+
+#endif
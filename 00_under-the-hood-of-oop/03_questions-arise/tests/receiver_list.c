@@ -0,0 +1,81 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/payload.h"
+#include "../src/receiver_list.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void test_inline_then_heap()
+{
+	struct receiver_list list;
+	char names[20][8];
+
+	receiver_list_init(&list);
+
+	for (int i = 0; i < 20; i++) {
+		sprintf(names[i], "user%d", i);
+		receiver_list_push(&list, (struct message_receiving_entity) {
+			.vtable = &direct_message_vtable,
+			.additional_info = names[i],
+		});
+
+		// inline until full, then doubling
+		if (i < INLINE_RECEIVERS)
+			assert(list.cap == INLINE_RECEIVERS);
+	}
+
+	assert(list.count == 20 && list.cap == 32);
+
+	for (int i = 0; i < 20; i++)
+		assert(receiver_list_data(&list)[i].additional_info == names[i]);
+
+	receiver_list_destroy(&list);
+}
+
+static void test_payloads_copy_inline_receivers()
+{
+	struct payload_buffer *buf = new_buffer();
+	char raw[256] = "";
+
+	push_payload(buf, "@alice @bob #general hi");
+
+	for (int i = 0; i < 20; i++)
+		sprintf(raw + strlen(raw), "@user%d ", i);
+	strcat(raw, "hello everyone");
+
+	// the buffer grows and moves the first payload, with its receivers
+	push_payload(buf, raw);
+	push_payload(buf, "global message");
+
+	const struct receiver_list *first =
+		&buf->payloads[0].data.message.receivers;
+	const struct receiver_list *second =
+		&buf->payloads[1].data.message.receivers;
+	const struct receiver_list *third =
+		&buf->payloads[2].data.message.receivers;
+
+	assert(first->count == 3 && first->cap == INLINE_RECEIVERS);
+	assert(strcmp(receiver_list_const_data(first)[2].additional_info,
+		      "general") == 0);
+
+	assert(second->count == 20);
+	assert(strcmp(receiver_list_const_data(second)[19].additional_info,
+		      "user19") == 0);
+
+	assert(third->count == 1);
+	assert(receiver_list_const_data(third)->vtable ==
+	       &global_message_vtable);
+
+	destroy(buf);
+}
+
+int main()
+{
+	test_inline_then_heap();
+	test_payloads_copy_inline_receivers();
+
+	return EXIT_SUCCESS;
+}
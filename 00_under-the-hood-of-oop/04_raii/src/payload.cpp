@@ -3,25 +3,25 @@
 #include <cstring>
 #include <iostream>
 
-using std::cout, std::endl;
+using std::cout;
 
 
 void LoginCommand::process() {
     cout << "Command: login\n  Arguments: [username: " << username
-         << ", password:" << password << "]" << endl;
+         << ", password:" << password << "]\n";
 }
 
 void JoinCommand::process() {
-    cout << "Command: join\n  Arguments: [channel: " << channel << "]" << endl;
+    cout << "Command: join\n  Arguments: [channel: " << channel << "]\n";
 }
 
 void LogoutCommand::process() {
-    cout << "Command: logout\n  Arguments: []" << endl;
+    cout << "Command: logout\n  Arguments: []\n";
 }
 
 void handle_command_payload(char *raw) {
     if (raw[0] != '/') {
-        cout << "Skipping non-command" << endl;
+        cout << "Skipping non-command\n";
     }
 
     raw += 1;
@@ -44,7 +44,7 @@ void handle_command_payload(char *raw) {
         LogoutCommand cmd;
         cmd.process();
     } else {
-        cout << "Unknown command!" << endl;
+        cout << "Unknown command!\n";
     }
 
     cout << "\n";
@@ -2,25 +2,131 @@
 
 #include <cstring>
 #include <iostream>
+#include <new>
 
-using std::ostream, std::cout, std::endl;
+using std::ostream, std::cout, std::endl, std::atomic;
 
 
 String::String(const char *str) {
-    data = new char[strlen(str) + 1];
-    strcpy(data, str);
+    assign(str, strlen(str));
 
-    cout << "String created: " << data << endl;
+    cout << "String created: " << *this << endl;
+}
+
+String String::shared(const char *str) {
+    String string;
+    size_t str_length = strlen(str);
+
+    if (str_length <= INLINE_CAPACITY) {
+        string.assign(str, str_length);
+    } else {
+        // the counter first, then the characters, in one allocation
+        char *block = new char[sizeof(atomic<size_t>) + str_length + 1];
+
+        string.length = str_length;
+        string.heap.refs = new (block) atomic<size_t> { 1 };
+        string.heap.chars = block + sizeof(atomic<size_t>);
+
+        memcpy(string.heap.chars, str, str_length + 1);
+    }
+
+    cout << "String created: " << string << endl;
+
+    return string;
+}
+
+String::String(const String &other) {
+    share(other);
+
+    cout << "String copied: " << *this << endl;
+}
+
+String &String::operator=(const String &other) {
+    if (this != &other) {
+        release();
+        share(other);
+    }
+
+    return *this;
+}
+
+String::String(String &&other) noexcept {
+    steal(other);
+
+    cout << "String moved: " << *this << endl;
+}
+
+String &String::operator=(String &&other) noexcept {
+    if (this != &other) {
+        release();
+        steal(other);
+    }
+
+    return *this;
 }
 
 String::~String() {
-    cout << "String destroyed: " << data << endl;
+    cout << "String destroyed: " << *this << endl;
+
+    release();
+}
+
+void String::assign(const char *str, size_t str_length) {
+    length = str_length;
+
+    char *dest = local;
+
+    if (!is_inline()) {
+        dest = heap.chars = new char[length + 1];
+        heap.refs = nullptr;
+    }
+
+    memcpy(dest, str, length);
+    dest[length] = '\0';
+}
+
+void String::share(const String &other) {
+    if (!other.is_shared()) {
+        // the length is known, no need to strlen again
+        assign(other.data(), other.length);
+
+        return;
+    }
+
+    // nobody writes to the characters, only the counter changes
+    other.heap.refs->fetch_add(1, std::memory_order_relaxed);
+
+    length = other.length;
+    heap = other.heap;
+}
+
+void String::steal(String &other) {
+    length = other.length;
+
+    if (is_inline())
+        memcpy(local, other.local, length + 1);
+    else
+        heap = other.heap;
+
+    other.length = 0;
+    other.local[0] = '\0';
+}
+
+void String::release() {
+    if (is_inline())
+        return;
 
-    delete[] data;
+    if (heap.refs == nullptr) {
+        delete[] heap.chars;
+    } else if (heap.refs->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // last owner, the counter lives at the start of the block
+        heap.refs->~atomic();
+        delete[] reinterpret_cast<char *>(heap.refs);
+    }
 }
 
 ostream &operator<<(ostream &os, const String &string) {
-    os << string.data;
+    os.write(string.data(), string.length);
 
     return os;
 }
@@ -7,14 +7,25 @@
 #define STRING_HPP
 
 
+#include <atomic>
+#include <cstddef>
 #include <ostream>
 
 
 /**
  * @brief Custom string class implementation as a RAII example.
+ *
+ * Short strings, up to INLINE_CAPACITY characters, are stored inside the
+ * object itself (small-string optimization). Only longer ones allocate.
+ *
+ * A long string made by String::shared() is immutable, and its characters
+ * are shared by all its copies, with a reference count.
  */
 class String {
 public:
+    /** @brief Longest string stored without allocating. */
+    static constexpr size_t INLINE_CAPACITY = 15;
+
     /**
      * @brief Construct String from str literal.
      *
@@ -22,8 +33,40 @@ public:
      */
     String(const char *str);
 
+    /**
+     * @brief Construct a String whose copies share its characters.
+     *
+     * Copying it only increments a counter, the last copy destroyed frees
+     * the characters. Short strings are inline, and copied as usual.
+     */
+    static String shared(const char *str);
+
+    /** @brief Deep copy, see chapter 06. Shared strings are not copied. */
+    String(const String &other);
+
+    String &operator=(const String &other);
+
+    /**
+     * @brief Takes the characters of other, without copying them.
+     *
+     * other is left empty. noexcept, so that std::vector moves its elements
+     * instead of copying them when it grows.
+     */
+    String(String &&other) noexcept;
+
+    String &operator=(String &&other) noexcept;
+
     ~String();
 
+    /** @brief Number of characters, without the null terminator. */
+    size_t size() const { return length; }
+
+    /** @brief Whether the characters live inside the object. */
+    bool is_inline() const { return length <= INLINE_CAPACITY; }
+
+    /** @brief Whether the characters are shared with other Strings. */
+    bool is_shared() const { return !is_inline() && heap.refs != nullptr; }
+
 private:
     // We will discuss operator overloading in detail. Here is a quick
     // reference if you want to be familiar with it beforehand:
@@ -36,7 +79,28 @@ private:
     friend std::ostream& operator<<(std::ostream& stream,
                                     const String& matrix);
 
-    char *data;
+    String() : length { 0 }, local { '\0' } {}
+
+    const char *data() const { return is_inline() ? local : heap.chars; }
+
+    // copies length characters of str, and a null terminator
+    void assign(const char *str, size_t str_length);
+    void share(const String &other);
+    void steal(String &other);
+    void release();
+
+    size_t length;
+
+    // the length tells which member is in use
+    union {
+        struct {
+            char *chars;
+            // null if the characters are ours alone, otherwise the number
+            // of Strings sharing them, stored in the same block
+            std::atomic<size_t> *refs;
+        } heap;
+        char local[INLINE_CAPACITY + 1];
+    };
 };
 
 
@@ -1,8 +1,170 @@
 #include "../src/string.hpp"
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <sstream>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-using std::cout, std::endl;
+using std::cout, std::endl, std::ostringstream, std::vector;
+
+
+// every new/new[] of the program goes through here. The array and sized
+// overloads forward to the two plain ones, which are never inlined: GCC
+// must see operator new paired with operator delete at every call site,
+// not malloc() on one side and operator delete on the other, or it warns
+// about a mismatch (-Wmismatched-new-delete) depending on what it inlines.
+static size_t allocations = 0;
+
+[[gnu::noinline]] void *operator new(size_t size) {
+    allocations++;
+
+    void *ptr = malloc(size);
+
+    if (ptr == nullptr)
+        throw std::bad_alloc {};
+
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, [[maybe_unused]] size_t size) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void *ptr, [[maybe_unused]] size_t size) noexcept {
+    operator delete(ptr);
+}
+
+
+static void test_short_strings_do_not_allocate() {
+    size_t before = allocations;
+
+    String empty { "" };
+    String username { "alice" };
+    String longest { "exactly15chars!" };
+
+    assert(allocations == before);
+    assert(empty.is_inline() && empty.size() == 0);
+    assert(username.is_inline() && username.size() == 5);
+    assert(longest.is_inline() && longest.size() == String::INLINE_CAPACITY);
+}
+
+static void test_long_strings_allocate_once() {
+    size_t before = allocations;
+
+    String content { "sixteen chars!!!" };
+
+    assert(allocations == before + 1);
+    assert(!content.is_inline() && content.size() == 16);
+}
+
+static void test_copies() {
+    String short_str { "bob" };
+    String long_str { "a message longer than the inline buffer" };
+
+    size_t before = allocations;
+    String short_copy = short_str;
+    String long_copy = long_str;
+
+    assert(allocations == before + 1);
+
+    // long to short, short to long, and to itself
+    long_copy = short_copy;
+    short_copy = long_str;
+    short_copy = short_copy;
+
+    ostringstream os;
+    os << long_copy << "|" << short_copy;
+
+    assert(os.str() == "bob|a message longer than the inline buffer");
+}
+
+static void test_print_uses_length() {
+    ostringstream os;
+    os << String { "hi" } << String { "there, a long enough string" };
+
+    assert(os.str() == "hithere, a long enough string");
+}
+
+static void test_moves_do_not_allocate() {
+    static_assert(std::is_nothrow_move_constructible_v<String>);
+    static_assert(std::is_nothrow_move_assignable_v<String>);
+
+    String short_str { "carol" };
+    String long_str { "a message longer than the inline buffer" };
+
+    size_t before = allocations;
+    String short_moved = std::move(short_str);
+    String long_moved = std::move(long_str);
+
+    assert(allocations == before);
+    assert(short_str.size() == 0 && long_str.size() == 0);
+
+    long_str = std::move(long_moved);
+    long_str = std::move(long_str);
+
+    ostringstream os;
+    os << short_moved << "|" << long_str << "|" << long_moved;
+
+    assert(os.str() == "carol|a message longer than the inline buffer|");
+}
+
+static void test_vector_growth_moves() {
+    vector<String> strings;
+    size_t before = allocations;
+
+    for (int i = 0; i < 100; i++)
+        strings.emplace_back("a message longer than the inline buffer");
+
+    // one per String, and one per growth of the vector: none per move
+    size_t growths = allocations - before - 100;
+
+    assert(growths <= 8);
+}
+
+static void test_shared_copies() {
+    String shared = String::shared("a message fanned out to every receiver");
+
+    assert(shared.is_shared());
+
+    size_t before = allocations;
+    vector<String> receivers(10, shared);
+
+    assert(allocations == before + 1);  // the vector itself
+
+    for (const String &receiver : receivers) {
+        ostringstream os;
+        os << receiver;
+
+        assert(receiver.is_shared());
+        assert(os.str() == "a message fanned out to every receiver");
+    }
+
+    // the characters outlive the original, until the last copy is gone
+    shared = String { "short" };
+    receivers.erase(receivers.begin() + 1, receivers.end());
+
+    ostringstream os;
+    os << receivers[0] << "|" << shared;
+
+    assert(os.str() == "a message fanned out to every receiver|short");
+    assert(!String::shared("short").is_shared());
+}
 
 
 int main() {
@@ -10,4 +172,14 @@ int main() {
     String str2 = String("World!");
 
     cout << "Values of strings:\n1. " << str1 << "\n" << "2. " << str2 << endl;
+
+    test_short_strings_do_not_allocate();
+    test_long_strings_allocate_once();
+    test_copies();
+    test_print_uses_length();
+    test_moves_do_not_allocate();
+    test_vector_growth_moves();
+    test_shared_copies();
+
+    return EXIT_SUCCESS;
 }
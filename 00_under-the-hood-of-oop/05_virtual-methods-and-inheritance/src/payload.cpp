@@ -2,31 +2,31 @@
 
 #include <iostream>
 
-using std::cout, std::endl;
+using std::cout;
 
 
 void Command::process() {
-    cout << "Command: " << command_name << endl;
+    cout << "Command: " << command_name << "\n";
     process_arguments();
 }
 
 void LoginCommand::process_arguments() {
     cout << "  Arguments: [username: " << username
-        << ", password: " << password << "]" << endl;
+        << ", password: " << password << "]\n";
 }
 
 void JoinCommand::process_arguments() {
-    cout << "  Arguments: [channel: " << channel << "]" << endl;
+    cout << "  Arguments: [channel: " << channel << "]\n";
 }
 
 void LogoutCommand::process_arguments() {
-    cout << "  Arguments: []" << endl;
+    cout << "  Arguments: []\n";
 }
 
 
 void Message::process() {
     process_recipient();
-    cout << content << endl;
+    cout << content << "\n";
 }
 
 void DirectMessage::process_recipient() {
@@ -0,0 +1,52 @@
+#include "dynamic_dispatch.h"
+#include "mapped_file.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+int main(int argc, const char **args)
+{
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <payloads file>\n", args[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	struct mapped_file file;
+
+	if (!map_file(&file, args[1])) {
+		fprintf(stderr, "Could not open %s.\n", args[1]);
+
+		return EXIT_FAILURE;
+	}
+
+	struct payload_buffer *buf = new_buffer();
+	struct line_view line;
+
+	printf("--- Reading payloads ---\n");
+	while (next_line(&file, &line)) {
+		if (line.len == 0)
+			continue;
+
+		// line points into the mapping, nothing is copied until
+		// parse_payload extracts the fields
+		push_payload(buf, line.ptr, line.len);
+	}
+	printf("Read %zu payloads\n\n", buf->len);
+
+	unmap_file(&file);
+
+	printf("--- Processing payloads ---\n");
+	for (size_t i = 0; i < buf->len; i++) {
+		printf("Processing payload %zu of %zu\n", i + 1, buf->len);
+
+		process_next(buf);
+
+		printf("\n");
+	}
+
+	destroy(buf);
+
+	return EXIT_SUCCESS;
+}
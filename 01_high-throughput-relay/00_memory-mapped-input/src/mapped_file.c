@@ -0,0 +1,78 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+bool map_file(struct mapped_file *f, const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return false;
+	}
+
+	*f = (struct mapped_file) {
+		.data = NULL,
+		.size = st.st_size,
+		.cursor = 0,
+	};
+
+	// mmap refuses zero-length mappings, an empty file simply has no lines
+	if (f->size > 0) {
+		void *data = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data == MAP_FAILED) {
+			close(fd);
+			return false;
+		}
+
+		madvise(data, f->size, MADV_SEQUENTIAL);
+		f->data = data;
+	}
+
+	// the mapping keeps its own reference to the file
+	close(fd);
+
+	return true;
+}
+
+bool next_line(struct mapped_file *f, struct line_view *line)
+{
+	if (f->cursor >= f->size)
+		return false;
+
+	const char *start = f->data + f->cursor;
+	size_t remaining = f->size - f->cursor;
+	const char *newline = memchr(start, '\n', remaining);
+
+	if (newline == NULL) {
+		// last line, without a trailing newline
+		*line = (struct line_view) { .ptr = start, .len = remaining };
+		f->cursor = f->size;
+	} else {
+		*line = (struct line_view) {
+			.ptr = start,
+			.len = newline - start
+		};
+		f->cursor += line->len + 1;
+	}
+
+	return true;
+}
+
+void unmap_file(struct mapped_file *f)
+{
+	if (f->data != NULL)
+		munmap((void *) f->data, f->size);
+
+	f->data = NULL;
+	f->size = f->cursor = 0;
+}
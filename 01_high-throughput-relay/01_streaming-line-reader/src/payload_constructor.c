@@ -0,0 +1,166 @@
+// Main method in ths file, parse_payload, gets unstructured input (text),
+// parses it into "struct payload". It sets appropriate function pointers.
+//
+// It is hard to write a clean parser with standard C. Parsing of unstructured
+// text input requires lots of edge case/error checking. We shall use external
+// libraries to handle that complexity - actually this approach just transfers
+// complexity into the library's code, e.g. maintained by specialized
+// open-source communities who have already navigated the minefield of
+// edge-case handling, and memory safety.
+//
+// In later chapters, we will use external dependencies to write more clean
+// parsers (http://github.com/metwse/rdesc)
+
+#include "payload.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+
+/* extract string until the next space, reading at most len characters */
+static char *extract_token(const char *raw, size_t len)
+{
+	const char *space = memchr(raw, ' ', len);
+	size_t end = space == NULL ? len : (size_t) (space - raw);
+	char *token;
+
+	if (end == 0) {
+		return NULL;
+	} else {
+		token = malloc(sizeof(char) * (end + 1));
+		assert(token);
+
+		memcpy(token, raw, end);
+		token[end] = '\0';
+
+		return token;
+	}
+}
+
+/* part of the line after the first offset characters */
+static size_t remaining(size_t len, size_t offset)
+{
+	return len > offset ? len - offset : 0;
+}
+
+static void message_constructor(struct payload *p, const char *raw, size_t len)
+{
+	p->vtable = &message_vtable;
+
+	// Nested polymorphism: each receiver is polymorphic!
+	// They can be direct (@user), group (#channel), or global (no prefix)
+	// Each receiver knows how to transmit and destroy itself shorthand
+	// variable for receivers field
+	struct message_receiving_entity *receivers;
+	assert((receivers = malloc(sizeof(struct message_receiving_entity))));
+
+	int receiver_count = 0;
+
+	size_t content_offset = 0;
+	while (content_offset < len &&
+	       (raw[content_offset] == '@' || raw[content_offset] == '#')) {
+		const char *name_end = memchr(raw + content_offset, ' ',
+					      len - content_offset);
+		// assuming all payloads are valid (all of the payloads have
+		// message content)
+		assert(name_end);
+
+		size_t name_len = name_end - (raw + content_offset) - 1;
+		char *receiver_name = malloc(sizeof(char) * (name_len + 1));
+		assert(receiver_name);
+
+		memcpy(receiver_name, raw + content_offset + 1, name_len);
+		receiver_name[name_len] = '\0';
+
+		if (receiver_count >= 1) {
+			assert((receivers = realloc(receivers,
+				sizeof(struct message_receiving_entity) *
+			        (receiver_count + 1))));
+		}
+
+		receivers[receiver_count] = (struct message_receiving_entity) {
+			.additional_info = receiver_name,
+			.vtable = \
+				raw[content_offset] == '@' ?
+				&direct_message_vtable : &group_message_vtable,
+		};
+
+		receiver_count++;
+
+		content_offset += name_len + 2;
+	}
+
+	// fallback to global message if no receiver found
+	if (content_offset == 0) {
+		receivers->vtable = &global_message_vtable;
+		receiver_count = 1;
+	};
+
+	size_t content_len = len - content_offset;
+
+	assert((p->data.message.content =
+		malloc(sizeof(char) * (content_len + 1))));
+
+	memcpy(p->data.message.content, raw + content_offset, content_len);
+	p->data.message.content[content_len] = '\0';
+	p->data.message.receivers = receivers;
+	p->data.message.receiver_count = receiver_count;
+}
+
+bool parse_payload(struct payload *p, const char *raw, size_t len)
+{
+	// PAIN, but separated
+	if (raw[0] == '/') {
+		char command_name[7];
+
+		size_t i;
+
+		for (i = 0; i < 6 && i + 1 < len && raw[i + 1] != ' '; i++)
+			command_name[i] = raw[i + 1];
+
+		command_name[i] = '\0';
+
+		if (strcmp("login", command_name) == 0) {
+			char *username, *password;
+			assert((username = extract_token(raw + 7,
+							 remaining(len, 7))));
+
+			size_t password_offset = strlen(username) + 8;
+			assert((password = extract_token(raw + password_offset,
+				remaining(len, password_offset))));
+
+			*p = (struct payload) {
+				.vtable = &command_login_vtable,
+				.data.command_login = {
+					.username = username,
+					.password = password
+				}
+			};
+		} else if (strcmp("join", command_name) == 0) {
+			char *channel;
+			assert((channel = extract_token(raw + 6,
+							remaining(len, 6))));
+
+			*p = (struct payload) {
+				.vtable = &command_join_vtable,
+				.data.command_join = {
+					.channel = channel,
+				}
+			};
+		} else if (strcmp("logout", command_name) == 0) {
+			*p = (struct payload) {
+				.vtable = &command_logout_vtable
+			};
+		} else {
+			printf("Ignoring invalid command %s\n", command_name);
+			return false;
+		}
+	} else {
+		message_constructor(p, raw, len);
+	}
+
+	return true;
+}
@@ -0,0 +1,57 @@
+#include "../src/line_reader.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static void assert_line(struct line_reader *r, const char *expected)
+{
+	struct line_view line;
+
+	assert(read_line(r, &line));
+	assert(line.len == strlen(expected));
+	assert(memcmp(line.ptr, expected, line.len) == 0);
+}
+
+int main()
+{
+	const char *lines[] = {
+		"/login metw pass",
+		"",
+		"@alice @bob a line that is much longer than the chunk",
+		"#general",
+		"x",
+	};
+
+	int fds[2];
+	assert(pipe(fds) == 0);
+
+	for (size_t i = 0; i < sizeof(lines) / sizeof(char *); i++) {
+		assert(write(fds[1], lines[i], strlen(lines[i])) ==
+		       (ssize_t) strlen(lines[i]));
+
+		// no trailing newline after the last line
+		if (i + 1 < sizeof(lines) / sizeof(char *))
+			assert(write(fds[1], "\n", 1) == 1);
+	}
+	close(fds[1]);
+
+	// tiny chunks, so that lines cross chunk boundaries and the buffer
+	// has to grow
+	struct line_reader r;
+	struct line_view line;
+	line_reader_init(&r, fds[0], 8);
+
+	for (size_t i = 0; i < sizeof(lines) / sizeof(char *); i++)
+		assert_line(&r, lines[i]);
+
+	assert(!read_line(&r, &line));
+	assert(!read_line(&r, &line));
+
+	line_reader_destroy(&r);
+	close(fds[0]);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file dynamic_dispatch.h
+ * @brief Payload buffer fed from a memory-mapped file.
+ */
+
+
+#ifndef DYNAMIC_DISPATCH_H
+#define DYNAMIC_DISPATCH_H
+
+
+#include <stddef.h>
+
+
+struct payload_buffer {
+	struct payload *payloads;
+	size_t len;
+	size_t cap;
+	size_t process_base;
+};
+
+
+struct payload_buffer *new_buffer();
+
+/**
+ * @brief Parses and adds a payload to the buffer.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param raw Line view, e.g. pointing into a mapped file
+ * @param len Length of the line, without the newline
+ */
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len);
+
+void process_next(struct payload_buffer *buf);
+
+void destroy(struct payload_buffer *buf);
+
+
+#endif
@@ -0,0 +1,142 @@
+#include "tokenizer.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+
+/* Every implementation returns a bitmask of the spaces in 32 characters of p,
+ * bit i being set if p[i] == ' '. */
+
+static uint32_t space_mask_scalar(const char *p)
+{
+	uint32_t mask = 0;
+
+	for (int i = 0; i < TOKENIZER_BLOCK_SIZE; i++)
+		mask |= (uint32_t) (p[i] == ' ') << i;
+
+	return mask;
+}
+
+#ifdef __x86_64__
+// SSE2 is part of x86-64, it is always available
+static uint32_t space_mask_sse2(const char *p)
+{
+	__m128i spaces = _mm_set1_epi8(' ');
+	__m128i low = _mm_loadu_si128((const __m128i *) p);
+	__m128i high = _mm_loadu_si128((const __m128i *) (p + 16));
+
+	uint32_t low_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(low, spaces));
+	uint32_t high_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(high, spaces));
+
+	return low_mask | high_mask << 16;
+}
+
+// compiled for AVX2 regardless of -march, only called if the CPU has it
+__attribute__((target("avx2")))
+static uint32_t space_mask_avx2(const char *p)
+{
+	__m256i block = _mm256_loadu_si256((const __m256i *) p);
+
+	return _mm256_movemask_epi8(_mm256_cmpeq_epi8(block,
+						      _mm256_set1_epi8(' ')));
+}
+#endif
+
+/* selected once at startup, before main runs */
+static uint32_t (*space_mask)(const char *p) = space_mask_scalar;
+static const char *implementation = "scalar";
+
+__attribute__((constructor))
+static void select_implementation()
+{
+#ifdef __x86_64__
+	/* constructors may run before libgcc has read cpuid itself */
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		space_mask = space_mask_avx2;
+		implementation = "avx2";
+	} else {
+		space_mask = space_mask_sse2;
+		implementation = "sse2";
+	}
+#endif
+}
+
+/* mask of a block, which may be shorter than 32 characters at the end */
+static uint32_t block_mask(const char *p, size_t len)
+{
+	if (len >= TOKENIZER_BLOCK_SIZE)
+		return space_mask(p);
+
+	// never read past the end of the line, it may be the end of a mapping
+	uint32_t mask = 0;
+	for (size_t i = 0; i < len; i++)
+		mask |= (uint32_t) (p[i] == ' ') << i;
+
+	return mask;
+}
+
+void tokenizer_init(struct tokenizer *t, const char *raw, size_t len)
+{
+	*t = (struct tokenizer) {
+		.raw = raw,
+		.len = len,
+		.pos = 0,
+		.block = 0,
+		.mask = block_mask(raw, len),
+	};
+}
+
+bool next_token(struct tokenizer *t, struct token *token)
+{
+	if (tokenizer_done(t))
+		return false;
+
+	size_t start = t->pos;
+
+	while (t->mask == 0) {
+		t->block += TOKENIZER_BLOCK_SIZE;
+
+		if (t->block >= t->len) {
+			// no spaces left, the token spans to the end of line
+			*token = (struct token) {
+				.ptr = t->raw + start,
+				.len = t->len - start
+			};
+			t->pos = t->len + 1;
+
+			return true;
+		}
+
+		t->mask = block_mask(t->raw + t->block, t->len - t->block);
+	}
+
+	size_t space = t->block + __builtin_ctz(t->mask);
+	t->mask &= t->mask - 1;  // consume the lowest space
+
+	*token = (struct token) { .ptr = t->raw + start, .len = space - start };
+	t->pos = space + 1;
+
+	return true;
+}
+
+size_t tokenize(const char *raw, size_t len, struct token *tokens,
+		size_t max_tokens)
+{
+	struct tokenizer t;
+	size_t count = 0;
+
+	tokenizer_init(&t, raw, len);
+
+	while (count < max_tokens && next_token(&t, &tokens[count]))
+		count++;
+
+	return count;
+}
+
+const char *tokenizer_implementation()
+{
+	return implementation;
+}
@@ -0,0 +1,61 @@
+#include "../src/tokenizer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* compares the tokenizer with a naive byte at a time split */
+static void assert_tokenizes(const char *raw, size_t len)
+{
+	struct tokenizer t;
+	struct token token;
+	size_t start = 0;
+
+	tokenizer_init(&t, raw, len);
+
+	for (size_t i = 0; i <= len; i++) {
+		if (i < len && raw[i] != ' ')
+			continue;
+
+		assert(next_token(&t, &token));
+		assert(token.ptr == raw + start);
+		assert(token.len == i - start);
+
+		start = i + 1;
+	}
+
+	assert(tokenizer_done(&t));
+	assert(!next_token(&t, &token));
+}
+
+int main()
+{
+	printf("Tokenizer implementation: %s\n", tokenizer_implementation());
+
+	assert_tokenizes("", 0);
+	assert_tokenizes(" ", 1);
+	assert_tokenizes("login metw password", 19);
+	assert_tokenizes("@alice  @bob #general hi ", 25);
+
+	// random lines of every length around block boundaries
+	char line[4 * TOKENIZER_BLOCK_SIZE + 1];
+	srand(42);
+
+	for (int round = 0; round < 1000; round++) {
+		size_t len = rand() % sizeof(line);
+
+		for (size_t i = 0; i < len; i++)
+			line[i] = rand() % 4 == 0 ? ' ' : 'a' + rand() % 26;
+
+		assert_tokenizes(line, len);
+	}
+
+	struct token tokens[2];
+	assert(tokenize("a b c", 5, tokens, 2) == 2);
+	assert(tokens[0].len == 1 && tokens[0].ptr[0] == 'a');
+	assert(tokens[1].len == 1 && tokens[1].ptr[0] == 'b');
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include "dynamic_dispatch.h"
+#include "payload.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+/* a chunk of copied lines, payloads point into data */
+struct input_block {
+	struct input_block *next;
+	size_t len;
+	size_t cap;
+	char data[];
+};
+
+struct payload_buffer *new_buffer()
+{
+	struct payload_buffer *buf = malloc(sizeof(struct payload_buffer));
+	assert(buf);
+
+	buf->process_base = buf->len = 0;
+	buf->cap = 1;
+	buf->payloads = malloc(sizeof(struct payload));
+	assert(buf->payloads);
+
+	buf->blocks = NULL;
+	buf->input = (struct mapped_file) { .data = NULL };
+
+	return buf;
+}
+
+static struct input_block *new_block(size_t cap)
+{
+	struct input_block *block = malloc(sizeof(struct input_block) +
+					   sizeof(char) * cap);
+	assert(block);
+
+	block->len = 0;
+	block->cap = cap;
+
+	return block;
+}
+
+/* copies a line into the block storage, allocating once per block */
+static const char *store_line(struct payload_buffer *buf, const char *raw,
+			      size_t len)
+{
+	struct input_block *block = buf->blocks;
+
+	if (len > INPUT_BLOCK_SIZE) {
+		// a huge line gets a block for itself, behind the block we are
+		// filling so that its free space is not wasted
+		block = new_block(len);
+
+		if (buf->blocks == NULL) {
+			block->next = NULL;
+			buf->blocks = block;
+		} else {
+			block->next = buf->blocks->next;
+			buf->blocks->next = block;
+		}
+	} else if (block == NULL || block->cap - block->len < len) {
+		block = new_block(INPUT_BLOCK_SIZE);
+		block->next = buf->blocks;
+		buf->blocks = block;
+	}
+
+	char *line = block->data + block->len;
+	memcpy(line, raw, len);
+	block->len += len;
+
+	return line;
+}
+
+void push_borrowed_payload(struct payload_buffer *buf, const char *raw,
+			   size_t len)
+{
+	struct payload parsed;
+
+	bool is_parsing_successful = parse_payload(&parsed, raw, len);
+
+	if (is_parsing_successful) {
+		if (buf->cap == buf->len) {
+			buf->cap *= 2;
+			buf->payloads = realloc(buf->payloads,
+			   buf->cap * sizeof(struct payload));
+
+			assert(buf->payloads);
+		}
+
+		buf->payloads[buf->len++] = parsed;
+	}
+}
+
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len)
+{
+	push_borrowed_payload(buf, store_line(buf, raw, len), len);
+}
+
+void own_mapping(struct payload_buffer *buf, const struct mapped_file *file)
+{
+	// one mapping per buffer is enough for reading a single file
+	assert(buf->input.data == NULL);
+
+	buf->input = *file;
+}
+
+void process_next(struct payload_buffer *buf)
+{
+	assert(buf->process_base < buf->len);
+
+	struct payload *p = &buf->payloads[buf->process_base];
+	p->vtable->process(p);
+
+	buf->process_base += 1;
+}
+
+void destroy(struct payload_buffer *buf)
+{
+	for (size_t i = 0; i < buf->len; i++) {
+		struct payload *p = &buf->payloads[i];
+		p->vtable->destroy(p);
+	}
+
+	// payloads are gone, the input they pointed into can be released
+	while (buf->blocks != NULL) {
+		struct input_block *next = buf->blocks->next;
+
+		free(buf->blocks);
+		buf->blocks = next;
+	}
+
+	unmap_file(&buf->input);
+
+	free(buf->payloads);
+	free(buf);
+}
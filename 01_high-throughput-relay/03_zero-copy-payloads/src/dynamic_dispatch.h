@@ -0,0 +1,75 @@
+/**
+ * @file dynamic_dispatch.h
+ * @brief Payload buffer that owns the input its payloads point into.
+ */
+
+
+#ifndef DYNAMIC_DISPATCH_H
+#define DYNAMIC_DISPATCH_H
+
+
+#include "mapped_file.h"
+
+#include <stddef.h>
+
+
+/** @brief Size of the blocks copied lines are stored in, 1 MiB. */
+#define INPUT_BLOCK_SIZE (1 << 20)
+
+struct input_block;
+
+struct payload_buffer {
+	struct payload *payloads;
+	size_t len;
+	size_t cap;
+	size_t process_base;
+
+	struct input_block *blocks;  /**< Storage for lines copied by
+				          push_payload() */
+	struct mapped_file input;    /**< Mapping owned by the buffer, see
+				          own_mapping() */
+};
+
+
+struct payload_buffer *new_buffer();
+
+/**
+ * @brief Copies the line into the buffer's storage, then parses it.
+ *
+ * Use this when raw is short-lived, e.g. it points into a line_reader. Lines
+ * are appended to large blocks, so there is no allocation per line.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param raw Line, not necessarily null-terminated
+ * @param len Length of the line, without the newline
+ */
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len);
+
+/**
+ * @brief Parses the line without copying it.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param raw Line that lives at least as long as buf, e.g. a line of a
+ *        mapping owned by buf
+ * @param len Length of the line, without the newline
+ */
+void push_borrowed_payload(struct payload_buffer *buf, const char *raw,
+			   size_t len);
+
+/**
+ * @brief Transfers ownership of a mapped file to the buffer.
+ *
+ * Lines of the mapping can then be pushed with push_borrowed_payload(). The
+ * file is unmapped by destroy().
+ *
+ * @param buf Pointer to the payload buffer
+ * @param file Mapped file, must not be unmapped by the caller anymore
+ */
+void own_mapping(struct payload_buffer *buf, const struct mapped_file *file);
+
+void process_next(struct payload_buffer *buf);
+
+void destroy(struct payload_buffer *buf);
+
+
+#endif
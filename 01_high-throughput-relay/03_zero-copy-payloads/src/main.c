@@ -0,0 +1,83 @@
+#include "dynamic_dispatch.h"
+#include "line_reader.h"
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* regular files are mapped as a whole, payloads point into the mapping */
+static void read_mapped(struct payload_buffer *buf, struct mapped_file *file)
+{
+	struct line_view line;
+
+	own_mapping(buf, file);
+
+	while (next_line(file, &line))
+		if (line.len > 0)
+			push_borrowed_payload(buf, line.ptr, line.len);
+}
+
+/* pipes, stdin and other streams are read chunk by chunk, the reader reuses
+ * its chunk so lines are copied into the payload buffer */
+static void read_stream(struct payload_buffer *buf, int fd)
+{
+	struct line_reader reader;
+	struct line_view line;
+
+	line_reader_init(&reader, fd, LINE_READER_CHUNK_SIZE);
+
+	while (read_line(&reader, &line))
+		if (line.len > 0)
+			push_payload(buf, line.ptr, line.len);
+
+	line_reader_destroy(&reader);
+}
+
+int main(int argc, const char **args)
+{
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <payloads file | ->\n", args[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	struct payload_buffer *buf = new_buffer();
+	struct mapped_file file;
+	int fd = STDIN_FILENO;
+
+	printf("--- Reading payloads ---\n");
+	if (strcmp(args[1], "-") != 0 && map_file(&file, args[1])) {
+		read_mapped(buf, &file);
+	} else {
+		if (strcmp(args[1], "-") != 0 &&
+		    (fd = open(args[1], O_RDONLY)) == -1) {
+			fprintf(stderr, "Could not open %s.\n", args[1]);
+			destroy(buf);
+
+			return EXIT_FAILURE;
+		}
+
+		read_stream(buf, fd);
+
+		if (fd != STDIN_FILENO)
+			close(fd);
+	}
+	printf("Read %zu payloads\n\n", buf->len);
+
+	printf("--- Processing payloads ---\n");
+	for (size_t i = 0; i < buf->len; i++) {
+		printf("Processing payload %zu of %zu\n", i + 1, buf->len);
+
+		process_next(buf);
+
+		printf("\n");
+	}
+
+	destroy(buf);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file payload.h
+ * @brief Payload methods.
+ *
+ * Payloads do not own their strings anymore. Every field is a span (offset +
+ * length) into the line the payload was parsed from, and that line is kept
+ * alive by the payload buffer.
+ */
+
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Part of a payload's line, relative to the start of the line.
+ *
+ * 32-bit offsets are plenty for a single line and keep a span as small as a
+ * pointer.
+ */
+struct span {
+	uint32_t offset;  /**< Offset of the first character in the line */
+	uint32_t len;     /**< Length, the span is not null-terminated */
+};
+
+/**
+ * @brief printf arguments for a span, use with "%.*s".
+ *
+ * printf("%.*s", SPAN_ARG(line, span));
+ */
+#define SPAN_ARG(line, span) (int) (span).len, (line) + (span).offset
+
+struct payload;
+
+struct message_receiving_entity {
+	const struct message_receiving_entity_vtable *vtable;
+	struct span additional_info;
+};
+
+struct message_receiving_entity_vtable {
+	void (*transmit_message)(const struct message_receiving_entity *self,
+				 const struct payload *message);
+	void (*destroy)(const struct message_receiving_entity *self);
+};
+
+union payload_data {
+	struct {
+		struct span username;
+		struct span password;
+	} command_login;
+
+	struct {
+		struct span channel;
+	} command_join;
+
+	struct {
+		struct message_receiving_entity *receivers;
+		struct span content;
+		int receiver_count;
+	} message;
+};
+
+struct payload {
+	const struct payload_vtable *vtable;
+	const char *line;  /**< Line every span points into, not owned */
+	union payload_data data;
+};
+
+struct payload_vtable {
+	void (*process)(const struct payload *self);
+	void (*destroy)(const struct payload *self);
+};
+
+
+/**
+ * @brief Constructor method sets up vtable and data fields of payloads.
+ *
+ * No string is copied, fields are spans into raw.
+ *
+ * @param p Output for parsed payload
+ * @param raw Raw payload, not necessarily null-terminated. It must outlive p.
+ * @param len Length of raw, without the trailing newline
+ */
+bool parse_payload(struct payload *p, const char *raw, size_t len);
+
+
+/* payload vtables */
+extern const struct payload_vtable command_login_vtable;
+extern const struct payload_vtable command_join_vtable;
+extern const struct payload_vtable command_logout_vtable;
+extern const struct payload_vtable message_vtable;
+
+/* receiver vtables */
+extern const struct message_receiving_entity_vtable direct_message_vtable;
+extern const struct message_receiving_entity_vtable group_message_vtable;
+extern const struct message_receiving_entity_vtable global_message_vtable;
+
+
+#endif
@@ -0,0 +1,126 @@
+// "behavioral" functions
+
+#include "payload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+void process_command_login(const struct payload *self)
+{
+	printf("Command: login\n"
+	       "  Arguments: [username: %.*s, password %.*s]\n",
+	       SPAN_ARG(self->line, self->data.command_login.username),
+	       SPAN_ARG(self->line, self->data.command_login.password));
+}
+
+void process_command_join(const struct payload *self)
+{
+	printf("Command: join\n"
+	       "  Arguments: [channel: %.*s]\n",
+	       SPAN_ARG(self->line, self->data.command_join.channel));
+}
+
+void process_command_logout([[maybe_unused]] const struct payload *self)
+{
+	printf("Command: logout\n"
+	       "  Arguments: []\n");
+}
+
+void process_message(const struct payload *self)
+{
+	struct message_receiving_entity *receivers = \
+		self->data.message.receivers;
+
+	for (int i = 0; i < self->data.message.receiver_count; i++)
+		receivers[i].vtable->transmit_message(&receivers[i], self);
+}
+
+void transmit_direct_message(const struct message_receiving_entity *self,
+			     const struct payload *message)
+{
+	printf("Direct message to %.*s: %.*s\n",
+	       SPAN_ARG(message->line, self->additional_info),
+	       SPAN_ARG(message->line, message->data.message.content));
+}
+
+void transmit_group_message(const struct message_receiving_entity *self,
+			    const struct payload *message)
+{
+	printf("Group message to %.*s: %.*s\n",
+	       SPAN_ARG(message->line, self->additional_info),
+	       SPAN_ARG(message->line, message->data.message.content));
+}
+
+void transmit_global_message([[maybe_unused]] const struct message_receiving_entity *self,
+			     const struct payload *message)
+{
+	printf("Global message: %.*s\n",
+	       SPAN_ARG(message->line, message->data.message.content));
+}
+
+
+// spans do not own anything, the line is released with the payload buffer
+void destroy_command_login([[maybe_unused]] const struct payload *self)
+{}
+
+void destroy_command_join([[maybe_unused]] const struct payload *self)
+{}
+
+void destroy_command_logout([[maybe_unused]] const struct payload *self)
+{}
+
+void destroy_message(const struct payload *self)
+{
+	struct message_receiving_entity *receivers = \
+		self->data.message.receivers;
+
+	for (int i = 0; i < self->data.message.receiver_count; i++)
+		receivers[i].vtable->destroy(&receivers[i]);
+
+	free(receivers);
+}
+
+void destroy_global_message([[maybe_unused]] const struct message_receiving_entity *self)
+{}
+
+void destroy_group_or_direct_message([[maybe_unused]] const struct message_receiving_entity *self)
+{}
+
+
+/* payload vtables */
+const struct payload_vtable command_login_vtable = {
+	.process = process_command_login,
+	.destroy = destroy_command_login,
+};
+
+const struct payload_vtable command_join_vtable = {
+	.process = process_command_join,
+	.destroy = destroy_command_join,
+};
+
+const struct payload_vtable command_logout_vtable = {
+	.process = process_command_logout,
+	.destroy = destroy_command_logout,
+};
+
+const struct payload_vtable message_vtable = {
+	.process = process_message,
+	.destroy = destroy_message,
+};
+
+/* receiver vtables */
+const struct message_receiving_entity_vtable direct_message_vtable = {
+	.transmit_message = transmit_direct_message,
+	.destroy = destroy_group_or_direct_message,
+};
+
+const struct message_receiving_entity_vtable group_message_vtable = {
+	.transmit_message = transmit_group_message,
+	.destroy = destroy_group_or_direct_message,
+};
+
+const struct message_receiving_entity_vtable global_message_vtable = {
+	.transmit_message = transmit_global_message,
+	.destroy = destroy_global_message,
+};
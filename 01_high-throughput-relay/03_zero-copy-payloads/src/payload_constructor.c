@@ -0,0 +1,160 @@
+// Main method in ths file, parse_payload, gets unstructured input (text),
+// parses it into "struct payload". It sets appropriate function pointers.
+//
+// It is hard to write a clean parser with standard C. Parsing of unstructured
+// text input requires lots of edge case/error checking. We shall use external
+// libraries to handle that complexity - actually this approach just transfers
+// complexity into the library's code, e.g. maintained by specialized
+// open-source communities who have already navigated the minefield of
+// edge-case handling, and memory safety.
+//
+// In later chapters, we will use external dependencies to write more clean
+// parsers (http://github.com/metwse/rdesc)
+
+#include "payload.h"
+#include "tokenizer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+
+/* span of a token in the line, nothing is copied */
+static struct span extract_token(const char *raw, struct token token)
+{
+	return (struct span) {
+		.offset = token.ptr - raw,
+		.len = token.len,
+	};
+}
+
+static bool token_is(struct token token, const char *literal)
+{
+	return token.len == strlen(literal) &&
+		memcmp(token.ptr, literal, token.len) == 0;
+}
+
+static void message_constructor(struct payload *p, const char *raw, size_t len)
+{
+	p->vtable = &message_vtable;
+	p->line = raw;
+
+	// Nested polymorphism: each receiver is polymorphic!
+	// They can be direct (@user), group (#channel), or global (no prefix)
+	// Each receiver knows how to transmit and destroy itself shorthand
+	// variable for receivers field
+	struct message_receiving_entity *receivers;
+	assert((receivers = malloc(sizeof(struct message_receiving_entity))));
+
+	int receiver_count = 0;
+
+	struct tokenizer t;
+	struct token token;
+
+	tokenizer_init(&t, raw, len);
+
+	// Only the receivers are tokenized. As soon as a token is not a
+	// receiver, the rest of the line is the content, and its spaces are
+	// never looked at.
+	size_t content_offset = 0;
+	while (next_token(&t, &token) && token.len > 0 &&
+	       (token.ptr[0] == '@' || token.ptr[0] == '#')) {
+		// assuming all payloads are valid (all of the payloads have
+		// message content)
+		assert(!tokenizer_done(&t));
+
+		struct span receiver_name = extract_token(raw, (struct token) {
+			.ptr = token.ptr + 1,
+			.len = token.len - 1
+		});
+		assert(receiver_name.len > 0);
+
+		if (receiver_count >= 1) {
+			assert((receivers = realloc(receivers,
+				sizeof(struct message_receiving_entity) *
+			        (receiver_count + 1))));
+		}
+
+		receivers[receiver_count] = (struct message_receiving_entity) {
+			.additional_info = receiver_name,
+			.vtable = \
+				token.ptr[0] == '@' ?
+				&direct_message_vtable : &group_message_vtable,
+		};
+
+		receiver_count++;
+
+		content_offset = t.pos;
+	}
+
+	// fallback to global message if no receiver found
+	if (content_offset == 0) {
+		receivers->vtable = &global_message_vtable;
+		receiver_count = 1;
+	};
+
+	p->data.message.content = (struct span) {
+		.offset = content_offset,
+		.len = len - content_offset
+	};
+	p->data.message.receivers = receivers;
+	p->data.message.receiver_count = receiver_count;
+}
+
+bool parse_payload(struct payload *p, const char *raw, size_t len)
+{
+	// spans have 32-bit offsets
+	assert(len <= UINT32_MAX);
+
+	// PAIN, but separated
+	if (raw[0] == '/') {
+		// command name and at most two arguments, all in one pass
+		struct token tokens[3];
+		size_t token_count = tokenize(raw + 1, len - 1, tokens, 3);
+		struct token command_name = tokens[0];
+
+		if (token_is(command_name, "login")) {
+			struct span username, password;
+			assert(token_count == 3);
+			assert((username = extract_token(raw, tokens[1])).len);
+			assert((password = extract_token(raw, tokens[2])).len);
+
+			*p = (struct payload) {
+				.vtable = &command_login_vtable,
+				.line = raw,
+				.data.command_login = {
+					.username = username,
+					.password = password
+				}
+			};
+		} else if (token_is(command_name, "join")) {
+			struct span channel;
+			assert(token_count >= 2);
+			assert((channel = extract_token(raw, tokens[1])).len);
+
+			*p = (struct payload) {
+				.vtable = &command_join_vtable,
+				.line = raw,
+				.data.command_join = {
+					.channel = channel,
+				}
+			};
+		} else if (token_is(command_name, "logout")) {
+			*p = (struct payload) {
+				.vtable = &command_logout_vtable,
+				.line = raw,
+			};
+		} else {
+			printf("Ignoring invalid command %.*s\n",
+			       (int) command_name.len, command_name.ptr);
+			return false;
+		}
+	} else {
+		message_constructor(p, raw, len);
+	}
+
+	return true;
+}
@@ -0,0 +1,68 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/payload.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void assert_span(const char *line, struct span span,
+			const char *expected)
+{
+	assert(span.len == strlen(expected));
+	assert(memcmp(line + span.offset, expected, span.len) == 0);
+}
+
+int main()
+{
+	struct payload_buffer *buf = new_buffer();
+	char line[64];
+
+	// push_payload copies the line, so reusing line is fine
+	strcpy(line, "/login metw password123");
+	push_payload(buf, line, strlen(line));
+	strcpy(line, "@alice #general Hello everyone!");
+	push_payload(buf, line, strlen(line));
+	memset(line, 'x', sizeof(line));
+
+	// borrowed lines are not copied
+	const char *global = "Global message to all";
+	push_borrowed_payload(buf, global, strlen(global));
+
+	assert(buf->len == 3);
+
+	struct payload *login = &buf->payloads[0];
+	assert(login->vtable == &command_login_vtable);
+	assert_span(login->line, login->data.command_login.username, "metw");
+	assert_span(login->line, login->data.command_login.password,
+		    "password123");
+
+	struct payload *message = &buf->payloads[1];
+	assert(message->data.message.receiver_count == 2);
+	assert_span(message->line,
+		    message->data.message.receivers[0].additional_info,
+		    "alice");
+	assert_span(message->line,
+		    message->data.message.receivers[1].additional_info,
+		    "general");
+	assert_span(message->line, message->data.message.content,
+		    "Hello everyone!");
+
+	message = &buf->payloads[2];
+	assert(message->line == global);
+	assert_span(message->line, message->data.message.content, global);
+
+	// a line larger than a block
+	char *huge = malloc(INPUT_BLOCK_SIZE + 2);
+	assert(huge);
+	memset(huge, 'a', INPUT_BLOCK_SIZE + 2);
+	push_payload(buf, huge, INPUT_BLOCK_SIZE + 2);
+	free(huge);
+
+	assert(buf->payloads[3].data.message.content.len ==
+	       INPUT_BLOCK_SIZE + 2);
+
+	destroy(buf);
+
+	return EXIT_SUCCESS;
+}
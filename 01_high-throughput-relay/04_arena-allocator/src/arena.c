@@ -0,0 +1,115 @@
+#include "arena.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t used;
+	size_t cap;
+	alignas(max_align_t) char data[];
+};
+
+/* round size up, so that the next allocation is aligned as well */
+static size_t align_up(size_t size)
+{
+	return (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+}
+
+static struct arena_chunk *new_chunk(size_t cap)
+{
+	struct arena_chunk *chunk = malloc(sizeof(struct arena_chunk) +
+					   sizeof(char) * cap);
+	assert(chunk);
+
+	chunk->used = 0;
+	chunk->cap = cap;
+
+	return chunk;
+}
+
+void arena_init(struct arena *a, size_t chunk_size)
+{
+	*a = (struct arena) {
+		.chunks = NULL,
+		.chunk_size = chunk_size,
+		.last = NULL,
+	};
+}
+
+void *arena_alloc(struct arena *a, size_t size)
+{
+	struct arena_chunk *chunk = a->chunks;
+
+	size = align_up(size);
+
+	if (size > a->chunk_size) {
+		// does not fit into any chunk, give it a dedicated one behind
+		// the chunk we are filling
+		chunk = new_chunk(size);
+		chunk->used = size;
+
+		if (a->chunks == NULL) {
+			chunk->next = NULL;
+			a->chunks = chunk;
+		} else {
+			chunk->next = a->chunks->next;
+			a->chunks->next = chunk;
+		}
+
+		// it is not at the end of the current chunk, it can not grow
+		a->last = NULL;
+
+		return chunk->data;
+	}
+
+	if (chunk == NULL || chunk->cap - chunk->used < size) {
+		chunk = new_chunk(a->chunk_size);
+		chunk->next = a->chunks;
+		a->chunks = chunk;
+	}
+
+	a->last = chunk->data + chunk->used;
+	chunk->used += size;
+
+	return a->last;
+}
+
+void *arena_realloc(struct arena *a, void *ptr, size_t old_size,
+		    size_t new_size)
+{
+	if (ptr == NULL)
+		return arena_alloc(a, new_size);
+
+	struct arena_chunk *chunk = a->chunks;
+
+	if (ptr == a->last) {
+		size_t start = (char *) ptr - chunk->data;
+
+		if (start + align_up(new_size) <= chunk->cap) {
+			chunk->used = start + align_up(new_size);
+
+			return ptr;
+		}
+	}
+
+	void *grown = arena_alloc(a, new_size);
+	memcpy(grown, ptr, old_size < new_size ? old_size : new_size);
+
+	return grown;
+}
+
+void arena_destroy(struct arena *a)
+{
+	while (a->chunks != NULL) {
+		struct arena_chunk *next = a->chunks->next;
+
+		free(a->chunks);
+		a->chunks = next;
+	}
+
+	a->last = NULL;
+}
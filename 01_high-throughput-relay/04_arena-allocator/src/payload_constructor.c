@@ -0,0 +1,179 @@
+// Main method in ths file, parse_payload, gets unstructured input (text),
+// parses it into "struct payload". It sets appropriate function pointers.
+//
+// It is hard to write a clean parser with standard C. Parsing of unstructured
+// text input requires lots of edge case/error checking. We shall use external
+// libraries to handle that complexity - actually this approach just transfers
+// complexity into the library's code, e.g. maintained by specialized
+// open-source communities who have already navigated the minefield of
+// edge-case handling, and memory safety.
+//
+// In later chapters, we will use external dependencies to write more clean
+// parsers (http://github.com/metwse/rdesc)
+
+#include "arena.h"
+#include "payload.h"
+#include "tokenizer.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+
+/* Payloads are allocated from the arena if there is one, or from the heap
+ * otherwise. Heap payloads are freed one by one via their vtable. */
+static void *allocate(struct arena *arena, size_t size)
+{
+	void *ptr = arena ? arena_alloc(arena, size) : malloc(size);
+	assert(ptr);
+
+	return ptr;
+}
+
+/* copy a token into a new null-terminated string */
+static char *extract_token(struct arena *arena, struct token token)
+{
+	char *copy;
+
+	if (token.len == 0) {
+		return NULL;
+	} else {
+		copy = allocate(arena, sizeof(char) * (token.len + 1));
+
+		memcpy(copy, token.ptr, token.len);
+		copy[token.len] = '\0';
+
+		return copy;
+	}
+}
+
+static bool token_is(struct token token, const char *literal)
+{
+	return token.len == strlen(literal) &&
+		memcmp(token.ptr, literal, token.len) == 0;
+}
+
+static void message_constructor(struct payload *p, const char *raw, size_t len,
+				struct arena *arena)
+{
+	p->vtable = &message_vtable;
+
+	int receiver_count = 0;
+
+	struct tokenizer t;
+	struct token token;
+
+	tokenizer_init(&t, raw, len);
+
+	// Only the receivers are tokenized. As soon as a token is not a
+	// receiver, the rest of the line is the content, and its spaces are
+	// never looked at.
+	size_t content_offset = 0;
+	while (next_token(&t, &token) && token.len > 0 &&
+	       (token.ptr[0] == '@' || token.ptr[0] == '#')) {
+		// assuming all payloads are valid (all of the payloads have
+		// message content)
+		assert(!tokenizer_done(&t));
+
+		receiver_count++;
+		content_offset = t.pos;
+	}
+
+	// Nested polymorphism: each receiver is polymorphic!
+	// They can be direct (@user), group (#channel), or global (no prefix)
+	// Each receiver knows how to transmit and destroy itself shorthand
+	// variable for receivers field
+	//
+	// Counted first, so that the array is allocated once: names copied
+	// between growths would keep it from growing in place.
+	struct message_receiving_entity *receivers = allocate(arena,
+		sizeof(struct message_receiving_entity) *
+		(receiver_count > 0 ? receiver_count : 1));
+
+	tokenizer_init(&t, raw, len);
+
+	for (int i = 0; i < receiver_count; i++) {
+		next_token(&t, &token);
+
+		char *receiver_name = extract_token(arena, (struct token) {
+			.ptr = token.ptr + 1,
+			.len = token.len - 1
+		});
+		assert(receiver_name);
+
+		receivers[i] = (struct message_receiving_entity) {
+			.additional_info = receiver_name,
+			.vtable = \
+				token.ptr[0] == '@' ?
+				&direct_message_vtable : &group_message_vtable,
+		};
+	}
+
+	// fallback to global message if no receiver found
+	if (content_offset == 0) {
+		receivers->vtable = &global_message_vtable;
+		receiver_count = 1;
+	};
+
+	size_t content_len = len - content_offset;
+
+	p->data.message.content = allocate(arena,
+					   sizeof(char) * (content_len + 1));
+
+	memcpy(p->data.message.content, raw + content_offset, content_len);
+	p->data.message.content[content_len] = '\0';
+	p->data.message.receivers = receivers;
+	p->data.message.receiver_count = receiver_count;
+}
+
+bool parse_payload(struct payload *p, const char *raw, size_t len,
+		   struct arena *arena)
+{
+	// PAIN, but separated
+	if (raw[0] == '/') {
+		// command name and at most two arguments, all in one pass
+		struct token tokens[3];
+		size_t token_count = tokenize(raw + 1, len - 1, tokens, 3);
+		struct token command_name = tokens[0];
+
+		if (token_is(command_name, "login")) {
+			char *username, *password;
+			assert(token_count == 3);
+			assert((username = extract_token(arena, tokens[1])));
+			assert((password = extract_token(arena, tokens[2])));
+
+			*p = (struct payload) {
+				.vtable = &command_login_vtable,
+				.data.command_login = {
+					.username = username,
+					.password = password
+				}
+			};
+		} else if (token_is(command_name, "join")) {
+			char *channel;
+			assert(token_count >= 2);
+			assert((channel = extract_token(arena, tokens[1])));
+
+			*p = (struct payload) {
+				.vtable = &command_join_vtable,
+				.data.command_join = {
+					.channel = channel,
+				}
+			};
+		} else if (token_is(command_name, "logout")) {
+			*p = (struct payload) {
+				.vtable = &command_logout_vtable
+			};
+		} else {
+			printf("Ignoring invalid command %.*s\n",
+			       (int) command_name.len, command_name.ptr);
+			return false;
+		}
+	} else {
+		message_constructor(p, raw, len, arena);
+	}
+
+	return true;
+}
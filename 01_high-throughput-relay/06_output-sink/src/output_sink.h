@@ -0,0 +1,87 @@
+/**
+ * @file output_sink.h
+ * @brief Large output buffer, written to a file descriptor in batches.
+ *
+ * Processors append their output to a contiguous buffer instead of calling
+ * printf for every piece. The buffer reaches the file descriptor with a
+ * single write() when sink_flush() is called.
+ */
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/** @brief Default buffer size, 1 MiB. */
+#define OUTPUT_SINK_SIZE (1 << 20)
+
+/**
+ * @brief Output buffer state.
+ */
+struct output_sink {
+	int fd;      /**< Destination, not owned */
+	char *buf;   /**< Pending output */
+	size_t len;  /**< Bytes pending in buf */
+	size_t cap;  /**< Size of buf */
+};
+
+/**
+ * @brief Initializes a sink writing to fd.
+ *
+ * @param s Sink to initialize
+ * @param fd File descriptor to write to, e.g. STDOUT_FILENO
+ * @param cap Buffer size, OUTPUT_SINK_SIZE is a good default
+ */
+void sink_init(struct output_sink *s, int fd, size_t cap);
+
+/**
+ * @brief Appends len bytes of data to the sink.
+ *
+ * Nothing is written until sink_flush(), unless the buffer is full. Data
+ * larger than the whole buffer is written directly, without being copied.
+ */
+void sink_write(struct output_sink *s, const char *data, size_t len);
+
+/**
+ * @brief Appends a null-terminated string.
+ */
+static inline void sink_string(struct output_sink *s, const char *str)
+{
+	sink_write(s, str, strlen(str));
+}
+
+/**
+ * @brief Appends a string literal, its length is computed at compile time.
+ */
+#define sink_literal(s, literal) \
+	sink_write((s), "" literal, sizeof(literal) - 1)
+
+/**
+ * @brief Formats into the sink, like printf.
+ *
+ * Formats directly into the free space of the buffer, there is no
+ * intermediate copy. Prefer sink_write() in hot paths, parsing the format
+ * string has a cost.
+ */
+__attribute__((format(printf, 2, 3)))
+void sink_printf(struct output_sink *s, const char *fmt, ...);
+
+/**
+ * @brief Writes everything pending with a single write() (unless the kernel
+ *        accepts less at once).
+ *
+ * @return false if writing failed, pending output is dropped
+ */
+bool sink_flush(struct output_sink *s);
+
+/**
+ * @brief Flushes pending output and frees the buffer. Does not close fd.
+ */
+void sink_destroy(struct output_sink *s);
+
+
+#endif
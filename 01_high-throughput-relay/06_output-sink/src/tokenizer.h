@@ -0,0 +1,89 @@
+/**
+ * @file tokenizer.h
+ * @brief Space separated tokenizer, looking at 32 characters per step.
+ *
+ * Spaces are located with SIMD comparisons (AVX2 or SSE2, chosen at startup)
+ * and collected into a bitmask. Each token boundary is then a single count
+ * trailing zeros instruction, instead of a loop over every character.
+ */
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Number of characters compared in one step. */
+#define TOKENIZER_BLOCK_SIZE 32
+
+/**
+ * @brief Non-owning view of a token, not null-terminated.
+ */
+struct token {
+	const char *ptr;  /**< First character of the token */
+	size_t len;       /**< Length of the token, may be 0 for "  " */
+};
+
+/**
+ * @brief Tokenizer state over one line.
+ *
+ * `mask` has one bit for each space in the current block that has not been
+ * consumed yet. Consecutive tokens in the same block do not touch memory
+ * again.
+ */
+struct tokenizer {
+	const char *raw;  /**< Line being tokenized */
+	size_t len;       /**< Length of the line */
+	size_t pos;       /**< Start of the next token, len + 1 when done */
+	size_t block;     /**< Offset of the block described by mask */
+	uint32_t mask;    /**< Unconsumed spaces in the current block */
+};
+
+/**
+ * @brief Starts tokenizing raw.
+ *
+ * @param t Tokenizer to initialize
+ * @param raw Line, not necessarily null-terminated
+ * @param len Length of the line
+ */
+void tokenizer_init(struct tokenizer *t, const char *raw, size_t len);
+
+/**
+ * @brief Returns the next space separated token.
+ *
+ * @param t Tokenizer
+ * @param token Output, view into the line
+ * @return false if every token of the line has been returned
+ */
+bool next_token(struct tokenizer *t, struct token *token);
+
+/**
+ * @brief Returns true if the last token returned was the last of the line.
+ */
+static inline bool tokenizer_done(const struct tokenizer *t)
+{
+	return t->pos > t->len;
+}
+
+/**
+ * @brief Splits the line into at most max_tokens tokens in one pass.
+ *
+ * @param raw Line, not necessarily null-terminated
+ * @param len Length of the line
+ * @param tokens Output array
+ * @param max_tokens Capacity of tokens, tokenization stops when it is full
+ * @return Number of tokens written
+ */
+size_t tokenize(const char *raw, size_t len, struct token *tokens,
+		size_t max_tokens);
+
+/**
+ * @brief Name of the implementation selected for this CPU, e.g. "avx2".
+ */
+const char *tokenizer_implementation();
+
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file arena.h
+ * @brief Bump allocator that frees everything at once.
+ *
+ * Allocations are carved out of large chunks by moving a pointer forward.
+ * There is no per-allocation free, the whole arena is released with
+ * arena_destroy(), one free() per chunk.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+
+#include <stddef.h>
+
+
+/** @brief Default chunk size, 1 MiB. */
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+struct arena_chunk;
+
+/**
+ * @brief Arena state.
+ */
+struct arena {
+	struct arena_chunk *chunks;  /**< Chunk being filled, then older ones */
+	size_t chunk_size;           /**< Size of regular chunks */
+	void *last;                  /**< Latest allocation, may grow in place */
+};
+
+/**
+ * @brief Initializes an empty arena, no memory is allocated yet.
+ *
+ * @param a Arena to initialize
+ * @param chunk_size Size of chunks, ARENA_CHUNK_SIZE is a good default
+ */
+void arena_init(struct arena *a, size_t chunk_size);
+
+/**
+ * @brief Allocates size bytes, aligned for any type (like malloc).
+ *
+ * Allocations larger than a chunk get a chunk of their own.
+ *
+ * @return Pointer to uninitialized memory, never NULL
+ */
+void *arena_alloc(struct arena *a, size_t size);
+
+/**
+ * @brief Resizes an allocation of the arena.
+ *
+ * If ptr is the latest allocation and there is room in its chunk, it grows
+ * in place. Otherwise, a new block is allocated and old_size bytes are
+ * copied; the old block is wasted until the arena is destroyed.
+ *
+ * @param a Arena ptr was allocated from
+ * @param ptr Allocation to resize, or NULL
+ * @param old_size Size ptr was allocated with
+ * @param new_size Requested size
+ */
+void *arena_realloc(struct arena *a, void *ptr, size_t old_size,
+		    size_t new_size);
+
+/**
+ * @brief Frees every chunk. All allocations of the arena become invalid.
+ */
+void arena_destroy(struct arena *a);
+
+
+#endif
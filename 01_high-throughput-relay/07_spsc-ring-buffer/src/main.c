@@ -0,0 +1,107 @@
+#include "line_reader.h"
+#include "mapped_file.h"
+#include "output_sink.h"
+#include "payload_ring.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* regular files are mapped as a whole */
+static void read_mapped(struct payload_ring *ring, struct mapped_file *file)
+{
+	struct line_view line;
+
+	while (next_line(file, &line))
+		if (line.len > 0)
+			ring_push_payload(ring, line.ptr, line.len);
+
+	unmap_file(file);
+}
+
+/* pipes, stdin and other streams are read chunk by chunk */
+static void read_stream(struct payload_ring *ring, int fd)
+{
+	struct line_reader reader;
+	struct line_view line;
+
+	line_reader_init(&reader, fd, LINE_READER_CHUNK_SIZE);
+
+	while (read_line(&reader, &line))
+		if (line.len > 0)
+			ring_push_payload(ring, line.ptr, line.len);
+
+	line_reader_destroy(&reader);
+}
+
+/* the consumer thread, runs while main() is still reading */
+static void *process_payloads(void *arg)
+{
+	struct payload_ring *ring = arg;
+	struct output_sink out;
+
+	sink_init(&out, STDOUT_FILENO, OUTPUT_SINK_SIZE);
+
+	sink_literal(&out, "--- Processing payloads ---\n");
+	// the total is unknown until the input ends
+	while (ring_wait(ring, &out)) {
+		sink_printf(&out, "Processing payload %zu\n",
+			    ring->processed + 1);
+
+		ring_process_next(ring, &out);
+
+		sink_literal(&out, "\n");
+	}
+
+	sink_printf(&out, "Processed %zu payloads\n", ring->processed);
+	sink_destroy(&out);
+
+	return NULL;
+}
+
+int main(int argc, const char **args)
+{
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <payloads file | ->\n", args[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	struct mapped_file file;
+	int fd = STDIN_FILENO;
+
+	bool is_mapped = strcmp(args[1], "-") != 0 && map_file(&file, args[1]);
+
+	if (!is_mapped && strcmp(args[1], "-") != 0 &&
+	    (fd = open(args[1], O_RDONLY)) == -1) {
+		fprintf(stderr, "Could not open %s.\n", args[1]);
+
+		return EXIT_FAILURE;
+	}
+
+	struct payload_ring *ring = new_ring(RING_CAPACITY);
+	pthread_t processor;
+
+	pthread_create(&processor, NULL, process_payloads, ring);
+
+	// this thread is the producer
+	if (is_mapped) {
+		read_mapped(ring, &file);
+	} else {
+		read_stream(ring, fd);
+
+		if (fd != STDIN_FILENO)
+			close(fd);
+	}
+
+	ring_close(ring);
+	pthread_join(processor, NULL);
+
+	destroy_ring(ring);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+#include "output_sink.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+void sink_init(struct output_sink *s, int fd, size_t cap)
+{
+	*s = (struct output_sink) {
+		.fd = fd,
+		.len = 0,
+		.cap = cap,
+	};
+
+	s->buf = malloc(sizeof(char) * cap);
+	assert(s->buf);
+}
+
+/* writes all of data, retrying partial writes */
+static bool write_all(int fd, const char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = write(fd, data, len);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			return false;
+		}
+
+		data += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+void sink_write(struct output_sink *s, const char *data, size_t len)
+{
+	if (s->cap - s->len < len) {
+		sink_flush(s);
+
+		// would not fit even into an empty buffer, skip the copy
+		if (len > s->cap) {
+			write_all(s->fd, data, len);
+
+			return;
+		}
+	}
+
+	memcpy(s->buf + s->len, data, len);
+	s->len += len;
+}
+
+void sink_printf(struct output_sink *s, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	int len = vsnprintf(s->buf + s->len, s->cap - s->len, fmt, args);
+	va_end(args);
+
+	assert(len >= 0);
+
+	if ((size_t) len < s->cap - s->len) {
+		s->len += len;
+
+		return;
+	}
+
+	// did not fit, make room and format again
+	sink_flush(s);
+	assert((size_t) len < s->cap);
+
+	va_start(args, fmt);
+	vsnprintf(s->buf, s->cap, fmt, args);
+	va_end(args);
+
+	s->len = len;
+}
+
+bool sink_flush(struct output_sink *s)
+{
+	bool ok = write_all(s->fd, s->buf, s->len);
+
+	s->len = 0;
+
+	return ok;
+}
+
+void sink_destroy(struct output_sink *s)
+{
+	sink_flush(s);
+
+	free(s->buf);
+	s->buf = NULL;
+}
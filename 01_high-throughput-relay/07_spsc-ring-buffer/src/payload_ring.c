@@ -0,0 +1,215 @@
+// Only the producer writes head and only the consumer writes tail. Each
+// thread publishes its index with a release store, and reads the other one's
+// with an acquire load:
+//
+// - the producer fills a slot, then releases head: the consumer that
+//   acquires the new head sees the slot's contents.
+// - the consumer destroys a payload, then releases tail: the producer that
+//   acquires the new tail may overwrite the slot.
+//
+// Reading the other thread's index means pulling its cache line, so each
+// side keeps a cached copy and reloads it only when the ring looks full (or
+// empty) according to the copy.
+//
+// A thread that has to wait reloads the other index a few times, then
+// sleeps on its futex. Going to sleep and waking up mirror each other:
+//
+// - the sleeper sets its flag, then checks the index once more.
+// - the other thread updates its index, then checks the flag, and if it is
+//   set, bumps the sleeper's futex and wakes it.
+//
+// A full fence between the store and the load on both sides makes sure that
+// at least one of them sees the other's store: either the sleeper does not
+// go to sleep, or it is woken up. A futex bumped in between does not let it
+// sleep at all.
+
+#include "output_sink.h"
+#include "payload_ring.h"
+
+#include <assert.h>
+#include <linux/futex.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+struct payload_ring *new_ring(size_t capacity)
+{
+	// capacity is a power of two, so `index & mask` is `index % capacity`
+	assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+	struct payload_ring *ring = aligned_alloc(alignof(struct payload_ring),
+						  sizeof(struct payload_ring));
+	assert(ring);
+
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->closed, false);
+	atomic_init(&ring->is_consumer_asleep, false);
+	atomic_init(&ring->is_producer_asleep, false);
+	atomic_init(&ring->consumer_futex, 0);
+	atomic_init(&ring->producer_futex, 0);
+	ring->cached_head = ring->cached_tail = 0;
+	ring->processed = 0;
+	ring->mask = capacity - 1;
+
+	ring->payloads = malloc(sizeof(struct payload) * capacity);
+	assert(ring->payloads);
+
+	return ring;
+}
+
+/* sleeps until the word is no longer value, or until woken up */
+static void futex_wait(atomic_uint *word, unsigned value)
+{
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+/* after an index update, wakes the other thread if it sleeps */
+static void wake(atomic_bool *is_asleep, atomic_uint *futex)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (!atomic_load_explicit(is_asleep, memory_order_relaxed))
+		return;
+
+	atomic_fetch_add_explicit(futex, 1, memory_order_relaxed);
+	syscall(SYS_futex, futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/* the ring is full for the producer at head */
+static bool is_full(struct payload_ring *ring, size_t head)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	return head - tail > ring->mask;
+}
+
+/* nothing to process for the consumer at tail */
+static bool is_empty(struct payload_ring *ring, size_t tail)
+{
+	return atomic_load_explicit(&ring->head, memory_order_relaxed) == tail &&
+	       !atomic_load_explicit(&ring->closed, memory_order_relaxed);
+}
+
+bool ring_push_payload(struct payload_ring *ring, const char *raw,
+		       size_t len)
+{
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	struct payload parsed;
+
+	// parse before waiting, the consumer may free a slot meanwhile
+	if (!parse_payload(&parsed, raw, len, NULL))
+		return false;
+
+	for (unsigned spin = 0; head - ring->cached_tail > ring->mask;
+	     spin++) {
+		ring->cached_tail = atomic_load_explicit(&ring->tail,
+							 memory_order_acquire);
+
+		if (head - ring->cached_tail <= ring->mask ||
+		    spin < RING_SPIN_COUNT)
+			continue;
+
+		// still full, sleep until the consumer frees a slot
+		// acquire: read before announcing the sleep, or a wake-up
+		// could be missed
+		unsigned futex = atomic_load_explicit(&ring->producer_futex,
+						      memory_order_acquire);
+
+		atomic_store_explicit(&ring->is_producer_asleep, true,
+				      memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+
+		if (is_full(ring, head))
+			futex_wait(&ring->producer_futex, futex);
+
+		atomic_store_explicit(&ring->is_producer_asleep, false,
+				      memory_order_relaxed);
+	}
+
+	ring->payloads[head & ring->mask] = parsed;
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	wake(&ring->is_consumer_asleep, &ring->consumer_futex);
+
+	return true;
+}
+
+void ring_close(struct payload_ring *ring)
+{
+	// release: every push happens before the consumer sees closed
+	atomic_store_explicit(&ring->closed, true, memory_order_release);
+	wake(&ring->is_consumer_asleep, &ring->consumer_futex);
+}
+
+bool ring_wait(struct payload_ring *ring, struct output_sink *out)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	for (unsigned spin = 0; tail == ring->cached_head; spin++) {
+		// read closed before head, a push may happen in between
+		bool closed = atomic_load_explicit(&ring->closed,
+						   memory_order_acquire);
+
+		ring->cached_head = atomic_load_explicit(&ring->head,
+							 memory_order_acquire);
+
+		if (tail != ring->cached_head)
+			break;
+
+		if (closed)
+			return false;
+
+		if (spin < RING_SPIN_COUNT)
+			continue;
+
+		// still empty, sleep until the producer pushes or closes
+		sink_flush(out);
+
+		unsigned futex = atomic_load_explicit(&ring->consumer_futex,
+						      memory_order_acquire);
+
+		atomic_store_explicit(&ring->is_consumer_asleep, true,
+				      memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+
+		if (is_empty(ring, tail))
+			futex_wait(&ring->consumer_futex, futex);
+
+		atomic_store_explicit(&ring->is_consumer_asleep, false,
+				      memory_order_relaxed);
+	}
+
+	return true;
+}
+
+void ring_process_next(struct payload_ring *ring, struct output_sink *out)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	// ring_wait() has seen this payload
+	assert(tail != ring->cached_head);
+
+	struct payload *p = &ring->payloads[tail & ring->mask];
+
+	p->vtable->process(p, out);
+	p->vtable->destroy(p);
+
+	ring->processed += 1;
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	wake(&ring->is_producer_asleep, &ring->producer_futex);
+}
+
+void destroy_ring(struct payload_ring *ring)
+{
+	size_t head = atomic_load(&ring->head);
+
+	for (size_t i = atomic_load(&ring->tail); i != head; i++) {
+		struct payload *p = &ring->payloads[i & ring->mask];
+
+		p->vtable->destroy(p);
+	}
+
+	free(ring->payloads);
+	free(ring);
+}
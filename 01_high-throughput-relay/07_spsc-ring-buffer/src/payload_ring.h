@@ -0,0 +1,120 @@
+/**
+ * @file payload_ring.h
+ * @brief Bounded single-producer/single-consumer payload queue.
+ *
+ * A variant of the payload buffer for reading and processing at the same
+ * time: one thread parses and pushes payloads, another one processes them.
+ * The threads synchronize through two indices only, without locks. At most
+ * RING_CAPACITY payloads are in flight, however large the input is.
+ *
+ * A thread that finds the ring full (or empty) spins RING_SPIN_COUNT times,
+ * then sleeps on a futex until the other one makes progress.
+ */
+
+#ifndef PAYLOAD_RING_H
+#define PAYLOAD_RING_H
+
+
+#include "payload.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/** @brief Default number of slots, must be a power of two. */
+#define RING_CAPACITY 1024
+
+/** @brief Reloads of the other thread's index before going to sleep. */
+#define RING_SPIN_COUNT 256
+
+/** @brief Indices written by different threads live on different lines. */
+#define CACHE_LINE_SIZE 64
+
+struct output_sink;
+
+/**
+ * @brief Ring state.
+ *
+ * head and tail only grow, the slot of an index is `index & mask`. The ring
+ * is empty when they are equal, and full when they are capacity apart.
+ */
+struct payload_ring {
+	/* written by the producer */
+	alignas(CACHE_LINE_SIZE) atomic_size_t head;  /**< Next slot to fill */
+	size_t cached_tail;  /**< Last tail seen by the producer */
+
+	/* written by the consumer */
+	alignas(CACHE_LINE_SIZE) atomic_size_t tail;  /**< Next slot to process */
+	size_t cached_head;  /**< Last head seen by the consumer */
+	size_t processed;    /**< Payloads processed so far */
+
+	/* written when a thread sleeps, read after every index update */
+	alignas(CACHE_LINE_SIZE) atomic_bool is_consumer_asleep;
+	atomic_bool is_producer_asleep;
+	atomic_uint consumer_futex;  /**< Bumped to wake the consumer */
+	atomic_uint producer_futex;  /**< Bumped to wake the producer */
+
+	/* written once */
+	alignas(CACHE_LINE_SIZE) atomic_bool closed;  /**< No more pushes */
+	size_t mask;                                  /**< capacity - 1 */
+	struct payload *payloads;                     /**< The slots */
+};
+
+
+/**
+ * @brief Allocates an empty ring.
+ *
+ * @param capacity Number of slots, a power of two, e.g. RING_CAPACITY
+ */
+struct payload_ring *new_ring(size_t capacity);
+
+/**
+ * @brief Parses a payload and adds it to the ring, producer side.
+ *
+ * Waits while the ring is full. Fields of the payload are allocated on the
+ * heap, the raw line can be reused as soon as this function returns.
+ *
+ * @param ring Pointer to the ring
+ * @param raw Line view, e.g. pointing into a line reader's buffer
+ * @param len Length of the line, without the newline
+ * @return false if the payload could not be parsed, nothing was added
+ */
+bool ring_push_payload(struct payload_ring *ring, const char *raw,
+		       size_t len);
+
+/**
+ * @brief Tells the consumer that no more payloads will be pushed.
+ */
+void ring_close(struct payload_ring *ring);
+
+/**
+ * @brief Waits for the next payload, consumer side.
+ *
+ * Before sleeping, the sink is flushed so that output does not stay in the
+ * buffer while the producer is slow.
+ *
+ * @param ring Pointer to the ring
+ * @param out Sink of the consumer
+ * @return false if the ring is closed and every payload was processed
+ */
+bool ring_wait(struct payload_ring *ring, struct output_sink *out);
+
+/**
+ * @brief Processes and destroys the oldest payload, consumer side.
+ *
+ * @param ring Pointer to the ring, ring_wait() must have returned true
+ * @param out Sink the output is appended to
+ */
+void ring_process_next(struct payload_ring *ring, struct output_sink *out);
+
+/**
+ * @brief Frees the ring, including payloads that were never processed.
+ *
+ * @note Neither thread may use the ring anymore.
+ */
+void destroy_ring(struct payload_ring *ring);
+
+
+#endif
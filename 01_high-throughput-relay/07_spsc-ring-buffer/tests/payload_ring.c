@@ -0,0 +1,142 @@
+#include "../src/output_sink.h"
+#include "../src/payload_ring.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define PAYLOAD_COUNT 10000
+
+/* producer: far more payloads than slots */
+static void *push_payloads(void *arg)
+{
+	struct payload_ring *ring = arg;
+	char line[32];
+
+	for (int i = 0; i < PAYLOAD_COUNT; i++) {
+		int len = sprintf(line, "/join c%d", i);
+
+		assert(ring_push_payload(ring, line, len));
+		// the line buffer is reused immediately
+		memset(line, 'x', sizeof(line));
+	}
+
+	assert(!ring_push_payload(ring, "/unknown", 8));
+
+	ring_close(ring);
+
+	return NULL;
+}
+
+/* producer: waits for the consumer to sleep before each push */
+static void *push_to_sleeper(void *arg)
+{
+	struct payload_ring *ring = arg;
+
+	for (int i = 0; i < 3; i++) {
+		while (!atomic_load(&ring->is_consumer_asleep))
+			usleep(1000);
+
+		assert(ring_push_payload(ring, "/logout", 7));
+	}
+
+	while (!atomic_load(&ring->is_consumer_asleep))
+		usleep(1000);
+
+	ring_close(ring);
+
+	return NULL;
+}
+
+static void test_sleepers_are_woken()
+{
+	FILE *file = tmpfile();
+	assert(file);
+
+	struct payload_ring *ring = new_ring(2);
+	struct output_sink out;
+	pthread_t producer;
+
+	sink_init(&out, fileno(file), 64);
+
+	// an empty ring puts the consumer to sleep, a push or a close wakes it
+	pthread_create(&producer, NULL, push_to_sleeper, ring);
+
+	while (ring_wait(ring, &out))
+		ring_process_next(ring, &out);
+
+	pthread_join(producer, NULL);
+	assert(ring->processed == 3);
+	destroy_ring(ring);
+
+	// a full ring puts the producer to sleep, a processed payload wakes it
+	ring = new_ring(2);
+	pthread_create(&producer, NULL, push_payloads, ring);
+
+	while (ring_wait(ring, &out)) {
+		while (ring->processed < 3 &&
+		       !atomic_load(&ring->is_producer_asleep))
+			usleep(1000);
+
+		ring_process_next(ring, &out);
+	}
+
+	pthread_join(producer, NULL);
+	assert(ring->processed == PAYLOAD_COUNT);
+
+	sink_destroy(&out);
+	destroy_ring(ring);
+	fclose(file);
+}
+
+int main()
+{
+	FILE *file = tmpfile();
+	assert(file);
+
+	struct payload_ring *ring = new_ring(4);
+	struct output_sink out;
+	pthread_t producer;
+
+	sink_init(&out, fileno(file), 64);
+	pthread_create(&producer, NULL, push_payloads, ring);
+
+	while (ring_wait(ring, &out))
+		ring_process_next(ring, &out);
+
+	pthread_join(producer, NULL);
+	assert(ring->processed == PAYLOAD_COUNT);
+
+	// a closed and drained ring stays drained
+	assert(!ring_wait(ring, &out));
+
+	sink_destroy(&out);
+	destroy_ring(ring);
+
+	// every payload came out, in order
+	char expected[64];
+	char *line = NULL;
+	size_t cap = 0;
+
+	rewind(file);
+	for (int i = 0; i < PAYLOAD_COUNT; i++) {
+		assert(getline(&line, &cap, file) > 0);
+		assert(strcmp(line, "Command: join\n") == 0);
+
+		sprintf(expected, "  Arguments: [channel: c%d]\n", i);
+		assert(getline(&line, &cap, file) > 0);
+		assert(strcmp(line, expected) == 0);
+	}
+	assert(getline(&line, &cap, file) == -1);
+
+	free(line);
+	fclose(file);
+
+	test_sleepers_are_woken();
+
+	return EXIT_SUCCESS;
+}
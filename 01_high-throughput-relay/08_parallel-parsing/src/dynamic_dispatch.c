@@ -0,0 +1,85 @@
+#include "dynamic_dispatch.h"
+#include "payload.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+struct payload_buffer *new_buffer()
+{
+	struct payload_buffer *buf = malloc(sizeof(struct payload_buffer));
+	assert(buf);
+
+	buf->process_base = buf->len = 0;
+	buf->cap = 1;
+	buf->payloads = malloc(sizeof(struct payload));
+	assert(buf->payloads);
+
+	arena_init(&buf->arena, ARENA_CHUNK_SIZE);
+
+	return buf;
+}
+
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len)
+{
+	struct payload parsed;
+
+	bool is_parsing_successful = parse_payload(&parsed, raw, len,
+						   &buf->arena);
+
+	if (is_parsing_successful) {
+		if (buf->cap == buf->len) {
+			buf->cap *= 2;
+			buf->payloads = realloc(buf->payloads,
+			   buf->cap * sizeof(struct payload));
+
+			assert(buf->payloads);
+		}
+
+		buf->payloads[buf->len++] = parsed;
+	}
+}
+
+void append_buffer(struct payload_buffer *buf, struct payload_buffer *other)
+{
+	assert(other->process_base == 0);
+
+	if (buf->cap < buf->len + other->len) {
+		while (buf->cap < buf->len + other->len)
+			buf->cap *= 2;
+
+		buf->payloads = realloc(buf->payloads,
+					buf->cap * sizeof(struct payload));
+		assert(buf->payloads);
+	}
+
+	memcpy(&buf->payloads[buf->len], other->payloads,
+	       other->len * sizeof(struct payload));
+	buf->len += other->len;
+
+	arena_adopt(&buf->arena, &other->arena);
+
+	free(other->payloads);
+	free(other);
+}
+
+void process_next(struct payload_buffer *buf, struct output_sink *out)
+{
+	assert(buf->process_base < buf->len);
+
+	struct payload *p = &buf->payloads[buf->process_base];
+	p->vtable->process(p, out);
+
+	buf->process_base += 1;
+}
+
+void destroy(struct payload_buffer *buf)
+{
+	// no vtable->destroy calls, every field lives in the arena
+	arena_destroy(&buf->arena);
+
+	free(buf->payloads);
+	free(buf);
+}
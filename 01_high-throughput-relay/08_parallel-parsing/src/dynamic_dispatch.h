@@ -0,0 +1,69 @@
+/**
+ * @file dynamic_dispatch.h
+ * @brief Payload buffer whose payloads live in an arena.
+ */
+
+
+#ifndef DYNAMIC_DISPATCH_H
+#define DYNAMIC_DISPATCH_H
+
+
+#include "arena.h"
+
+#include <stddef.h>
+
+
+struct payload_buffer {
+	struct payload *payloads;
+	size_t len;
+	size_t cap;
+	size_t process_base;
+	struct arena arena;  /**< Fields of every payload in the buffer */
+};
+
+
+struct payload_buffer *new_buffer();
+
+/**
+ * @brief Parses and adds a payload to the buffer.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param raw Line view, e.g. pointing into a mapped file
+ * @param len Length of the line, without the newline
+ *
+ * @note Fields of the payload are allocated from the buffer's arena.
+ */
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len);
+
+/**
+ * @brief Moves every payload of other to the end of buf, and frees other.
+ *
+ * Payload fields are not copied: other's arena is handed over to buf.
+ *
+ * @param buf Pointer to the payload buffer to append to
+ * @param other Buffer to empty, it must not have been processed yet
+ */
+void append_buffer(struct payload_buffer *buf, struct payload_buffer *other);
+
+struct output_sink;
+
+/**
+ * @brief Processes the next payload of the buffer.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param out Sink the output is appended to, flushed by the caller
+ */
+void process_next(struct payload_buffer *buf, struct output_sink *out);
+
+/**
+ * @brief Frees the buffer and all of its payloads.
+ *
+ * Payloads are not destroyed one by one, the arena is released as a whole:
+ * one free() per arena chunk instead of several per payload.
+ *
+ * @param buf Pointer to the payload buffer to destroy
+ */
+void destroy(struct payload_buffer *buf);
+
+
+#endif
@@ -0,0 +1,20 @@
+// Milestone 00: one function parses and prints each payload, there is no
+// separate parse phase.
+
+#include "bench.h"
+#include "traditional_dispatch.h"
+
+
+static void dispatch([[maybe_unused]] void *parsed, char **lines,
+		     size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		handle_payload(lines[i]);
+}
+
+const struct implementation implementation = {
+	.name = "00_traditional-approach",
+	.parse = NULL,
+	.dispatch = dispatch,
+	.destroy = NULL,
+};
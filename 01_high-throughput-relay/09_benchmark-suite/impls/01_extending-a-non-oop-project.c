@@ -0,0 +1,36 @@
+// Milestone 01: tagged union, processed by a switch on the kind.
+
+#include "bench.h"
+#include "traditional_dispatch.h"
+
+
+static void *parse(char **lines, size_t count)
+{
+	struct payload_buffer *buf = new_buffer();
+
+	for (size_t i = 0; i < count; i++)
+		push_payload(buf, lines[i]);
+
+	return buf;
+}
+
+static void dispatch(void *parsed, [[maybe_unused]] char **lines,
+		     [[maybe_unused]] size_t count)
+{
+	struct payload_buffer *buf = parsed;
+
+	while (buf->process_base < buf->len)
+		process_next(buf);
+}
+
+static void release(void *parsed)
+{
+	destroy(parsed);
+}
+
+const struct implementation implementation = {
+	.name = "01_extending-a-non-oop-project",
+	.parse = parse,
+	.dispatch = dispatch,
+	.destroy = release,
+};
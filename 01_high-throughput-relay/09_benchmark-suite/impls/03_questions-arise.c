@@ -0,0 +1,36 @@
+// Milestone 03: a shared vtable per payload type.
+
+#include "bench.h"
+#include "dynamic_dispatch.h"
+
+
+static void *parse(char **lines, size_t count)
+{
+	struct payload_buffer *buf = new_buffer();
+
+	for (size_t i = 0; i < count; i++)
+		push_payload(buf, lines[i]);
+
+	return buf;
+}
+
+static void dispatch(void *parsed, [[maybe_unused]] char **lines,
+		     [[maybe_unused]] size_t count)
+{
+	struct payload_buffer *buf = parsed;
+
+	while (buf->process_base < buf->len)
+		process_next(buf);
+}
+
+static void release(void *parsed)
+{
+	destroy(parsed);
+}
+
+const struct implementation implementation = {
+	.name = "03_questions-arise",
+	.parse = parse,
+	.dispatch = dispatch,
+	.destroy = release,
+};
@@ -0,0 +1,20 @@
+// Milestone 04: RAII commands, constructed and processed right away by one
+// function. Messages are not supported, they are reported as unknown
+// commands.
+
+#include "bench.h"
+#include "payload.hpp"
+
+
+static void dispatch([[maybe_unused]] void *parsed, char **lines,
+                     size_t count) {
+    for (size_t i = 0; i < count; i++)
+        handle_command_payload(lines[i]);
+}
+
+extern "C" const struct implementation implementation = {
+    .name = "04_raii",
+    .parse = nullptr,
+    .dispatch = dispatch,
+    .destroy = nullptr,
+};
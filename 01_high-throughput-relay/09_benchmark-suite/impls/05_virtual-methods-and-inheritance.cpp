@@ -0,0 +1,95 @@
+// Milestone 05: a class hierarchy with virtual methods. The milestone has no
+// parser, so this adapter brings a minimal one. A message gets one object
+// per receiver, since every message class has exactly one recipient.
+
+#include "bench.h"
+#include "payload.hpp"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using std::make_unique, std::unique_ptr, std::vector;
+
+
+/* cuts the next space separated word out of *rest */
+static char *next_word(char **rest) {
+    return strtok_r(nullptr, " ", rest);
+}
+
+static void parse_command(vector<unique_ptr<Payload>> &payloads, char *raw) {
+    char *rest = raw + 1;
+    char *name = strtok_r(rest, " ", &rest);
+
+    if (name == nullptr)
+        return;
+
+    if (strcmp(name, "login") == 0) {
+        char *username = next_word(&rest);
+        char *password = next_word(&rest);
+
+        if (username && password)
+            payloads.push_back(make_unique<LoginCommand>(username, password));
+    } else if (strcmp(name, "join") == 0) {
+        if (char *channel = next_word(&rest))
+            payloads.push_back(make_unique<JoinCommand>(channel));
+    } else if (strcmp(name, "logout") == 0) {
+        payloads.push_back(make_unique<LogoutCommand>());
+    }
+}
+
+static void parse_message(vector<unique_ptr<Payload>> &payloads, char *raw) {
+    // receivers first, then the content they all get
+    vector<char *> receivers;
+
+    while (raw[0] == '@' || raw[0] == '#') {
+        char *end = strchr(raw, ' ');
+
+        if (end == nullptr)
+            return;
+
+        *end = '\0';
+        receivers.push_back(raw);
+        raw = end + 1;
+    }
+
+    if (receivers.empty())
+        payloads.push_back(make_unique<GlobalMessage>(raw));
+
+    for (char *receiver : receivers) {
+        if (receiver[0] == '@')
+            payloads.push_back(make_unique<DirectMessage>(raw, receiver + 1));
+        else
+            payloads.push_back(make_unique<GroupMessage>(raw, receiver + 1));
+    }
+}
+
+static void *parse(char **lines, size_t count) {
+    auto *payloads = new vector<unique_ptr<Payload>>;
+
+    for (size_t i = 0; i < count; i++) {
+        if (lines[i][0] == '/')
+            parse_command(*payloads, lines[i]);
+        else
+            parse_message(*payloads, lines[i]);
+    }
+
+    return payloads;
+}
+
+static void dispatch(void *parsed, [[maybe_unused]] char **lines,
+                     [[maybe_unused]] size_t count) {
+    for (auto &payload : *static_cast<vector<unique_ptr<Payload>> *>(parsed))
+        payload->process();
+}
+
+static void release(void *parsed) {
+    delete static_cast<vector<unique_ptr<Payload>> *>(parsed);
+}
+
+extern "C" const struct implementation implementation = {
+    .name = "05_virtual-methods-and-inheritance",
+    .parse = parse,
+    .dispatch = dispatch,
+    .destroy = release,
+};
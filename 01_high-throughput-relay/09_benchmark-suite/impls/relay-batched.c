@@ -0,0 +1,55 @@
+// Same as relay, but payloads are dispatched in windows grouped by type, see
+// process_batch(). Output is put back in arrival order.
+
+#include "bench.h"
+#include "dynamic_dispatch.h"
+#include "intern.h"
+#include "output_sink.h"
+
+#include <string.h>
+#include <unistd.h>
+
+
+static void *parse(char **lines, size_t count)
+{
+	struct payload_buffer *buf = new_buffer();
+
+	reserve_payloads(buf, count);
+
+	for (size_t i = 0; i < count; i++)
+		push_payload(buf, lines[i], strlen(lines[i]));
+
+	return buf;
+}
+
+static void dispatch(void *parsed, [[maybe_unused]] char **lines,
+		     [[maybe_unused]] size_t count)
+{
+	struct payload_buffer *buf = parsed;
+	struct batch_output batch;
+	struct output_sink out;
+
+	sink_init(&out, STDOUT_FILENO, OUTPUT_SINK_SIZE);
+	batch_output_init(&batch);
+
+	while (process_batch(buf, &batch) > 0)
+		for (size_t i = 0; i < batch.count; i++)
+			sink_write(&out, batch.scratch.buf + batch.start[i],
+				   batch.len[i]);
+
+	batch_output_destroy(&batch);
+	sink_destroy(&out);
+}
+
+static void release(void *parsed)
+{
+	destroy(parsed);
+	intern_reset();
+}
+
+const struct implementation implementation = {
+	.name = "relay-batched",
+	.parse = parse,
+	.dispatch = dispatch,
+	.destroy = release,
+};
@@ -0,0 +1,51 @@
+// Same parser as relay, but payloads are packed into 8-byte records, see
+// record_store.h, and dispatched by a switch on their kind.
+
+#include "bench.h"
+#include "intern.h"
+#include "output_sink.h"
+#include "record_store.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static void *parse(char **lines, size_t count)
+{
+	struct record_store *store = malloc(sizeof(struct record_store));
+	assert(store);
+
+	record_store_init(store);
+	record_store_reserve(store, count);
+
+	for (size_t i = 0; i < count; i++)
+		record_store_push(store, lines[i], strlen(lines[i]));
+
+	return store;
+}
+
+static void dispatch(void *parsed, [[maybe_unused]] char **lines,
+		     [[maybe_unused]] size_t count)
+{
+	struct output_sink out;
+
+	sink_init(&out, STDOUT_FILENO, OUTPUT_SINK_SIZE);
+	record_store_dispatch(parsed, &out);
+	sink_destroy(&out);
+}
+
+static void release(void *parsed)
+{
+	record_store_destroy(parsed);
+	free(parsed);
+	intern_reset();
+}
+
+const struct implementation implementation = {
+	.name = "relay-packed",
+	.parse = parse,
+	.dispatch = dispatch,
+	.destroy = release,
+};
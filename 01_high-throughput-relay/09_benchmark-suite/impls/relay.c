@@ -0,0 +1,54 @@
+// This module, as of the compact records chapter (RELAY_CHAPTER in the
+// Makefile): line views, SIMD tokenizer, command registry, arena, output sink,
+// intern table and payload segments, reserved up front since the count is
+// known. Packed records are measured by relay-packed. Lines are pushed one
+// by one, so parsing runs on a single thread like the others. Payloads are
+// dispatched one by one too, in arrival order.
+
+#include "bench.h"
+#include "dynamic_dispatch.h"
+#include "intern.h"
+#include "output_sink.h"
+
+#include <string.h>
+#include <unistd.h>
+
+
+static void *parse(char **lines, size_t count)
+{
+	struct payload_buffer *buf = new_buffer();
+
+	reserve_payloads(buf, count);
+
+	for (size_t i = 0; i < count; i++)
+		push_payload(buf, lines[i], strlen(lines[i]));
+
+	return buf;
+}
+
+static void dispatch(void *parsed, [[maybe_unused]] char **lines,
+		     [[maybe_unused]] size_t count)
+{
+	struct payload_buffer *buf = parsed;
+	struct output_sink out;
+
+	sink_init(&out, STDOUT_FILENO, OUTPUT_SINK_SIZE);
+
+	while (buf->process_base < buf->len)
+		process_next(buf, &out);
+
+	sink_destroy(&out);
+}
+
+static void release(void *parsed)
+{
+	destroy(parsed);
+	intern_reset();
+}
+
+const struct implementation implementation = {
+	.name = "relay",
+	.parse = parse,
+	.dispatch = dispatch,
+	.destroy = release,
+};
@@ -0,0 +1,40 @@
+// Value-semantic payloads in one contiguous vector, dispatched with
+// std::visit. Same payload types and output as Exercise 05.
+
+#include "bench.h"
+#include "payload_variant.hpp"
+
+#include <vector>
+
+using std::vector;
+
+
+static void *parse(char **lines, size_t count) {
+    auto *payloads = new vector<PayloadVariant>;
+
+    // one payload per line, unless messages have several receivers
+    payloads->reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+        parse_payload(lines[i], *payloads);
+
+    return payloads;
+}
+
+static void dispatch(void *parsed, [[maybe_unused]] char **lines,
+                     [[maybe_unused]] size_t count) {
+    for (const PayloadVariant &payload :
+         *static_cast<vector<PayloadVariant> *>(parsed))
+        process(payload);
+}
+
+static void release(void *parsed) {
+    delete static_cast<vector<PayloadVariant> *>(parsed);
+}
+
+extern "C" const struct implementation implementation = {
+    .name = "variant",
+    .parse = parse,
+    .dispatch = dispatch,
+    .destroy = release,
+};
@@ -0,0 +1,61 @@
+// glibc allows replacing its allocator: a program that defines malloc and
+// friends gets its own versions called everywhere, including from libc and
+// libstdc++. We do not want a new allocator, only to count calls, so every
+// replacement forwards to glibc's internal entry points.
+
+#include "alloc_counter.h"
+
+#include <stdlib.h>
+
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/* parallel parsers allocate from several threads */
+static size_t allocations;
+
+static void count_allocation(void)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+}
+
+size_t allocation_count(void)
+{
+	return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+	count_allocation();
+
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	count_allocation();
+
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	count_allocation();
+
+	return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	count_allocation();
+
+	return __libc_memalign(alignment, size);
+}
+
+void free(void *ptr)
+{
+	__libc_free(ptr);
+}
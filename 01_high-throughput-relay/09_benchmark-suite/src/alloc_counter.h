@@ -0,0 +1,34 @@
+/**
+ * @file alloc_counter.h
+ * @brief Counts heap allocations of the whole program.
+ *
+ * alloc_counter.c replaces malloc, calloc, realloc and aligned_alloc with
+ * versions that count calls before forwarding them to glibc. Shared
+ * libraries use the replacements too, so C++ `new` is counted as well.
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Number of allocations since the program started.
+ *
+ * realloc counts as an allocation, it may move the block. free does not
+ * count.
+ */
+size_t allocation_count(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
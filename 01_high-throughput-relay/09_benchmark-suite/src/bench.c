@@ -0,0 +1,175 @@
+// Benchmark driver: generates the workload, runs the two phases of the
+// implementation it is linked with, and prints one JSON object.
+//
+// Only the phases are measured. Generating the input and splitting it into
+// lines happens before the clock starts, and its memory is reported
+// separately as the baseline.
+
+#include "alloc_counter.h"
+#include "bench.h"
+#include "generator.h"
+#include "perf_counter.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/* config of a PERF_TYPE_HW_CACHE event, see perf_event_open(2) */
+#define CACHE_READ_MISSES(cache) \
+	((cache) | PERF_COUNT_HW_CACHE_OP_READ << 8 | \
+	 PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+
+/* events counted by the CPU during the dispatch phase, where available */
+static const struct {
+	const char *key;  /* reported per payload */
+	uint32_t type;
+	uint64_t config;
+} dispatch_events[] = {
+	{ "dispatch_branch_misses_per_payload",
+	  PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ "dispatch_l1d_misses_per_payload",
+	  PERF_TYPE_HW_CACHE, CACHE_READ_MISSES(PERF_COUNT_HW_CACHE_L1D) },
+	{ "dispatch_llc_misses_per_payload",
+	  PERF_TYPE_HW_CACHE, CACHE_READ_MISSES(PERF_COUNT_HW_CACHE_LL) },
+};
+
+#define EVENT_COUNT (sizeof(dispatch_events) / sizeof(*dispatch_events))
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss;
+}
+
+/* splits text in place, every newline becomes a null terminator */
+static char **split_lines(char *text, size_t size, size_t count)
+{
+	char **lines = malloc(sizeof(char *) * count);
+	char *line = text;
+
+	assert(lines);
+
+	for (size_t i = 0; i < count; i++) {
+		char *newline = memchr(line, '\n', text + size - line);
+
+		*newline = '\0';
+		lines[i] = line;
+		line = newline + 1;
+	}
+
+	return lines;
+}
+
+int main(int argc, const char **args)
+{
+	struct workload w = WORKLOAD_DEFAULT;
+
+	if (!workload_from_args(&w, argc, args)) {
+		fprintf(stderr, "Usage: %s [--seed N] [--count N] "
+				"[--mix L,J,O,D,G,B] [--receivers N] "
+				"[--length N]\n", args[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	size_t size;
+	char *text = generate_payloads(&w, &size);
+	char **lines = split_lines(text, size, w.count);
+
+	long baseline_rss = peak_rss_kb();
+
+	// implementations print everything they process
+	int saved_stdout = dup(STDOUT_FILENO);
+	int null = open("/dev/null", O_WRONLY);
+
+	fflush(stdout);
+	dup2(null, STDOUT_FILENO);
+
+	struct perf_counter counters[EVENT_COUNT];
+
+	for (size_t i = 0; i < EVENT_COUNT; i++)
+		perf_counter_open(&counters[i], dispatch_events[i].type,
+				  dispatch_events[i].config);
+
+	size_t allocations = allocation_count();
+	double start = now_ns();
+	void *parsed = NULL;
+
+	if (implementation.parse)
+		parsed = implementation.parse(lines, w.count);
+
+	double parsed_at = now_ns();
+
+	for (size_t i = 0; i < EVENT_COUNT; i++)
+		perf_counter_start(&counters[i]);
+
+	implementation.dispatch(parsed, lines, w.count);
+	fflush(stdout);
+
+	for (size_t i = 0; i < EVENT_COUNT; i++)
+		perf_counter_stop(&counters[i]);
+
+	double dispatched_at = now_ns();
+
+	allocations = allocation_count() - allocations;
+
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+	close(null);
+
+	long rss = peak_rss_kb();
+
+	if (implementation.destroy)
+		implementation.destroy(parsed);
+
+	printf("{\"implementation\":\"%s\",", implementation.name);
+	print_workload(&w);
+
+	if (implementation.parse)
+		printf(",\"parse_ns_per_payload\":%.1f",
+		       (parsed_at - start) / w.count);
+	else
+		printf(",\"parse_ns_per_payload\":null");
+
+	for (size_t i = 0; i < EVENT_COUNT; i++) {
+		if (counters[i].fd != -1)
+			printf(",\"%s\":%.2f", dispatch_events[i].key,
+			       (double) perf_counter_read(&counters[i]) /
+			       w.count);
+		else
+			printf(",\"%s\":null", dispatch_events[i].key);
+
+		perf_counter_close(&counters[i]);
+	}
+
+	printf(",\"dispatch_ns_per_payload\":%.1f"
+	       ",\"allocs_per_payload\":%.2f"
+	       ",\"baseline_rss_kb\":%ld,\"peak_rss_kb\":%ld}\n",
+	       (dispatched_at - parsed_at) / w.count,
+	       (double) allocations / w.count, baseline_rss, rss);
+
+	free(lines);
+	free(text);
+
+	return EXIT_SUCCESS;
+}
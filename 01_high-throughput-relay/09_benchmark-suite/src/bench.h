@@ -0,0 +1,61 @@
+/**
+ * @file bench.h
+ * @brief Interface every benchmarked implementation provides.
+ *
+ * The benchmark driver (bench.c) is linked once per implementation, together
+ * with that implementation's sources and a small adapter from impls/. The
+ * adapter defines `implementation`, which maps the driver's two phases onto
+ * whatever API the implementation has.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Hooks of a benchmarked implementation.
+ *
+ * Lines are null-terminated, without newlines, and may be modified.
+ */
+struct implementation {
+	const char *name;  /**< Reported in the JSON output */
+
+	/**
+	 * @brief Parses every line, timed as the parse phase.
+	 *
+	 * NULL if the implementation parses and processes each payload in one
+	 * step. Then dispatch() does both, and no parse time is reported.
+	 *
+	 * @return Parsed payloads, passed to dispatch() and destroy()
+	 */
+	void *(*parse)(char **lines, size_t count);
+
+	/**
+	 * @brief Processes every payload, timed as the dispatch phase.
+	 *
+	 * Output goes to stdout, which the driver sends to /dev/null.
+	 */
+	void (*dispatch)(void *parsed, char **lines, size_t count);
+
+	/**
+	 * @brief Releases the parsed payloads, not timed. May be NULL.
+	 */
+	void (*destroy)(void *parsed);
+};
+
+/** @brief Defined by the adapter the driver is linked with. */
+extern const struct implementation implementation;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+// Writes a generated workload to stdout, e.g. to feed the relay itself:
+//
+//   ./target/generate --count 10000000 --receivers 4 > capture.txt
+
+#include "generator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int main(int argc, const char **args)
+{
+	struct workload w = WORKLOAD_DEFAULT;
+
+	if (!workload_from_args(&w, argc, args)) {
+		fprintf(stderr, "Usage: %s [--seed N] [--count N] "
+				"[--mix L,J,O,D,G,B] [--receivers N] "
+				"[--length N]\n", args[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	struct generator g;
+	char *line = malloc(max_payload_len(&w) + 1);
+
+	generator_init(&g, &w);
+
+	for (size_t i = 0; i < w.count; i++) {
+		size_t len = generate_payload(&g, line, NULL);
+
+		line[len] = '\n';
+		fwrite(line, 1, len + 1, stdout);
+	}
+
+	free(line);
+
+	return EXIT_SUCCESS;
+}
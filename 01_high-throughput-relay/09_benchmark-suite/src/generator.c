@@ -0,0 +1,220 @@
+#include "generator.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* distinct user and channel names, fewer than real traffic has but enough
+ * to defeat any caching of the last name */
+#define USER_COUNT 10000
+#define CHANNEL_COUNT 1000
+
+/* longest name, e.g. "@user9999 " or "#channel999 " */
+#define MAX_RECEIVER_LEN 12
+
+/* longest command, e.g. "/login user9999 pass9999" */
+#define MAX_COMMAND_LEN 32
+
+
+/* splitmix64, small and good enough for synthetic data */
+static uint64_t next_random(struct generator *g)
+{
+	uint64_t z = (g->state += 0x9e3779b97f4a7c15);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+	return z ^ (z >> 31);
+}
+
+static unsigned random_below(struct generator *g, unsigned bound)
+{
+	return next_random(g) % bound;
+}
+
+static bool parse_number(const char *str, uint64_t *value)
+{
+	char *end;
+
+	*value = strtoull(str, &end, 10);
+
+	return *str != '\0' && *end == '\0';
+}
+
+static bool parse_mix(const char *str, unsigned mix[KIND_COUNT])
+{
+	unsigned total = 0;
+
+	for (int i = 0; i < KIND_COUNT; i++) {
+		char *end;
+
+		mix[i] = strtoul(str, &end, 10);
+		total += mix[i];
+
+		if (end == str || *end != (i + 1 == KIND_COUNT ? '\0' : ','))
+			return false;
+
+		str = end + 1;
+	}
+
+	return total > 0;
+}
+
+bool workload_from_args(struct workload *w, int argc, const char **args)
+{
+	for (int i = 1; i < argc; i += 2) {
+		const char *option = args[i];
+		uint64_t value = 0;
+
+		if (i + 1 == argc)
+			return false;
+
+		if (strcmp(option, "--mix") == 0) {
+			if (!parse_mix(args[i + 1], w->mix))
+				return false;
+
+			continue;
+		}
+
+		if (!parse_number(args[i + 1], &value))
+			return false;
+
+		if (strcmp(option, "--seed") == 0)
+			w->seed = value;
+		else if (strcmp(option, "--count") == 0 && value > 0)
+			w->count = value;
+		else if (strcmp(option, "--receivers") == 0 && value > 0)
+			w->receivers = value;
+		else if (strcmp(option, "--length") == 0 && value > 0)
+			w->message_len = value;
+		else
+			return false;
+	}
+
+	return true;
+}
+
+void print_workload(const struct workload *w)
+{
+	printf("\"seed\":%" PRIu64 ",\"payloads\":%zu,"
+	       "\"mix\":[%u,%u,%u,%u,%u,%u],"
+	       "\"receivers\":%u,\"message_len\":%u",
+	       w->seed, w->count,
+	       w->mix[0], w->mix[1], w->mix[2],
+	       w->mix[3], w->mix[4], w->mix[5],
+	       w->receivers, w->message_len);
+}
+
+void generator_init(struct generator *g, const struct workload *w)
+{
+	g->workload = *w;
+	g->state = w->seed;
+	g->total_weight = 0;
+
+	for (int i = 0; i < KIND_COUNT; i++)
+		g->total_weight += w->mix[i];
+
+	assert(g->total_weight > 0);
+}
+
+size_t max_payload_len(const struct workload *w)
+{
+	size_t message = (size_t) w->receivers * MAX_RECEIVER_LEN +
+			 w->message_len;
+
+	return message > MAX_COMMAND_LEN ? message : MAX_COMMAND_LEN;
+}
+
+static enum workload_kind random_kind(struct generator *g)
+{
+	unsigned pick = random_below(g, g->total_weight);
+	int kind = 0;
+
+	while (pick >= g->workload.mix[kind])
+		pick -= g->workload.mix[kind++];
+
+	return kind;
+}
+
+/* lowercase words separated by single spaces, never starting with a
+ * receiver prefix */
+static size_t random_content(struct generator *g, char *out)
+{
+	unsigned len = g->workload.message_len;
+
+	for (unsigned i = 0; i < len; i++)
+		out[i] = 'a' + random_below(g, 26);
+
+	for (unsigned i = 6; i + 1 < len; i += 7)
+		out[i] = ' ';
+
+	return len;
+}
+
+size_t generate_payload(struct generator *g, char *out,
+			enum workload_kind *kind_out)
+{
+	enum workload_kind kind = random_kind(g);
+	size_t len = 0;
+	unsigned user, password;
+
+	switch (kind) {
+	case KIND_LOGIN:
+		// evaluation order of arguments is unspecified, draw first
+		user = random_below(g, USER_COUNT);
+		password = random_below(g, USER_COUNT);
+
+		len = sprintf(out, "/login user%u pass%u", user, password);
+		break;
+	case KIND_JOIN:
+		len = sprintf(out, "/join channel%u",
+			      random_below(g, CHANNEL_COUNT));
+		break;
+	case KIND_LOGOUT:
+		len = sprintf(out, "/logout");
+		break;
+	case KIND_DIRECT:
+	case KIND_GROUP:
+		for (unsigned i = 0; i < g->workload.receivers; i++)
+			len += kind == KIND_DIRECT ?
+				sprintf(out + len, "@user%u ",
+					random_below(g, USER_COUNT)) :
+				sprintf(out + len, "#channel%u ",
+					random_below(g, CHANNEL_COUNT));
+		[[fallthrough]];
+	case KIND_GLOBAL:
+		len += random_content(g, out + len);
+		out[len] = '\0';
+		break;
+	default:
+		assert(false);
+	}
+
+	if (kind_out)
+		*kind_out = kind;
+
+	return len;
+}
+
+char *generate_payloads(const struct workload *w, size_t *size)
+{
+	struct generator g;
+	size_t line_cap = max_payload_len(w) + 1;
+
+	generator_init(&g, w);
+
+	// +1 for the newline of the last line
+	char *text = malloc(line_cap * w->count + 1);
+	assert(text);
+
+	*size = 0;
+	for (size_t i = 0; i < w->count; i++) {
+		*size += generate_payload(&g, text + *size, NULL);
+		text[(*size)++] = '\n';
+	}
+
+	return text;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file generator.h
+ * @brief Seeded generator of synthetic payloads.
+ *
+ * The same workload (seed, mix, receivers, message length) always produces
+ * the same payloads, so different implementations can be compared on
+ * exactly the same input.
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Kinds of payloads the generator produces.
+ */
+enum workload_kind {
+	KIND_LOGIN,   /**< /login <user> <password> */
+	KIND_JOIN,    /**< /join <channel> */
+	KIND_LOGOUT,  /**< /logout */
+	KIND_DIRECT,  /**< @user ... <content> */
+	KIND_GROUP,   /**< #channel ... <content> */
+	KIND_GLOBAL,  /**< <content> */
+	KIND_COUNT
+};
+
+/**
+ * @brief Shape of the generated input.
+ */
+struct workload {
+	uint64_t seed;              /**< Same seed, same payloads */
+	size_t count;               /**< Number of payloads */
+	unsigned mix[KIND_COUNT];   /**< Relative weight of each kind */
+	unsigned receivers;         /**< Receivers of direct/group messages */
+	unsigned message_len;       /**< Length of message contents */
+};
+
+/** @brief Default workload, mostly messages, like real traffic. */
+#define WORKLOAD_DEFAULT ((struct workload) {                  \
+	.seed = 1,                                             \
+	.count = 1000000,                                      \
+	.mix = { 1, 1, 1, 4, 2, 1 },                           \
+	.receivers = 1,                                        \
+	.message_len = 32,                                     \
+})
+
+/**
+ * @brief Generator state.
+ */
+struct generator {
+	struct workload workload;
+	uint64_t state;          /**< Random number generator state */
+	unsigned total_weight;   /**< Sum of the mix */
+};
+
+/**
+ * @brief Reads workload options from the command line.
+ *
+ * Options: `--seed N`, `--count N`, `--mix L,J,O,D,G,B` (weights of login,
+ * join, logout, direct, group and global), `--receivers N`, `--length N`.
+ * Options not given keep their value in w.
+ *
+ * @return false on an unknown option or an invalid value
+ */
+bool workload_from_args(struct workload *w, int argc, const char **args);
+
+/**
+ * @brief Prints the workload as JSON object members, without braces.
+ */
+void print_workload(const struct workload *w);
+
+/**
+ * @param w Workload, at least one kind must have a non-zero weight
+ */
+void generator_init(struct generator *g, const struct workload *w);
+
+/**
+ * @brief Upper bound of the length of a generated payload.
+ */
+size_t max_payload_len(const struct workload *w);
+
+/**
+ * @brief Writes the next payload into out, null-terminated, no newline.
+ *
+ * @param out Buffer of at least max_payload_len() + 1 bytes
+ * @param kind Output for the kind of the payload, may be NULL
+ * @return Length of the payload
+ */
+size_t generate_payload(struct generator *g, char *out,
+			enum workload_kind *kind);
+
+/**
+ * @brief Generates every payload of the workload, one per line.
+ *
+ * @param w Workload
+ * @param size Output for the size of the text
+ * @return Heap allocated text, every line ends with a newline
+ */
+char *generate_payloads(const struct workload *w, size_t *size);
+
+
+#endif
@@ -0,0 +1,60 @@
+#include "perf_counter.h"
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+bool perf_counter_open(struct perf_counter *c, uint32_t type,
+		       uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	// glibc has no wrapper for this system call
+	c->fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+	return c->fd != -1;
+}
+
+void perf_counter_start(struct perf_counter *c)
+{
+	if (c->fd == -1)
+		return;
+
+	ioctl(c->fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(c->fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void perf_counter_stop(struct perf_counter *c)
+{
+	if (c->fd != -1)
+		ioctl(c->fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+uint64_t perf_counter_read(const struct perf_counter *c)
+{
+	uint64_t value = 0;
+
+	if (c->fd == -1 || read(c->fd, &value, sizeof(value)) != sizeof(value))
+		return 0;
+
+	return value;
+}
+
+void perf_counter_close(struct perf_counter *c)
+{
+	if (c->fd != -1)
+		close(c->fd);
+
+	c->fd = -1;
+}
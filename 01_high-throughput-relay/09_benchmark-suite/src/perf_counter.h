@@ -0,0 +1,48 @@
+/**
+ * @file perf_counter.h
+ * @brief Hardware event counters of the CPU, through perf_event_open(2).
+ *
+ * Counters are not available everywhere: virtual machines often hide them,
+ * and kernel.perf_event_paranoid may forbid them. Callers must be ready for
+ * perf_counter_open() to fail.
+ */
+
+#ifndef PERF_COUNTER_H
+#define PERF_COUNTER_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/**
+ * @brief A counter of this thread, in user space only.
+ */
+struct perf_counter {
+	int fd;  /**< -1 if the counter could not be opened */
+};
+
+/**
+ * @brief Opens a stopped counter.
+ *
+ * @param c Counter to open
+ * @param type e.g. PERF_TYPE_HARDWARE
+ * @param config e.g. PERF_COUNT_HW_BRANCH_MISSES
+ * @return false if the event is not available
+ */
+bool perf_counter_open(struct perf_counter *c, uint32_t type,
+		       uint64_t config);
+
+/** @brief Resets the counter to zero and starts counting. */
+void perf_counter_start(struct perf_counter *c);
+
+/** @brief Stops counting, the value is kept. */
+void perf_counter_stop(struct perf_counter *c);
+
+/** @brief Events counted between start and stop. */
+uint64_t perf_counter_read(const struct perf_counter *c);
+
+void perf_counter_close(struct perf_counter *c);
+
+
+#endif
@@ -0,0 +1,137 @@
+// Counts allocations made by Exercise 04's String while containers grow and
+// while a message is fanned out, and prints one JSON object per scenario:
+//
+//   ./target/string-growth --count 100000
+//
+// A vector that runs out of room allocates a larger array and relocates its
+// elements. Elements that cannot move without throwing are copied instead,
+// and copying a long String allocates.
+
+#include "alloc_counter.h"
+#include "payload.hpp"
+#include "string.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+using std::vector, std::cout;
+
+
+/* LoginCommand, as it was before String could move: vectors copy it */
+struct CopiedLogin {
+    CopiedLogin(const char *username, const char *password)
+        : command { username, password } {}
+
+    CopiedLogin(const CopiedLogin &other) = default;
+
+    LoginCommand command;
+};
+
+static double now_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void print_result(const char *scenario, size_t count,
+                         size_t allocations, double ns) {
+    printf("{\"scenario\":\"%s\",\"elements\":%zu"
+           ",\"allocs_per_element\":%.2f,\"ns_per_element\":%.1f}\n",
+           scenario, count, (double) allocations / count, ns / count);
+}
+
+/* appends count logins to a vector that starts empty, no reserve */
+template <typename Login>
+static void measure_growth(const char *scenario, size_t count,
+                           const char *username, const char *password) {
+    size_t allocations = allocation_count();
+    double start = now_ns();
+
+    {
+        vector<Login> logins;
+
+        for (size_t i = 0; i < count; i++)
+            logins.emplace_back(username, password);
+    }
+
+    print_result(scenario, count, allocation_count() - allocations,
+                 now_ns() - start);
+}
+
+/* delivers count messages to receivers receivers each */
+static void measure_fanout(const char *scenario, size_t count,
+                           size_t receivers, bool shared) {
+    const char *content =
+        "a message long enough to be stored on the heap, for every receiver";
+    vector<String> inboxes;
+
+    inboxes.reserve(receivers);
+
+    size_t allocations = allocation_count();
+    double start = now_ns();
+
+    for (size_t i = 0; i < count; i++) {
+        String message = shared ? String::shared(content) : String { content };
+
+        for (size_t j = 0; j < receivers; j++)
+            inboxes.push_back(message);
+
+        inboxes.clear();
+    }
+
+    print_result(scenario, count, allocation_count() - allocations,
+                 now_ns() - start);
+}
+
+
+int main(int argc, const char **args) {
+    size_t count = 100000;
+    size_t receivers = 16;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(args[i], "--count") == 0) {
+            count = strtoul(args[i + 1], nullptr, 10);
+        } else if (strcmp(args[i], "--receivers") == 0) {
+            receivers = strtoul(args[i + 1], nullptr, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [--count N] [--receivers N]\n",
+                    args[0]);
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (argc % 2 == 0 || count == 0) {
+        fprintf(stderr, "Usage: %s [--count N] [--receivers N]\n", args[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    // String prints every construction and destruction, a stream without a
+    // buffer drops them
+    std::streambuf *saved = cout.rdbuf(nullptr);
+
+    // both fields longer than String::INLINE_CAPACITY, then both shorter
+    const char *username = "alice.with.a.long.username";
+    const char *password = "and-an-even-longer-password";
+
+    measure_growth<CopiedLogin>("login_growth_copy", count, username,
+                                password);
+    measure_growth<LoginCommand>("login_growth_move", count, username,
+                                 password);
+    measure_growth<LoginCommand>("login_growth_move_inline", count, "alice",
+                                 "s3cr3t");
+
+    measure_fanout("fanout_deep_copy", count, receivers, false);
+    measure_fanout("fanout_shared", count, receivers, true);
+
+    cout.rdbuf(saved);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include "../src/generator.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int main()
+{
+	struct workload w = WORKLOAD_DEFAULT;
+	w.count = 10000;
+
+	// same seed, same payloads
+	size_t size_a, size_b;
+	char *a = generate_payloads(&w, &size_a);
+	char *b = generate_payloads(&w, &size_b);
+
+	assert(size_a == size_b && memcmp(a, b, size_a) == 0);
+
+	free(b);
+	w.seed = 2;
+	b = generate_payloads(&w, &size_b);
+	assert(size_a != size_b || memcmp(a, b, size_a) != 0);
+
+	free(a);
+	free(b);
+
+	// only kinds with a weight appear, receivers and length as requested
+	const char *args[] = {
+		"generate", "--mix", "0,0,0,1,1,0", "--receivers", "3",
+		"--length", "20",
+	};
+	assert(workload_from_args(&w, sizeof(args) / sizeof(char *), args));
+
+	struct generator g;
+	char *line = malloc(max_payload_len(&w) + 1);
+	size_t seen[KIND_COUNT] = { 0 };
+
+	generator_init(&g, &w);
+	for (int i = 0; i < 1000; i++) {
+		enum workload_kind kind;
+		size_t len = generate_payload(&g, line, &kind);
+		char prefix = kind == KIND_DIRECT ? '@' : '#';
+
+		assert(len == strlen(line) && len <= max_payload_len(&w));
+		seen[kind]++;
+
+		char *content = line;
+		for (int r = 0; r < 3; r++) {
+			assert(content[0] == prefix);
+			content = strchr(content, ' ') + 1;
+		}
+
+		assert(strlen(content) == 20);
+		assert(content[0] != '@' && content[0] != '#');
+	}
+
+	assert(seen[KIND_DIRECT] > 0 && seen[KIND_GROUP] > 0);
+	assert(seen[KIND_DIRECT] + seen[KIND_GROUP] == 1000);
+
+	free(line);
+
+	const char *invalid[][3] = {
+		{ "generate", "--mix", "1,1" },
+		{ "generate", "--mix", "0,0,0,0,0,0" },
+		{ "generate", "--count", "many" },
+		{ "generate", "--unknown", "1" },
+	};
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+		assert(!workload_from_args(&w, 3, invalid[i]));
+
+	return EXIT_SUCCESS;
+}
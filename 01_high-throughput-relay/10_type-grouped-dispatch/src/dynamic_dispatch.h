@@ -0,0 +1,103 @@
+/**
+ * @file dynamic_dispatch.h
+ * @brief Payload buffer whose payloads live in an arena.
+ */
+
+
+#ifndef DYNAMIC_DISPATCH_H
+#define DYNAMIC_DISPATCH_H
+
+
+#include "arena.h"
+#include "output_sink.h"
+
+#include <stddef.h>
+
+
+/** @brief Payloads grouped by type at once by process_batch(). */
+#define BATCH_WINDOW 256
+
+
+struct payload_buffer {
+	struct payload *payloads;
+	size_t len;
+	size_t cap;
+	size_t process_base;
+	struct arena arena;  /**< Fields of every payload in the buffer */
+};
+
+
+struct payload_buffer *new_buffer();
+
+/**
+ * @brief Parses and adds a payload to the buffer.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param raw Line view, e.g. pointing into a mapped file
+ * @param len Length of the line, without the newline
+ *
+ * @note Fields of the payload are allocated from the buffer's arena.
+ */
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len);
+
+/**
+ * @brief Moves every payload of other to the end of buf, and frees other.
+ *
+ * Payload fields are not copied: other's arena is handed over to buf.
+ *
+ * @param buf Pointer to the payload buffer to append to
+ * @param other Buffer to empty, it must not have been processed yet
+ */
+void append_buffer(struct payload_buffer *buf, struct payload_buffer *other);
+
+/**
+ * @brief Output of a batch, payload by payload.
+ */
+struct batch_output {
+	struct output_sink scratch;    /**< Memory sink, in processing order */
+	size_t count;                  /**< Payloads in the batch */
+	size_t start[BATCH_WINDOW];    /**< Offset of each output in scratch */
+	size_t len[BATCH_WINDOW];      /**< Length of each output */
+};
+
+/**
+ * @brief Processes the next payload of the buffer.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param out Sink the output is appended to, flushed by the caller
+ */
+void process_next(struct payload_buffer *buf, struct output_sink *out);
+
+void batch_output_init(struct batch_output *b);
+
+void batch_output_destroy(struct batch_output *b);
+
+/**
+ * @brief Processes the next BATCH_WINDOW payloads (or fewer, if the buffer
+ *        has fewer left), grouped by type.
+ *
+ * Payloads of the same type are processed together, in a loop that calls
+ * their process method directly instead of through the vtable. Output of
+ * each payload is kept apart in b, to be emitted in arrival order:
+ *
+ *     for (size_t i = 0; i < b.count; i++)
+ *             sink_write(out, b.scratch.buf + b.start[i], b.len[i]);
+ *
+ * @param buf Pointer to the payload buffer
+ * @param b Output of the batch, overwritten
+ * @return Number of payloads processed, 0 if none were left
+ */
+size_t process_batch(struct payload_buffer *buf, struct batch_output *b);
+
+/**
+ * @brief Frees the buffer and all of its payloads.
+ *
+ * Payloads are not destroyed one by one, the arena is released as a whole:
+ * one free() per arena chunk instead of several per payload.
+ *
+ * @param buf Pointer to the payload buffer to destroy
+ */
+void destroy(struct payload_buffer *buf);
+
+
+#endif
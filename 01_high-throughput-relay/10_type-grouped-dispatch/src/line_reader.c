@@ -0,0 +1,98 @@
+#include "line_reader.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+void line_reader_init(struct line_reader *r, int fd, size_t chunk_size)
+{
+	*r = (struct line_reader) {
+		.fd = fd,
+		.cap = chunk_size,
+	};
+
+	r->buf = malloc(sizeof(char) * chunk_size);
+	assert(r->buf);
+}
+
+/* moves the unfinished line to the front of the buffer and reads after it */
+static bool refill(struct line_reader *r)
+{
+	if (r->eof)
+		return false;
+
+	// The only copy in the reader: a line that crosses the end of the
+	// chunk. If the previous chunk ended exactly at a newline, nothing is
+	// moved.
+	if (r->begin > 0) {
+		size_t partial = r->end - r->begin;
+
+		memmove(r->buf, r->buf + r->begin, partial);
+		r->scanned -= r->begin;
+		r->end = partial;
+		r->begin = 0;
+	}
+
+	// a single line fills the whole buffer, make room for the rest of it
+	if (r->end == r->cap) {
+		r->cap *= 2;
+		assert((r->buf = realloc(r->buf, sizeof(char) * r->cap)));
+	}
+
+	ssize_t n;
+	do {
+		n = read(r->fd, r->buf + r->end, r->cap - r->end);
+	} while (n == -1 && errno == EINTR);
+
+	if (n <= 0) {
+		// read errors end the stream just like end of file does
+		r->eof = true;
+		return false;
+	}
+
+	r->end += n;
+
+	return true;
+}
+
+bool read_line(struct line_reader *r, struct line_view *line)
+{
+	do {
+		char *newline = memchr(r->buf + r->scanned, '\n',
+				       r->end - r->scanned);
+
+		if (newline != NULL) {
+			*line = (struct line_view) {
+				.ptr = r->buf + r->begin,
+				.len = newline - (r->buf + r->begin),
+			};
+			r->begin = r->scanned = newline - r->buf + 1;
+
+			return true;
+		}
+
+		// no newline in what we have, do not search these bytes again
+		r->scanned = r->end;
+	} while (refill(r));
+
+	if (r->begin == r->end)
+		return false;
+
+	// last line, without a trailing newline
+	*line = (struct line_view) {
+		.ptr = r->buf + r->begin,
+		.len = r->end - r->begin,
+	};
+	r->begin = r->scanned = r->end;
+
+	return true;
+}
+
+void line_reader_destroy(struct line_reader *r)
+{
+	free(r->buf);
+	r->buf = NULL;
+}
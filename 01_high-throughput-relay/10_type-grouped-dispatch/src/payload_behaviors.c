@@ -0,0 +1,145 @@
+// "behavioral" functions
+//
+// Processors append to an output sink instead of calling printf: no format
+// string to parse, no stdio locking, and the output of a whole batch reaches
+// the terminal or file with a single write().
+
+#include "output_sink.h"
+#include "payload.h"
+
+#include <stdlib.h>
+
+
+void process_command_login(const struct payload *self,
+			   struct output_sink *out)
+{
+	sink_literal(out, "Command: login\n  Arguments: [username: ");
+	sink_string(out, self->data.command_login.username);
+	sink_literal(out, ", password ");
+	sink_string(out, self->data.command_login.password);
+	sink_literal(out, "]\n");
+}
+
+void process_command_join(const struct payload *self, struct output_sink *out)
+{
+	sink_literal(out, "Command: join\n  Arguments: [channel: ");
+	sink_string(out, self->data.command_join.channel);
+	sink_literal(out, "]\n");
+}
+
+void process_command_logout([[maybe_unused]] const struct payload *self,
+			    struct output_sink *out)
+{
+	sink_literal(out, "Command: logout\n  Arguments: []\n");
+}
+
+void process_message(const struct payload *self, struct output_sink *out)
+{
+	struct message_receiving_entity *receivers = \
+		self->data.message.receivers;
+
+	for (int i = 0; i < self->data.message.receiver_count; i++)
+		receivers[i].vtable->transmit_message(&receivers[i],
+						      self->data.message.content,
+						      out);
+}
+
+void transmit_direct_message(const struct message_receiving_entity *self,
+			     const char *content, struct output_sink *out)
+{
+	sink_literal(out, "Direct message to ");
+	sink_string(out, self->additional_info);
+	sink_literal(out, ": ");
+	sink_string(out, content);
+	sink_literal(out, "\n");
+}
+
+void transmit_group_message(const struct message_receiving_entity *self,
+			    const char *content, struct output_sink *out)
+{
+	sink_literal(out, "Group message to ");
+	sink_string(out, self->additional_info);
+	sink_literal(out, ": ");
+	sink_string(out, content);
+	sink_literal(out, "\n");
+}
+
+void transmit_global_message([[maybe_unused]] const struct message_receiving_entity *self,
+			     const char *content, struct output_sink *out)
+{
+	sink_literal(out, "Global message: ");
+	sink_string(out, content);
+	sink_literal(out, "\n");
+}
+
+void destroy_command_login(const struct payload *self)
+{
+	free(self->data.command_login.username);
+	free(self->data.command_login.password);
+}
+
+void destroy_command_join(const struct payload *self)
+{
+	free(self->data.command_join.channel);
+}
+
+void destroy_command_logout([[maybe_unused]] const struct payload *self)
+{}
+
+void destroy_message(const struct payload *self)
+{
+	struct message_receiving_entity *receivers = \
+		self->data.message.receivers;
+
+	for (int i = 0; i < self->data.message.receiver_count; i++)
+		receivers[i].vtable->destroy(&receivers[i]);
+
+	free(self->data.message.content);
+	free(receivers);
+}
+
+void destroy_global_message([[maybe_unused]] const struct message_receiving_entity *self)
+{}
+
+void destroy_group_or_direct_message(const struct message_receiving_entity *self)
+{
+	free(self->additional_info);
+}
+
+
+/* payload vtables */
+const struct payload_vtable command_login_vtable = {
+	.process = process_command_login,
+	.destroy = destroy_command_login,
+};
+
+const struct payload_vtable command_join_vtable = {
+	.process = process_command_join,
+	.destroy = destroy_command_join,
+};
+
+const struct payload_vtable command_logout_vtable = {
+	.process = process_command_logout,
+	.destroy = destroy_command_logout,
+};
+
+const struct payload_vtable message_vtable = {
+	.process = process_message,
+	.destroy = destroy_message,
+};
+
+/* receiver vtables */
+const struct message_receiving_entity_vtable direct_message_vtable = {
+	.transmit_message = transmit_direct_message,
+	.destroy = destroy_group_or_direct_message,
+};
+
+const struct message_receiving_entity_vtable group_message_vtable = {
+	.transmit_message = transmit_group_message,
+	.destroy = destroy_group_or_direct_message,
+};
+
+const struct message_receiving_entity_vtable global_message_vtable = {
+	.transmit_message = transmit_global_message,
+	.destroy = destroy_global_message,
+};
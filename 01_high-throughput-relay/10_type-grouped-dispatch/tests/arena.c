@@ -0,0 +1,75 @@
+#include "../src/arena.h"
+#include "../src/dynamic_dispatch.h"
+#include "../src/payload.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int main()
+{
+	struct arena a;
+	arena_init(&a, 64);
+
+	// every allocation is aligned like malloc's
+	for (size_t size = 1; size < 40; size++) {
+		void *ptr = arena_alloc(&a, size);
+		assert((uintptr_t) ptr % alignof(max_align_t) == 0);
+		memset(ptr, 0xff, size);
+	}
+
+	// the latest allocation grows in place
+	char *str = arena_alloc(&a, 1);
+	str[0] = 'a';
+	assert(arena_realloc(&a, str, 1, 16) == str);
+
+	// anything else is copied
+	arena_alloc(&a, 1);
+	char *moved = arena_realloc(&a, str, 16, 32);
+	assert(moved != str && moved[0] == 'a');
+
+	// larger than a chunk
+	char *huge = arena_alloc(&a, 1000);
+	memset(huge, 0, 1000);
+
+	arena_destroy(&a);
+
+	// payloads that outlive a batch are still allocated on the heap and
+	// destroyed via their vtable
+	const char *raw = "@alice @bob #general Hello everyone!";
+	struct payload p;
+
+	assert(parse_payload(&p, raw, strlen(raw), NULL));
+	assert(p.data.message.receiver_count == 3);
+	assert(strcmp(p.data.message.content, "Hello everyone!") == 0);
+	p.vtable->destroy(&p);
+
+	// the receivers array is final before the names are copied after it
+	arena_init(&a, 4096);
+	assert(parse_payload(&p, raw, strlen(raw), &a));
+
+	struct message_receiving_entity *receivers = p.data.message.receivers;
+	char *first_name = receivers[0].additional_info;
+
+	assert(first_name >= (char *) (receivers + 3));
+	assert((size_t) (first_name - (char *) (receivers + 3)) <
+	       alignof(max_align_t));
+
+	arena_destroy(&a);
+
+	// buffers release their payloads at once
+	struct payload_buffer *buf = new_buffer();
+
+	for (int i = 0; i < 10000; i++)
+		push_payload(buf, raw, strlen(raw));
+
+	assert(strcmp(buf->payloads[9999].data.message.receivers[2]
+			.additional_info, "general") == 0);
+
+	destroy(buf);
+
+	return EXIT_SUCCESS;
+}
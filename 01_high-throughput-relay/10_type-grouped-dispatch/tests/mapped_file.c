@@ -0,0 +1,59 @@
+#include "../src/mapped_file.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static void assert_line(struct mapped_file *f, const char *expected)
+{
+	struct line_view line;
+
+	assert(next_line(f, &line));
+	assert(line.len == strlen(expected));
+	assert(memcmp(line.ptr, expected, line.len) == 0);
+}
+
+int main()
+{
+	char path[] = "/tmp/mapped_file_test_XXXXXX";
+	int fd = mkstemp(path);
+	assert(fd != -1);
+
+	// a line longer than the old 1023 character limit
+	char long_line[4096];
+	memset(long_line, 'a', sizeof(long_line) - 1);
+	long_line[sizeof(long_line) - 1] = '\0';
+
+	FILE *file = fdopen(fd, "w");
+	// no trailing newline after the last line
+	fprintf(file, "/login metw pass\n\n%s\n@bob hi", long_line);
+	fclose(file);
+
+	struct mapped_file f;
+	struct line_view line;
+
+	assert(map_file(&f, path));
+	assert_line(&f, "/login metw pass");
+	assert_line(&f, "");
+	assert_line(&f, long_line);
+	assert_line(&f, "@bob hi");
+	assert(!next_line(&f, &line));
+	unmap_file(&f);
+
+	// empty files cannot be mapped, but have no lines
+	assert((file = fopen(path, "w")));
+	fclose(file);
+
+	assert(map_file(&f, path));
+	assert(!next_line(&f, &line));
+	unmap_file(&f);
+
+	unlink(path);
+
+	assert(!map_file(&f, path));
+
+	return EXIT_SUCCESS;
+}
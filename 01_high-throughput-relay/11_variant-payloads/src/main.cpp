@@ -0,0 +1,40 @@
+#include "payload_variant.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::cerr, std::ifstream, std::string, std::vector;
+
+
+int main(int argc, const char **args) {
+    if (argc != 2) {
+        cerr << "Usage: " << args[0] << " <payloads file>\n";
+
+        return EXIT_FAILURE;
+    }
+
+    ifstream file { args[1] };
+
+    if (!file) {
+        cerr << "Could not open " << args[1] << ".\n";
+
+        return EXIT_FAILURE;
+    }
+
+    // one allocation for all payloads (and a few more while it grows), not
+    // one per payload
+    vector<PayloadVariant> payloads;
+    string line;
+
+    while (std::getline(file, line))
+        if (!line.empty())
+            parse_payload(line.data(), payloads);
+
+    for (const PayloadVariant &payload : payloads)
+        process(payload);
+
+    return EXIT_SUCCESS;
+}
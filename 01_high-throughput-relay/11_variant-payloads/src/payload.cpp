@@ -0,0 +1,42 @@
+#include "payload.hpp"
+
+#include <iostream>
+
+using std::cout;
+
+
+void Command::process() {
+    cout << "Command: " << command_name << "\n";
+    process_arguments();
+}
+
+void LoginCommand::process_arguments() {
+    cout << "  Arguments: [username: " << username
+        << ", password: " << password << "]\n";
+}
+
+void JoinCommand::process_arguments() {
+    cout << "  Arguments: [channel: " << channel << "]\n";
+}
+
+void LogoutCommand::process_arguments() {
+    cout << "  Arguments: []\n";
+}
+
+
+void Message::process() {
+    process_recipient();
+    cout << content << "\n";
+}
+
+void DirectMessage::process_recipient() {
+    cout << "Direct message to " << username << ": ";
+}
+
+void GroupMessage::process_recipient() {
+    cout << "Group message to " << channel << ": ";
+}
+
+void GlobalMessage::process_recipient() {
+    cout << "Global message: ";
+}
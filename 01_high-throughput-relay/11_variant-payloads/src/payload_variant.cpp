@@ -0,0 +1,110 @@
+#include "payload_variant.hpp"
+
+#include <cstring>
+#include <iostream>
+
+using std::cout, std::vector;
+
+
+namespace values {
+
+/* Output is the same as the one of the virtual hierarchy, byte for byte. */
+void LoginCommand::process() const {
+    cout << "Command: login\n"
+        << "  Arguments: [username: " << username
+        << ", password: " << password << "]\n";
+}
+
+void JoinCommand::process() const {
+    cout << "Command: join\n"
+        << "  Arguments: [channel: " << channel << "]\n";
+}
+
+void LogoutCommand::process() const {
+    cout << "Command: logout\n"
+        << "  Arguments: []\n";
+}
+
+void DirectMessage::process() const {
+    cout << "Direct message to " << username << ": " << content << "\n";
+}
+
+void GroupMessage::process() const {
+    cout << "Group message to " << channel << ": " << content << "\n";
+}
+
+void GlobalMessage::process() const {
+    cout << "Global message: " << content << "\n";
+}
+
+}
+
+
+void process(const PayloadVariant &payload) {
+    // instantiated once per alternative, std::visit picks one by index
+    std::visit([](const auto &p) { p.process(); }, payload);
+}
+
+
+/* cuts the next space separated word out of *rest */
+static char *next_word(char **rest) {
+    return strtok_r(nullptr, " ", rest);
+}
+
+static void parse_command(char *raw, vector<PayloadVariant> &payloads) {
+    char *rest = raw + 1;
+    char *name = strtok_r(rest, " ", &rest);
+
+    if (name == nullptr)
+        return;
+
+    if (strcmp(name, "login") == 0) {
+        char *username = next_word(&rest);
+        char *password = next_word(&rest);
+
+        if (username && password)
+            payloads.emplace_back(values::LoginCommand { username, password });
+    } else if (strcmp(name, "join") == 0) {
+        if (char *channel = next_word(&rest))
+            payloads.emplace_back(values::JoinCommand { channel });
+    } else if (strcmp(name, "logout") == 0) {
+        payloads.emplace_back(values::LogoutCommand {});
+    }
+}
+
+static void parse_message(char *raw, vector<PayloadVariant> &payloads) {
+    // receivers first, then the content they all get
+    char *receivers[MAX_RECEIVERS];
+    size_t receiver_count = 0;
+
+    while ((raw[0] == '@' || raw[0] == '#') &&
+           receiver_count < MAX_RECEIVERS) {
+        char *end = strchr(raw, ' ');
+
+        if (end == nullptr)
+            return;
+
+        *end = '\0';
+        receivers[receiver_count++] = raw;
+        raw = end + 1;
+    }
+
+    if (receiver_count == 0)
+        payloads.emplace_back(values::GlobalMessage { raw });
+
+    for (size_t i = 0; i < receiver_count; i++) {
+        if (receivers[i][0] == '@')
+            payloads.emplace_back(
+                values::DirectMessage { raw, receivers[i] + 1 });
+        else
+            payloads.emplace_back(
+                values::GroupMessage { raw, receivers[i] + 1 });
+    }
+}
+
+void parse_payload(char *raw, vector<PayloadVariant> &payloads) {
+    if (raw[0] == '/')
+        parse_command(raw, payloads);
+    else
+        parse_message(raw, payloads);
+}
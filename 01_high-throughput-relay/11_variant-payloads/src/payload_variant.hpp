@@ -0,0 +1,95 @@
+/**
+ * @file payload_variant.hpp
+ * @brief Value-semantic payloads, dispatched with std::visit.
+ *
+ * The same six payload types as payload.hpp, without a base class: a
+ * PayloadVariant holds any one of them by value, so a vector of payloads is
+ * a single contiguous allocation.
+ */
+
+#ifndef PAYLOAD_VARIANT_HPP
+#define PAYLOAD_VARIANT_HPP
+
+
+#include <cstddef>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+/* The virtual hierarchy already uses these names. */
+namespace values {
+
+/* Command types ----------------------------------------------------------- */
+struct LoginCommand {
+    std::string username;
+    std::string password;
+
+    void process() const;
+};
+
+struct JoinCommand {
+    std::string channel;
+
+    void process() const;
+};
+
+struct LogoutCommand {
+    void process() const;
+};
+
+/* Message types ----------------------------------------------------------- */
+struct DirectMessage {
+    std::string content;
+    std::string username;
+
+    void process() const;
+};
+
+struct GroupMessage {
+    std::string content;
+    std::string channel;
+
+    void process() const;
+};
+
+struct GlobalMessage {
+    std::string content;
+
+    void process() const;
+};
+
+}
+
+
+/**
+ * @brief Any payload, by value.
+ *
+ * As large as the largest alternative plus a type index. Which process() to
+ * call is decided by std::visit from the index, there is no vtable.
+ */
+using PayloadVariant = std::variant<
+    values::LoginCommand, values::JoinCommand, values::LogoutCommand,
+    values::DirectMessage, values::GroupMessage, values::GlobalMessage>;
+
+/**
+ * @brief Processes a payload, whatever its alternative is.
+ */
+void process(const PayloadVariant &payload);
+
+/** @brief Receivers of a message, further @/# words belong to the content. */
+constexpr size_t MAX_RECEIVERS = 64;
+
+/**
+ * @brief Parses a line and appends its payloads to payloads.
+ *
+ * A message to several receivers becomes one payload per receiver, since
+ * every message type has exactly one recipient. Invalid lines add nothing.
+ *
+ * @param raw One line, without the newline, modified while parsing
+ * @param payloads Vector to append to
+ */
+void parse_payload(char *raw, std::vector<PayloadVariant> &payloads);
+
+
+#endif
@@ -0,0 +1,77 @@
+#include "../src/payload.hpp"
+#include "../src/payload_variant.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::cout, std::make_unique, std::string, std::unique_ptr, std::vector;
+
+
+/* everything f writes to cout */
+template <typename F>
+static string capture(F f) {
+    std::ostringstream captured;
+    std::streambuf *original = cout.rdbuf(captured.rdbuf());
+
+    f();
+    cout.rdbuf(original);
+
+    return captured.str();
+}
+
+int main() {
+    vector<unique_ptr<Payload>> virtual_payloads;
+    virtual_payloads.push_back(make_unique<LoginCommand>("alice", "pass123"));
+    virtual_payloads.push_back(make_unique<JoinCommand>("general"));
+    virtual_payloads.push_back(make_unique<DirectMessage>("Hello everyone!", "alice"));
+    virtual_payloads.push_back(make_unique<DirectMessage>("Hello everyone!", "bob"));
+    virtual_payloads.push_back(make_unique<GroupMessage>("Check this out!", "general"));
+    virtual_payloads.push_back(make_unique<GroupMessage>("Check this out!", "random"));
+    virtual_payloads.push_back(make_unique<GlobalMessage>("Global message to all"));
+    virtual_payloads.push_back(make_unique<LogoutCommand>());
+
+    const char *lines[] = {
+        "/login alice pass123",
+        "/join general",
+        "@alice @bob Hello everyone!",
+        "#general #random Check this out!",
+        "Global message to all",
+        "/logout",
+        // invalid, nothing is added
+        "/unknown command",
+        "/login alice",
+        "@nobody",
+    };
+
+    vector<PayloadVariant> variant_payloads;
+
+    for (const char *line : lines) {
+        string copy = line;
+        parse_payload(copy.data(), variant_payloads);
+    }
+
+    assert(variant_payloads.size() == virtual_payloads.size());
+    assert(std::holds_alternative<values::DirectMessage>(variant_payloads[3]));
+    assert(std::get<values::DirectMessage>(variant_payloads[3]).username == "bob");
+
+    string expected = capture([&] {
+        for (auto &payload : virtual_payloads)
+            payload->process();
+    });
+    string actual = capture([&] {
+        for (const PayloadVariant &payload : variant_payloads)
+            process(payload);
+    });
+
+    // same output as the virtual hierarchy, byte for byte
+    assert(!expected.empty());
+    assert(actual == expected);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include "dynamic_dispatch.h"
+#include "payload.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+struct payload_buffer *new_buffer()
+{
+	struct payload_buffer *buf = malloc(sizeof(struct payload_buffer));
+	assert(buf);
+
+	buf->process_base = buf->len = 0;
+	buf->cap = 1;
+	buf->payloads = malloc(sizeof(struct payload));
+	assert(buf->payloads);
+
+	arena_init(&buf->arena, ARENA_CHUNK_SIZE);
+
+	return buf;
+}
+
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len)
+{
+	struct payload parsed;
+
+	bool is_parsing_successful = parse_payload(&parsed, raw, len,
+						   &buf->arena);
+
+	if (is_parsing_successful) {
+		if (buf->cap == buf->len) {
+			buf->cap *= 2;
+			buf->payloads = realloc(buf->payloads,
+			   buf->cap * sizeof(struct payload));
+
+			assert(buf->payloads);
+		}
+
+		buf->payloads[buf->len++] = parsed;
+	}
+}
+
+void append_buffer(struct payload_buffer *buf, struct payload_buffer *other)
+{
+	assert(other->process_base == 0);
+
+	if (buf->cap < buf->len + other->len) {
+		while (buf->cap < buf->len + other->len)
+			buf->cap *= 2;
+
+		buf->payloads = realloc(buf->payloads,
+					buf->cap * sizeof(struct payload));
+		assert(buf->payloads);
+	}
+
+	memcpy(&buf->payloads[buf->len], other->payloads,
+	       other->len * sizeof(struct payload));
+	buf->len += other->len;
+
+	arena_adopt(&buf->arena, &other->arena);
+
+	free(other->payloads);
+	free(other);
+}
+
+void process_next(struct payload_buffer *buf, struct output_sink *out)
+{
+	assert(buf->process_base < buf->len);
+
+	struct payload *p = &buf->payloads[buf->process_base];
+	p->vtable->process(p, out);
+
+	buf->process_base += 1;
+}
+
+// Payload types known to process_batch(), each processed by a loop of its
+// own. Payloads of other types share the generic loop, through their vtable.
+//
+// X(name), with name_vtable and process_name defined in payload_behaviors.c
+#define BATCH_TYPES(X)          \
+	X(command_login)        \
+	X(command_join)         \
+	X(command_logout)       \
+	X(message)
+
+#define BATCH_BUCKET(name) BUCKET_##name,
+
+enum batch_bucket {
+	BATCH_TYPES(BATCH_BUCKET)
+	BUCKET_GENERIC,
+	BUCKET_COUNT
+};
+
+void batch_output_init(struct batch_output *b)
+{
+	sink_init(&b->scratch, SINK_MEMORY, OUTPUT_SINK_SIZE);
+	b->count = 0;
+}
+
+void batch_output_destroy(struct batch_output *b)
+{
+	sink_destroy(&b->scratch);
+}
+
+static enum batch_bucket bucket_of(const struct payload *p)
+{
+#define BATCH_CLASSIFY(name)                    \
+	if (p->vtable == &name##_vtable)        \
+		return BUCKET_##name;
+
+	BATCH_TYPES(BATCH_CLASSIFY)
+
+	return BUCKET_GENERIC;
+}
+
+size_t process_batch(struct payload_buffer *buf, struct batch_output *b)
+{
+	struct payload *window = &buf->payloads[buf->process_base];
+	size_t count = buf->len - buf->process_base;
+
+	if (count > BATCH_WINDOW)
+		count = BATCH_WINDOW;
+
+	// counting sort of the window by bucket, stable
+	unsigned char buckets[BATCH_WINDOW];
+	size_t bucket_start[BUCKET_COUNT + 1] = { 0 };
+	size_t order[BATCH_WINDOW];
+
+	for (size_t i = 0; i < count; i++) {
+		buckets[i] = bucket_of(&window[i]);
+		bucket_start[buckets[i] + 1]++;
+	}
+
+	for (int k = 0; k < BUCKET_COUNT; k++)
+		bucket_start[k + 1] += bucket_start[k];
+
+	size_t fill[BUCKET_COUNT];
+	memcpy(fill, bucket_start, sizeof(fill));
+
+	for (size_t i = 0; i < count; i++)
+		order[fill[buckets[i]]++] = i;
+
+	struct output_sink *out = &b->scratch;
+	out->len = 0;
+
+	// one homogeneous loop per bucket, the call target never changes
+#define BATCH_LOOP(name)                                                \
+	for (size_t j = bucket_start[BUCKET_##name];                   \
+	     j < bucket_start[BUCKET_##name + 1]; j++) {               \
+		size_t i = order[j];                                    \
+									\
+		b->start[i] = out->len;                                 \
+		process_##name(&window[i], out);                        \
+		b->len[i] = out->len - b->start[i];                     \
+	}
+
+	BATCH_TYPES(BATCH_LOOP)
+
+	for (size_t j = bucket_start[BUCKET_GENERIC];
+	     j < bucket_start[BUCKET_GENERIC + 1]; j++) {
+		size_t i = order[j];
+
+		b->start[i] = out->len;
+		window[i].vtable->process(&window[i], out);
+		b->len[i] = out->len - b->start[i];
+	}
+
+	b->count = count;
+	buf->process_base += count;
+
+	return count;
+}
+
+void destroy(struct payload_buffer *buf)
+{
+	// no vtable->destroy calls, every field lives in the arena
+	arena_destroy(&buf->arena);
+
+	free(buf->payloads);
+	free(buf);
+}
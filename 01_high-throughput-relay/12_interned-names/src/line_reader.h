@@ -0,0 +1,67 @@
+/**
+ * @file line_reader.h
+ * @brief Chunked line reader for streams that can not be memory-mapped.
+ *
+ * Reads large chunks from a file descriptor into a reusable buffer and hands
+ * out lines as views into that buffer. Bytes are only moved when a line
+ * crosses the end of a chunk.
+ */
+
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+
+#include "line_view.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/** @brief Default chunk size, 1 MiB. */
+#define LINE_READER_CHUNK_SIZE (1 << 20)
+
+/**
+ * @brief Streaming line reader state.
+ *
+ * The unconsumed part of the input lives in `buf[begin, end)`. Bytes in
+ * `buf[begin, scanned)` are already known not to contain a newline, so a
+ * line spanning several refills is never searched twice.
+ */
+struct line_reader {
+	int fd;          /**< Source, not owned */
+	char *buf;       /**< Reusable chunk buffer */
+	size_t cap;      /**< Size of buf, grows for lines longer than it */
+	size_t begin;    /**< Start of the next line */
+	size_t scanned;  /**< End of the newline-free prefix of next line */
+	size_t end;      /**< End of valid bytes in buf */
+	bool eof;        /**< Source reached end of file */
+};
+
+/**
+ * @brief Initializes a reader on an already opened file descriptor.
+ *
+ * @param r Reader to initialize
+ * @param fd File descriptor to read from, e.g. STDIN_FILENO
+ * @param chunk_size Initial buffer size, LINE_READER_CHUNK_SIZE is a good
+ *        default
+ */
+void line_reader_init(struct line_reader *r, int fd, size_t chunk_size);
+
+/**
+ * @brief Reads the next line.
+ *
+ * @param r Reader
+ * @param line Output, view into the reader's buffer
+ * @return false on end of file (or read error)
+ *
+ * @note The view is only valid until the next read_line() call.
+ */
+bool read_line(struct line_reader *r, struct line_view *line);
+
+/**
+ * @brief Frees the buffer. Does not close the file descriptor.
+ */
+void line_reader_destroy(struct line_reader *r);
+
+
+#endif
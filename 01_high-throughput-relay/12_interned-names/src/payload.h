@@ -0,0 +1,98 @@
+/**
+ * @file payload.h
+ * @brief Payload methods.
+ */
+
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+struct output_sink;
+
+struct message_receiving_entity {
+	const struct message_receiving_entity_vtable *vtable;
+	uint32_t name;  /**< Interned username or channel, see intern.h */
+};
+
+struct message_receiving_entity_vtable {
+	void (*transmit_message)(const struct message_receiving_entity *self,
+				 const char *content, struct output_sink *out);
+	void (*destroy)(const struct message_receiving_entity *self);
+};
+
+union payload_data {
+	// names are interned, passwords are not: they are not shared, and
+	// must not outlive the payload
+	struct {
+		uint32_t username;
+		char *password;
+	} command_login;
+
+	struct {
+		uint32_t channel;
+	} command_join;
+
+	struct {
+		struct message_receiving_entity *receivers;
+		char *content;
+		int receiver_count;
+	} message;
+};
+
+struct payload {
+	const struct payload_vtable *vtable;
+	union payload_data data;
+};
+
+struct payload_vtable {
+	void (*process)(const struct payload *self, struct output_sink *out);
+	void (*destroy)(const struct payload *self);
+};
+
+
+struct arena;
+
+/**
+ * @brief Constructor method sets up vtable and data fields of payloads.
+ *
+ * @param p Output for parsed payload
+ * @param raw Raw payload, not necessarily null-terminated
+ * @param len Length of raw, without the trailing newline
+ * @param arena Arena to allocate fields from, or NULL to allocate them on the
+ *        heap
+ *
+ * @note Payloads allocated from an arena are released with the arena, do NOT
+ *       call vtable->destroy on them. Heap payloads must be destroyed with
+ *       vtable->destroy, e.g. payloads that outlive a batch.
+ */
+bool parse_payload(struct payload *p, const char *raw, size_t len,
+		   struct arena *arena);
+
+
+/* payload vtables */
+extern const struct payload_vtable command_login_vtable;
+extern const struct payload_vtable command_join_vtable;
+extern const struct payload_vtable command_logout_vtable;
+extern const struct payload_vtable message_vtable;
+
+/* receiver vtables */
+extern const struct message_receiving_entity_vtable direct_message_vtable;
+extern const struct message_receiving_entity_vtable group_message_vtable;
+extern const struct message_receiving_entity_vtable global_message_vtable;
+
+/* process methods, for callers that already know the type of a payload */
+void process_command_login(const struct payload *self,
+			   struct output_sink *out);
+void process_command_join(const struct payload *self, struct output_sink *out);
+void process_command_logout(const struct payload *self,
+			    struct output_sink *out);
+void process_message(const struct payload *self, struct output_sink *out);
+
+
+#endif
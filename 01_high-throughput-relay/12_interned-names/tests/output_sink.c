@@ -0,0 +1,74 @@
+#include "../src/output_sink.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* reads everything currently in the pipe, without blocking */
+static size_t drain(int fd, char *out, size_t cap)
+{
+	size_t len = 0;
+	ssize_t n;
+
+	while (len < cap && (n = read(fd, out + len, cap - len)) > 0)
+		len += n;
+
+	return len;
+}
+
+int main()
+{
+	int fds[2];
+	char out[256];
+
+	assert(pipe(fds) == 0);
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+	struct output_sink sink;
+	sink_init(&sink, fds[1], 16);
+
+	// nothing reaches the pipe before a flush
+	sink_literal(&sink, "Global ");
+	sink_string(&sink, "message");
+	assert(drain(fds[0], out, sizeof(out)) == 0);
+
+	sink_flush(&sink);
+	assert(drain(fds[0], out, sizeof(out)) == 14);
+	assert(memcmp(out, "Global message", 14) == 0);
+
+	// a full buffer is flushed to make room
+	sink_literal(&sink, "0123456789");
+	sink_literal(&sink, "abcdefghij");
+	assert(drain(fds[0], out, sizeof(out)) == 10);
+	assert(memcmp(out, "0123456789", 10) == 0);
+
+	// larger than the buffer: pending data first, then the write itself
+	sink_literal(&sink, "a write larger than the sink");
+	assert(drain(fds[0], out, sizeof(out)) == 38);
+	assert(memcmp(out, "abcdefghija write larger than the sink", 38) == 0);
+
+	// formatting that does not fit is redone after a flush
+	sink_literal(&sink, "0123456789");
+	sink_printf(&sink, "%d of %d", 10, 20);
+	assert(drain(fds[0], out, sizeof(out)) == 10);
+	sink_destroy(&sink);
+	assert(drain(fds[0], out, sizeof(out)) == 8);
+	assert(memcmp(out, "10 of 20", 8) == 0);
+
+	close(fds[0]);
+	close(fds[1]);
+
+	// memory sinks grow instead of writing
+	sink_init(&sink, SINK_MEMORY, 4);
+	sink_literal(&sink, "0123456789");
+	sink_printf(&sink, "%s", "abcdefghij");
+	assert(sink_flush(&sink));
+	assert(sink.len == 20);
+	assert(memcmp(sink.buf, "0123456789abcdefghij", 20) == 0);
+	sink_destroy(&sink);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+// The registry replaces the strcmp chain of parse_payload. A command name is
+// reduced to a key made of its length and its first two characters, and a
+// switch on that key picks the only candidate. The compiler turns the switch
+// into a jump table or a short binary search, so the lookup does not get
+// slower as commands are added, and the length and a single memcmp confirm
+// the match.
+//
+// Two commands with the same key would be two identical case labels, which
+// is a compile error. If that happens, add the third character to the key.
+
+#include "command_registry.h"
+
+#include <stdint.h>
+#include <string.h>
+
+
+/* X(name, first character, second character, vtable) */
+#define COMMANDS(X)                                                     \
+	X(login,  'l', 'o', command_login_vtable)                       \
+	X(join,   'j', 'o', command_join_vtable)                        \
+	X(logout, 'l', 'o', command_logout_vtable)
+
+#define COMMAND_KEY(len, first, second) \
+	((uint32_t) (len) << 16 | (uint32_t) (uint8_t) (first) << 8 | \
+	 (uint8_t) (second))
+
+/* one `struct command` for each entry of COMMANDS */
+#define DEFINE_COMMAND(name_, first, second, vtable_)                   \
+	static const struct command name_##_command = {                 \
+		.name = #name_,                                         \
+		.name_len = sizeof(#name_) - 1,                         \
+		.construct = construct_command_##name_,                 \
+		.vtable = &vtable_,                                     \
+	};
+
+COMMANDS(DEFINE_COMMAND)
+
+/* one case label for each entry of COMMANDS */
+#define COMMAND_CASE(name_, first, second, vtable_)                     \
+	case COMMAND_KEY(sizeof(#name_) - 1, first, second):            \
+		command = &name_##_command;                             \
+		break;
+
+const struct command *find_command(struct token name)
+{
+	const struct command *command;
+
+	// every command name has at least two characters
+	if (name.len < 2)
+		return NULL;
+
+	switch (COMMAND_KEY(name.len, name.ptr[0], name.ptr[1])) {
+	COMMANDS(COMMAND_CASE)
+	default:
+		return NULL;
+	}
+
+	// the key only covers two characters and the low 16 bits of the
+	// length: a name of 65540 characters starting with "jo" is a
+	// candidate for join
+	if (name.len != command->name_len ||
+	    memcmp(command->name, name.ptr, name.len) != 0)
+		return NULL;
+
+	return command;
+}
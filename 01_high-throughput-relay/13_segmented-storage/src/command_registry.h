@@ -0,0 +1,63 @@
+/**
+ * @file command_registry.h
+ * @brief Compile-time table of commands, looked up in O(1).
+ *
+ * Every command is registered once, in the COMMANDS list of
+ * command_registry.c, with its constructor and vtable.
+ */
+
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+
+#include "payload.h"
+#include "tokenizer.h"
+
+#include <stddef.h>
+
+
+/** @brief Most arguments any registered command takes. */
+#define COMMAND_MAX_ARGUMENTS 2
+
+struct arena;
+
+/**
+ * @brief Sets up the data fields of a command payload.
+ *
+ * @param p Payload, its vtable is already set
+ * @param args Arguments following the command name
+ * @param arg_count Number of arguments, at most COMMAND_MAX_ARGUMENTS
+ * @param arena Arena to allocate fields from, or NULL for the heap
+ */
+typedef void (*command_constructor)(struct payload *p,
+				    const struct token *args, size_t arg_count,
+				    struct arena *arena);
+
+/**
+ * @brief A registered command.
+ */
+struct command {
+	const char *name;                    /**< e.g. "login" */
+	size_t name_len;                     /**< strlen(name) */
+	command_constructor construct;       /**< Fills the payload's data */
+	const struct payload_vtable *vtable; /**< Behavior of the payload */
+};
+
+/**
+ * @brief Looks up a command by name.
+ *
+ * @param name Command name token, e.g. "login" of "/login metw pass"
+ * @return The command, or NULL if no command has that name
+ */
+const struct command *find_command(struct token name);
+
+/* command constructors */
+void construct_command_login(struct payload *p, const struct token *args,
+			     size_t arg_count, struct arena *arena);
+void construct_command_join(struct payload *p, const struct token *args,
+			    size_t arg_count, struct arena *arena);
+void construct_command_logout(struct payload *p, const struct token *args,
+			      size_t arg_count, struct arena *arena);
+
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file dynamic_dispatch.h
+ * @brief Payload buffer whose payloads live in an arena.
+ *
+ * Payloads are stored in fixed-size segments instead of one growing array.
+ * A payload never moves once pushed, so pointers to it stay valid until the
+ * buffer is destroyed, and growing never copies what is already stored.
+ */
+
+
+#ifndef DYNAMIC_DISPATCH_H
+#define DYNAMIC_DISPATCH_H
+
+
+#include "arena.h"
+#include "output_sink.h"
+#include "payload.h"
+
+#include <stddef.h>
+
+
+/** @brief Payloads grouped by type at once by process_batch(). */
+#define BATCH_WINDOW 256
+
+/** @brief Memory of a segment, 128 KiB. */
+#define PAYLOAD_SEGMENT_BYTES (128 << 10)
+
+/**
+ * @brief Payloads per segment.
+ *
+ * A little room is left for the segment's header and malloc's own, so that
+ * a segment does not spill into one more page than PAYLOAD_SEGMENT_BYTES.
+ */
+#define PAYLOAD_SEGMENT_SIZE \
+	((PAYLOAD_SEGMENT_BYTES - 64) / sizeof(struct payload))
+
+
+/**
+ * @brief Fixed-size block of payloads.
+ *
+ * Every segment of a buffer is full, except the last one, and those that
+ * were the last of a buffer before append_buffer().
+ */
+struct payload_segment {
+	size_t first;  /**< Index of payloads[0] in the buffer */
+	size_t len;    /**< Payloads in use */
+	struct payload payloads[PAYLOAD_SEGMENT_SIZE];
+};
+
+struct payload_buffer {
+	struct payload_segment **segments;  /**< In use, then spare ones */
+	size_t segment_count;  /**< Segments in use */
+	size_t spare_count;    /**< Empty segments reserved after them */
+	size_t segment_cap;    /**< Slots of segments */
+	size_t len;
+	size_t process_base;
+	size_t process_segment;  /**< Segment of payload process_base */
+	struct arena arena;  /**< Fields of every payload in the buffer */
+};
+
+
+struct payload_buffer *new_buffer();
+
+/**
+ * @brief Allocates room for count more payloads ahead of time.
+ *
+ * Optional: pushing allocates segments as needed anyway. When the number of
+ * lines is known, reserving moves those allocations out of the parsing loop.
+ */
+void reserve_payloads(struct payload_buffer *buf, size_t count);
+
+/**
+ * @brief Parses and adds a payload to the buffer.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param raw Line view, e.g. pointing into a mapped file
+ * @param len Length of the line, without the newline
+ *
+ * @note Fields of the payload are allocated from the buffer's arena.
+ */
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len);
+
+/**
+ * @brief Moves every payload of other to the end of buf, and frees other.
+ *
+ * Nothing is copied: other's segments and arena are handed over to buf. The
+ * last segment of buf stays partially filled.
+ *
+ * @param buf Pointer to the payload buffer to append to
+ * @param other Buffer to empty, it must not have been processed yet
+ */
+void append_buffer(struct payload_buffer *buf, struct payload_buffer *other);
+
+/**
+ * @brief Payload at index i, in O(log segments).
+ *
+ * The pointer is stable, it is valid until the buffer is destroyed.
+ */
+struct payload *payload_at(struct payload_buffer *buf, size_t i);
+
+/**
+ * @brief Output of a batch, payload by payload.
+ */
+struct batch_output {
+	struct output_sink scratch;    /**< Memory sink, in processing order */
+	size_t count;                  /**< Payloads in the batch */
+	size_t start[BATCH_WINDOW];    /**< Offset of each output in scratch */
+	size_t len[BATCH_WINDOW];      /**< Length of each output */
+};
+
+/**
+ * @brief Processes the next payload of the buffer.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param out Sink the output is appended to, flushed by the caller
+ */
+void process_next(struct payload_buffer *buf, struct output_sink *out);
+
+void batch_output_init(struct batch_output *b);
+
+void batch_output_destroy(struct batch_output *b);
+
+/**
+ * @brief Processes the next BATCH_WINDOW payloads (or fewer, if the buffer
+ *        or the current segment has fewer left), grouped by type.
+ *
+ * Payloads of the same type are processed together, in a loop that calls
+ * their process method directly instead of through the vtable. Output of
+ * each payload is kept apart in b, to be emitted in arrival order:
+ *
+ *     for (size_t i = 0; i < b.count; i++)
+ *             sink_write(out, b.scratch.buf + b.start[i], b.len[i]);
+ *
+ * @param buf Pointer to the payload buffer
+ * @param b Output of the batch, overwritten
+ * @return Number of payloads processed, 0 if none were left
+ */
+size_t process_batch(struct payload_buffer *buf, struct batch_output *b);
+
+/**
+ * @brief Frees the buffer and all of its payloads.
+ *
+ * Payloads are not destroyed one by one, the arena is released as a whole:
+ * one free() per arena chunk and per segment, instead of several per
+ * payload.
+ *
+ * @param buf Pointer to the payload buffer to destroy
+ */
+void destroy(struct payload_buffer *buf);
+
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file intern.h
+ * @brief Global table of names, each stored once and known by a 32-bit ID.
+ *
+ * Usernames and channel names repeat on nearly every line. Interning a name
+ * returns the same ID every time it is seen, so payloads store a 4 byte ID
+ * instead of a copy, and two names are equal if and only if their IDs are.
+ *
+ * Lookups of known names take no lock, so that parser threads can intern
+ * concurrently. Only adding a new name takes the table's mutex.
+ *
+ * Names are never removed, the table is bounded instead: once it is full,
+ * new names are refused, and the lines naming them are rejected.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Most names the table holds, IDs are below it. */
+#define INTERN_MAX_NAMES (1u << 20)
+
+/** @brief Most bytes the names take together, their NULs included. */
+#define INTERN_MAX_BYTES (64u << 20)
+
+/** @brief Not an ID: the name is unknown, or the table is full. */
+#define INTERN_NONE UINT32_MAX
+
+/** @brief Slots of the hash table when the first name is added. */
+#define INTERN_INITIAL_SLOTS 1024
+
+/**
+ * @brief Returns the ID of a name, adding it to the table if it is new.
+ *
+ * IDs are given in order of first appearance, starting at 0. Thread-safe.
+ *
+ * @param str Name, not necessarily null-terminated
+ * @param len Length of the name
+ * @return INTERN_NONE if the name is new and the table is full, it holds
+ *         INTERN_MAX_NAMES names or INTERN_MAX_BYTES bytes
+ */
+uint32_t intern(const char *str, size_t len);
+
+/**
+ * @brief Returns the ID of a name that is interned already, never adds it.
+ *
+ * Names that only a client mentions, e.g. receivers of its messages, are
+ * looked up: interning them would let clients fill the table. Thread-safe.
+ *
+ * @return INTERN_NONE if the name is not in the table
+ */
+uint32_t interned_id(const char *str, size_t len);
+
+/**
+ * @brief Interned name of an ID, null-terminated.
+ *
+ * The pointer is stable: it stays valid, and unchanged, until
+ * intern_reset().
+ */
+const char *interned_name(uint32_t id);
+
+/** @brief Length of the interned name of an ID. */
+size_t interned_len(uint32_t id);
+
+/** @brief Number of distinct names interned so far. */
+size_t interned_count(void);
+
+/**
+ * @brief Frees every name, IDs start over at 0.
+ *
+ * Every ID and name pointer becomes invalid. Not thread-safe, call it when
+ * no other thread uses the table.
+ */
+void intern_reset(void);
+
+
+#endif
@@ -0,0 +1,95 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/output_sink.h"
+#include "../src/payload.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* a payload type process_batch() does not know about */
+static void process_ping([[maybe_unused]] const struct payload *self,
+			 struct output_sink *out)
+{
+	sink_literal(out, "Pong\n");
+}
+
+static void destroy_ping([[maybe_unused]] const struct payload *self)
+{}
+
+static const struct payload_vtable ping_vtable = {
+	.process = process_ping,
+	.destroy = destroy_ping,
+};
+
+static struct payload_buffer *fill_buffer()
+{
+	const char *lines[] = {
+		"/login alice pass", "@bob hi", "/join general",
+		"#general @carol hello all", "/logout", "global message",
+	};
+	struct payload_buffer *buf = new_buffer();
+
+	for (int i = 0; i < 1000; i++) {
+		const char *line = lines[(i * 7 + i / 3) % 6];
+
+		push_payload(buf, line, strlen(line));
+
+		// every 13th payload has a type of its own
+		if (i % 13 == 0)
+			payload_at(buf, buf->len - 1)->vtable = &ping_vtable;
+	}
+
+	return buf;
+}
+
+int main()
+{
+	struct payload_buffer *one_by_one = fill_buffer();
+	struct payload_buffer *batched = fill_buffer();
+	struct output_sink expected, actual;
+
+	sink_init(&expected, SINK_MEMORY, 16);
+	sink_init(&actual, SINK_MEMORY, 16);
+
+	while (one_by_one->process_base < one_by_one->len) {
+		process_next(one_by_one, &expected);
+		sink_literal(&expected, "|");
+	}
+
+	struct batch_output batch;
+	size_t batches = 0;
+
+	batch_output_init(&batch);
+	while (process_batch(batched, &batch) > 0) {
+		assert(batch.count <= BATCH_WINDOW);
+		batches++;
+
+		for (size_t i = 0; i < batch.count; i++) {
+			sink_write(&actual, batch.scratch.buf + batch.start[i],
+				   batch.len[i]);
+			sink_literal(&actual, "|");
+		}
+	}
+
+	// 1000 payloads, windows of 256
+	assert(batches == 4);
+	assert(batched->process_base == batched->len);
+
+	// same output, in arrival order
+	assert(actual.len == expected.len);
+	assert(memcmp(actual.buf, expected.buf, expected.len) == 0);
+
+	// the unknown type went through its vtable
+	sink_write(&actual, "", 1);
+	assert(strstr(actual.buf, "Pong\n|"));
+
+	batch_output_destroy(&batch);
+	sink_destroy(&expected);
+	sink_destroy(&actual);
+	destroy(one_by_one);
+	destroy(batched);
+
+	return EXIT_SUCCESS;
+}
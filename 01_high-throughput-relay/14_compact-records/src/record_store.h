@@ -0,0 +1,151 @@
+/**
+ * @file record_store.h
+ * @brief Payloads packed into 8-byte records, for scanning in order.
+ *
+ * A struct payload is a vtable pointer and pointers to its fields, each in a
+ * separate place in the arena. A record is a 1-byte kind and a 32-bit
+ * offset, the fields it points to are packed into one byte array, and
+ * receivers of messages into another. Sixteen records fit in two cache
+ * lines, and scanning them reads three arrays from front to back.
+ *
+ * The three arrays are stored in fixed-size chunks, like payloads in
+ * segments: growing allocates one more chunk and never copies what is
+ * already stored. A field never straddles two chunks, so an offset is the
+ * index of a chunk and a position in it, and 4 GiB of fields fit in 32 bits.
+ */
+
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+struct output_sink;
+
+enum record_kind {
+	RECORD_LOGIN,
+	RECORD_JOIN,
+	RECORD_LOGOUT,
+	RECORD_MESSAGE,
+};
+
+/**
+ * @brief A payload, packed.
+ *
+ * What offset points to depends on the kind:
+ * - login: the username's ID, then a 32-bit length and the password
+ * - join: nothing, offset is the channel's ID itself
+ * - logout: nothing, offset is 0
+ * - message: a 32-bit length and the content, receivers are the next
+ *   receiver_count entries of the receivers array
+ */
+struct record {
+	uint8_t kind;             /**< enum record_kind */
+	uint8_t reserved;
+	uint16_t receiver_count;  /**< 0 for global messages */
+	uint32_t offset;          /**< Into strings, or an interned ID */
+};
+
+/** @brief Memory of a chunk, 64 KiB. */
+#define RECORD_CHUNK_BYTES (64 << 10)
+
+/** @brief Records per chunk. */
+#define RECORD_CHUNK_SIZE (RECORD_CHUNK_BYTES / sizeof(struct record))
+
+/** @brief Receivers per chunk. */
+#define RECEIVER_CHUNK_SIZE (RECORD_CHUNK_BYTES / sizeof(uint32_t))
+
+/** @brief Bytes of fields a store can hold, what 32-bit offsets address. */
+#define RECORD_STORE_MAX_STRINGS ((size_t) 1 << 32)
+
+/**
+ * @brief A receiver of a message: interned name, and whether it is a
+ *        channel in the lowest bit.
+ */
+#define RECORD_RECEIVER(name, is_group) (((name) << 1) | (is_group))
+
+/**
+ * @brief Array stored in chunks of RECORD_CHUNK_BYTES.
+ *
+ * Only the table of chunk pointers is ever reallocated, an element never
+ * moves once appended.
+ */
+struct record_chunks {
+	char **chunks;
+	size_t count;  /**< Chunks allocated, the last ones may be empty */
+	size_t cap;    /**< Slots of chunks */
+};
+
+struct record_store {
+	struct record_chunks records;
+	size_t len;
+	struct record_chunks receivers;  /**< See RECORD_RECEIVER() */
+	size_t receiver_len;
+	/**
+	 * Fields, at the offsets of records. A field larger than a chunk has
+	 * an allocation of its own, in the first of as many slots as it
+	 * covers, the others are NULL.
+	 */
+	struct record_chunks strings;
+	size_t strings_len;  /**< Offset of the next field */
+};
+
+
+/** @brief Record i, for i < s->len. */
+static inline struct record *record_at(const struct record_store *s, size_t i)
+{
+	return (struct record *) s->records.chunks[i / RECORD_CHUNK_SIZE] +
+		i % RECORD_CHUNK_SIZE;
+}
+
+/** @brief Receiver i, for i < s->receiver_len. */
+static inline uint32_t receiver_at(const struct record_store *s, size_t i)
+{
+	return ((const uint32_t *) s->receivers.chunks[i / RECEIVER_CHUNK_SIZE])
+		[i % RECEIVER_CHUNK_SIZE];
+}
+
+/** @brief Fields at the offset of a record. */
+static inline const char *record_fields(const struct record_store *s,
+					uint32_t offset)
+{
+	return s->strings.chunks[offset / RECORD_CHUNK_BYTES] +
+		offset % RECORD_CHUNK_BYTES;
+}
+
+
+void record_store_init(struct record_store *s);
+
+/**
+ * @brief Allocates room for count more records ahead of time.
+ */
+void record_store_reserve(struct record_store *s, size_t count);
+
+/**
+ * @brief Parses a line and appends its record.
+ *
+ * @param s Store to append to
+ * @param raw Line view, e.g. pointing into a mapped file
+ * @param len Length of the line, without the newline
+ * @return false if the line is an unknown command, if its fields would
+ *         take the store past RECORD_STORE_MAX_STRINGS, or if it names a new
+ *         name and the intern table is full, nothing is appended then
+ */
+bool record_store_push(struct record_store *s, const char *raw, size_t len);
+
+/**
+ * @brief Processes every record in order.
+ *
+ * Output is the same as processing the equivalent payloads with
+ * process_next().
+ */
+void record_store_dispatch(const struct record_store *s,
+			   struct output_sink *out);
+
+void record_store_destroy(struct record_store *s);
+
+
+#endif
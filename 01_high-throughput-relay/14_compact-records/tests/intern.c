@@ -0,0 +1,166 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/intern.h"
+#include "../src/payload.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define THREADS 4
+#define NAMES 20000
+
+
+static void test_same_name_same_id()
+{
+	uint32_t alice = intern("alice", 5);
+	uint32_t bob = intern("bob and more", 3);
+
+	assert(alice != bob);
+	assert(intern("alice", 5) == alice);
+	assert(intern("bob", 3) == bob);
+	assert(intern("alic", 4) != alice);
+
+	assert(strcmp(interned_name(alice), "alice") == 0);
+	assert(interned_len(bob) == 3);
+	assert(interned_count() == 3);
+}
+
+static void test_pointers_are_stable()
+{
+	uint32_t first = intern("first", 5);
+	const char *name = interned_name(first);
+	char buf[32];
+
+	// enough names to grow the table many times
+	for (int i = 0; i < NAMES; i++)
+		intern(buf, sprintf(buf, "user%d", i));
+
+	assert(interned_name(first) == name);
+	assert(intern("first", 5) == first);
+
+	for (int i = 0; i < NAMES; i++) {
+		uint32_t id = intern(buf, sprintf(buf, "user%d", i));
+
+		assert(strcmp(interned_name(id), buf) == 0);
+	}
+}
+
+static void *intern_all(void *arg)
+{
+	uint32_t *ids = arg;
+	char buf[32];
+
+	for (int i = 0; i < NAMES; i++)
+		ids[i] = intern(buf, sprintf(buf, "channel%d", i));
+
+	return NULL;
+}
+
+static void test_concurrent_interning()
+{
+	static uint32_t ids[THREADS][NAMES];
+	pthread_t threads[THREADS];
+
+	for (int t = 0; t < THREADS; t++)
+		pthread_create(&threads[t], NULL, intern_all, ids[t]);
+
+	for (int t = 0; t < THREADS; t++)
+		pthread_join(threads[t], NULL);
+
+	// every thread got the same ID for the same name, and only one was
+	// given per name
+	for (int t = 1; t < THREADS; t++)
+		assert(memcmp(ids[t], ids[0], sizeof(ids[0])) == 0);
+
+	assert(interned_count() == NAMES);
+}
+
+static void test_lookups_never_add()
+{
+	uint32_t alice = intern("alice", 5);
+
+	assert(interned_id("alice", 5) == alice);
+	assert(interned_id("bob", 3) == INTERN_NONE);
+	assert(interned_count() == 1);
+}
+
+static void test_full_table()
+{
+	char buf[32];
+
+	for (uint32_t i = 0; i < INTERN_MAX_NAMES; i++)
+		assert(intern(buf, sprintf(buf, "n%u", i)) == i);
+
+	// known names are still found, new ones are refused
+	assert(intern("n42", 3) == 42);
+	assert(intern("one too many", 12) == INTERN_NONE);
+	assert(interned_count() == INTERN_MAX_NAMES);
+
+	intern_reset();
+
+	// fewer, but longer names
+	size_t len = INTERN_MAX_BYTES / 16;
+	char *name = malloc(len);
+	uint32_t count = 0;
+
+	assert(name);
+	memset(name, 'x', len);
+
+	while (intern(name, len) != INTERN_NONE)
+		name[count++ % len] = 'y';
+
+	assert(count == 15 && interned_count() == 15);
+	assert(intern("short", 5) != INTERN_NONE);
+
+	free(name);
+}
+
+static void test_payloads_store_ids()
+{
+	struct payload_buffer *buf = new_buffer();
+	const char *lines[] = {
+		"/join general",
+		"#general @alice hello",
+		"/login alice s3cr3t",
+	};
+
+	for (size_t i = 0; i < sizeof(lines) / sizeof(*lines); i++)
+		push_payload(buf, lines[i], strlen(lines[i]));
+
+	uint32_t general = payload_at(buf, 0)->data.command_join.channel;
+	struct message_receiving_entity *receivers =
+		payload_at(buf, 1)->data.message.receivers;
+
+	assert(receivers[0].name == general);
+	assert(receivers[1].name ==
+	       payload_at(buf, 2)->data.command_login.username);
+	assert(strcmp(interned_name(general), "general") == 0);
+
+	destroy(buf);
+}
+
+int main()
+{
+	test_same_name_same_id();
+	test_pointers_are_stable();
+
+	intern_reset();
+	test_concurrent_interning();
+
+	intern_reset();
+	test_lookups_never_add();
+
+	intern_reset();
+	test_full_table();
+
+	intern_reset();
+	test_payloads_store_ids();
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,342 @@
+#include "dynamic_dispatch.h"
+#include "payload.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+struct payload_buffer *new_buffer()
+{
+	struct payload_buffer *buf = malloc(sizeof(struct payload_buffer));
+	assert(buf);
+
+	// no segment until the first payload, parallel parsers create a
+	// buffer per worker
+	*buf = (struct payload_buffer) {
+		.segments = NULL,
+		.segment_count = 0,
+		.spare_count = 0,
+		.segment_cap = 0,
+		.len = 0,
+		.process_base = 0,
+		.process_segment = 0,
+	};
+
+	arena_init(&buf->arena, ARENA_CHUNK_SIZE);
+
+	return buf;
+}
+
+static struct payload_segment *new_segment()
+{
+	struct payload_segment *segment =
+		malloc(sizeof(struct payload_segment));
+	assert(segment);
+
+	segment->len = 0;
+
+	return segment;
+}
+
+/* only the table of segment pointers is ever reallocated, a few kilobytes
+ * even for a hundred million payloads */
+static void reserve_segment_slots(struct payload_buffer *buf, size_t slots)
+{
+	if (buf->segment_cap >= slots)
+		return;
+
+	size_t cap = buf->segment_cap > 0 ? buf->segment_cap : 8;
+
+	while (cap < slots)
+		cap *= 2;
+
+	buf->segments = realloc(buf->segments,
+				sizeof(struct payload_segment *) * cap);
+	assert(buf->segments);
+
+	buf->segment_cap = cap;
+}
+
+void reserve_payloads(struct payload_buffer *buf, size_t count)
+{
+	size_t room = buf->spare_count * PAYLOAD_SEGMENT_SIZE;
+
+	if (buf->segment_count > 0)
+		room += PAYLOAD_SEGMENT_SIZE -
+			buf->segments[buf->segment_count - 1]->len;
+
+	if (room >= count)
+		return;
+
+	size_t needed = (count - room + PAYLOAD_SEGMENT_SIZE - 1) /
+		PAYLOAD_SEGMENT_SIZE;
+
+	reserve_segment_slots(buf, buf->segment_count + buf->spare_count +
+			      needed);
+
+	for (size_t i = 0; i < needed; i++)
+		buf->segments[buf->segment_count + buf->spare_count++] =
+			new_segment();
+}
+
+/* last segment, with room for one more payload */
+static struct payload_segment *tail_segment(struct payload_buffer *buf)
+{
+	if (buf->segment_count > 0) {
+		struct payload_segment *last =
+			buf->segments[buf->segment_count - 1];
+
+		if (last->len < PAYLOAD_SEGMENT_SIZE)
+			return last;
+	}
+
+	// a reserved segment if there is one, a new one otherwise
+	if (buf->spare_count > 0) {
+		buf->spare_count--;
+	} else {
+		reserve_segment_slots(buf, buf->segment_count + 1);
+		buf->segments[buf->segment_count] = new_segment();
+	}
+
+	struct payload_segment *segment = buf->segments[buf->segment_count++];
+	segment->first = buf->len;
+
+	return segment;
+}
+
+static void push_parsed(struct payload_buffer *buf, const char *raw,
+			size_t len,
+			bool (*parse)(struct payload *p, const char *raw,
+				      size_t len, struct arena *arena))
+{
+	struct payload_segment *segment = tail_segment(buf);
+
+	// parsed in place, the payload is never copied
+	bool is_parsing_successful = parse(
+		&segment->payloads[segment->len], raw, len, &buf->arena);
+
+	if (is_parsing_successful) {
+		segment->len++;
+		buf->len++;
+	}
+}
+
+void push_payload(struct payload_buffer *buf, const char *raw, size_t len)
+{
+	push_parsed(buf, raw, len, parse_payload);
+}
+
+void push_client_payload(struct payload_buffer *buf, const char *raw,
+			 size_t len)
+{
+	push_parsed(buf, raw, len, parse_client_payload);
+}
+
+void append_buffer(struct payload_buffer *buf, struct payload_buffer *other)
+{
+	assert(other->process_base == 0);
+
+	// an empty segment in the middle would break payload_at(), only the
+	// last one can be empty
+	if (buf->segment_count > 0 &&
+	    buf->segments[buf->segment_count - 1]->len == 0) {
+		buf->segment_count--;
+		buf->spare_count++;
+	}
+
+	size_t incoming = other->segment_count;
+
+	if (incoming > 0 && other->segments[incoming - 1]->len == 0)
+		incoming--;
+
+	reserve_segment_slots(buf, buf->segment_count + incoming +
+			      buf->spare_count);
+
+	// spare segments stay behind the ones in use
+	memmove(&buf->segments[buf->segment_count + incoming],
+		&buf->segments[buf->segment_count],
+		sizeof(struct payload_segment *) * buf->spare_count);
+
+	for (size_t i = 0; i < incoming; i++) {
+		struct payload_segment *segment = other->segments[i];
+
+		segment->first = buf->len;
+		buf->len += segment->len;
+		buf->segments[buf->segment_count++] = segment;
+	}
+
+	// other's empty and spare segments are not needed
+	for (size_t i = incoming;
+	     i < other->segment_count + other->spare_count; i++)
+		free(other->segments[i]);
+
+	arena_adopt(&buf->arena, &other->arena);
+
+	free(other->segments);
+	free(other);
+}
+
+struct payload *payload_at(struct payload_buffer *buf, size_t i)
+{
+	assert(i < buf->len);
+
+	// last segment whose first payload is at or before i
+	size_t low = 0, high = buf->segment_count;
+
+	while (high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+
+		if (buf->segments[mid]->first <= i)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	return &buf->segments[low]->payloads[i - buf->segments[low]->first];
+}
+
+/* segment of payload process_base, which must exist */
+static struct payload_segment *process_cursor(struct payload_buffer *buf)
+{
+	struct payload_segment *segment =
+		buf->segments[buf->process_segment];
+
+	while (buf->process_base >= segment->first + segment->len)
+		segment = buf->segments[++buf->process_segment];
+
+	return segment;
+}
+
+void process_next(struct payload_buffer *buf, struct output_sink *out)
+{
+	assert(buf->process_base < buf->len);
+
+	struct payload_segment *segment = process_cursor(buf);
+	struct payload *p =
+		&segment->payloads[buf->process_base - segment->first];
+
+	p->vtable->process(p, out);
+
+	buf->process_base += 1;
+}
+
+// Payload types known to process_batch(), each processed by a loop of its
+// own. Payloads of other types share the generic loop, through their vtable.
+//
+// X(name), with name_vtable and process_name defined in payload_behaviors.c
+#define BATCH_TYPES(X)          \
+	X(command_login)        \
+	X(command_join)         \
+	X(command_logout)       \
+	X(message)
+
+#define BATCH_BUCKET(name) BUCKET_##name,
+
+enum batch_bucket {
+	BATCH_TYPES(BATCH_BUCKET)
+	BUCKET_GENERIC,
+	BUCKET_COUNT
+};
+
+void batch_output_init(struct batch_output *b)
+{
+	sink_init(&b->scratch, SINK_MEMORY, OUTPUT_SINK_SIZE);
+	b->count = 0;
+}
+
+void batch_output_destroy(struct batch_output *b)
+{
+	sink_destroy(&b->scratch);
+}
+
+static enum batch_bucket bucket_of(const struct payload *p)
+{
+#define BATCH_CLASSIFY(name)                    \
+	if (p->vtable == &name##_vtable)        \
+		return BUCKET_##name;
+
+	BATCH_TYPES(BATCH_CLASSIFY)
+
+	return BUCKET_GENERIC;
+}
+
+size_t process_batch(struct payload_buffer *buf, struct batch_output *b)
+{
+	if (buf->process_base == buf->len) {
+		b->count = 0;
+
+		return 0;
+	}
+
+	// a window never spans two segments
+	struct payload_segment *segment = process_cursor(buf);
+	struct payload *window =
+		&segment->payloads[buf->process_base - segment->first];
+	size_t count = segment->first + segment->len - buf->process_base;
+
+	if (count > BATCH_WINDOW)
+		count = BATCH_WINDOW;
+
+	// counting sort of the window by bucket, stable
+	unsigned char buckets[BATCH_WINDOW];
+	size_t bucket_start[BUCKET_COUNT + 1] = { 0 };
+	size_t order[BATCH_WINDOW];
+
+	for (size_t i = 0; i < count; i++) {
+		buckets[i] = bucket_of(&window[i]);
+		bucket_start[buckets[i] + 1]++;
+	}
+
+	for (int k = 0; k < BUCKET_COUNT; k++)
+		bucket_start[k + 1] += bucket_start[k];
+
+	size_t fill[BUCKET_COUNT];
+	memcpy(fill, bucket_start, sizeof(fill));
+
+	for (size_t i = 0; i < count; i++)
+		order[fill[buckets[i]]++] = i;
+
+	struct output_sink *out = &b->scratch;
+	out->len = 0;
+
+	// one homogeneous loop per bucket, the call target never changes
+#define BATCH_LOOP(name)                                                \
+	for (size_t j = bucket_start[BUCKET_##name];                   \
+	     j < bucket_start[BUCKET_##name + 1]; j++) {               \
+		size_t i = order[j];                                    \
+									\
+		b->start[i] = out->len;                                 \
+		process_##name(&window[i], out);                        \
+		b->len[i] = out->len - b->start[i];                     \
+	}
+
+	BATCH_TYPES(BATCH_LOOP)
+
+	for (size_t j = bucket_start[BUCKET_GENERIC];
+	     j < bucket_start[BUCKET_GENERIC + 1]; j++) {
+		size_t i = order[j];
+
+		b->start[i] = out->len;
+		window[i].vtable->process(&window[i], out);
+		b->len[i] = out->len - b->start[i];
+	}
+
+	b->count = count;
+	buf->process_base += count;
+
+	return count;
+}
+
+void destroy(struct payload_buffer *buf)
+{
+	// no vtable->destroy calls, every field lives in the arena
+	arena_destroy(&buf->arena);
+
+	for (size_t i = 0; i < buf->segment_count + buf->spare_count; i++)
+		free(buf->segments[i]);
+
+	free(buf->segments);
+	free(buf);
+}
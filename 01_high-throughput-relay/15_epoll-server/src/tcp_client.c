@@ -0,0 +1,75 @@
+#include "tcp_client.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+/** @brief Bytes read from the input at a time. */
+#define SEND_CHUNK_SIZE (64 << 10)
+
+int tcp_connect(const char *ip, uint16_t port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+	};
+
+	if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1)
+		return -1;
+
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd == -1)
+		return -1;
+
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+		close(fd);
+
+		return -1;
+	}
+
+	return fd;
+}
+
+bool send_all(int fd, const char *data, size_t len)
+{
+	while (len > 0) {
+		// a closed server is an error, not a SIGPIPE
+		ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			return false;
+		}
+
+		data += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+bool send_stream(int fd, int in_fd)
+{
+	char chunk[SEND_CHUNK_SIZE];
+	ssize_t n;
+
+	while ((n = read(in_fd, chunk, sizeof(chunk))) != 0) {
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			return false;
+		}
+
+		if (!send_all(fd, chunk, n))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file tcp_client.h
+ * @brief Minimal client of the TCP relay, to test it on loopback.
+ */
+
+#ifndef TCP_CLIENT_H
+#define TCP_CLIENT_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Connects to a server, blocking.
+ *
+ * @param ip IPv4 address, e.g. "127.0.0.1"
+ * @param port TCP port
+ * @return Socket, or -1 if the connection failed
+ */
+int tcp_connect(const char *ip, uint16_t port);
+
+/**
+ * @brief Sends all of data, however many send() calls it takes.
+ *
+ * @return false on error, e.g. the server closed the connection
+ */
+bool send_all(int fd, const char *data, size_t len);
+
+/**
+ * @brief Sends everything read from in_fd until end of file.
+ *
+ * Payload files are sent as they are: the server frames lines itself.
+ *
+ * @return false on a read or write error
+ */
+bool send_stream(int fd, int in_fd);
+
+
+#endif
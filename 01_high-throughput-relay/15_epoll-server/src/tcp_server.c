@@ -0,0 +1,378 @@
+// Edge-triggered epoll only reports that a socket *became* readable. Every
+// event must therefore be handled until read() or accept() says EAGAIN, or
+// the rest of the data would sit in the socket without another event.
+//
+// Each connection frames its own stream: bytes are read into a buffer of the
+// connection, and every complete line in it is parsed and processed at once.
+// A line split across two reads waits in the buffer for its end, like in the
+// line reader.
+//
+// A connection reads until EAGAIN, or until its budget for the round is
+// spent. Edge-triggered epoll will not report it again for the data it has
+// left, so it goes on the ready list instead, and takes its next turn in
+// the next round, after the connections that were waiting.
+
+// accept4() is a Linux extension
+#define _GNU_SOURCE
+
+#include "dynamic_dispatch.h"
+#include "output_sink.h"
+#include "tcp_server.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+/**
+ * A client. The unconsumed part of its stream lives in `buf[begin, end)`,
+ * and `buf[begin, scanned)` is known not to contain a newline.
+ */
+struct connection {
+	int fd;
+	char *buf;
+	size_t cap;
+	size_t begin;
+	size_t scanned;
+	size_t end;
+	bool is_ready;  /**< On the ready list, or about to take its turn */
+	struct connection *ready_next;
+	struct connection *prev;
+	struct connection *next;
+};
+
+/* what a turn of a connection leaves */
+enum turn {
+	TURN_DRAINED,   /**< Until EAGAIN, epoll reports new data */
+	TURN_READABLE,  /**< Budget spent, data may be left */
+	TURN_CLOSED,    /**< The connection must be closed */
+};
+
+bool tcp_server_open(struct tcp_server *s, uint16_t port)
+{
+	*s = (struct tcp_server) { .listen_fd = -1, .epoll_fd = -1 };
+
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+	int reuse = 1;
+
+	s->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK |
+			      SOCK_CLOEXEC, 0);
+	s->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (s->listen_fd == -1 || s->epoll_fd == -1)
+		goto fail;
+
+	// a restarted server can listen again while old connections linger
+	setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse,
+		   sizeof(reuse));
+
+	if (bind(s->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+	    listen(s->listen_fd, SOMAXCONN) == -1)
+		goto fail;
+
+	// the listening socket is the only one without a connection
+	struct epoll_event event = {
+		.events = EPOLLIN | EPOLLET,
+		.data.ptr = NULL,
+	};
+
+	if (epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, s->listen_fd, &event) == -1)
+		goto fail;
+
+	return true;
+
+fail:
+	tcp_server_close(s);
+
+	return false;
+}
+
+uint16_t tcp_server_port(const struct tcp_server *s)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+
+	if (getsockname(s->listen_fd, (struct sockaddr *) &addr, &len) == -1)
+		return 0;
+
+	return ntohs(addr.sin_port);
+}
+
+static void close_connection(struct tcp_server *s, struct connection *c)
+{
+	// closing the socket also removes it from the epoll set
+	close(c->fd);
+
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		s->connections = c->next;
+
+	if (c->next)
+		c->next->prev = c->prev;
+
+	s->connection_count--;
+
+	free(c->buf);
+	free(c);
+}
+
+static void accept_connections(struct tcp_server *s)
+{
+	while (true) {
+		int fd = accept4(s->listen_fd, NULL, NULL,
+				 SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if (fd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			// EAGAIN: every pending client is accepted. Others,
+			// e.g. EMFILE, leave clients in the backlog until a
+			// connection is closed.
+			if (errno != EAGAIN)
+				perror("accept4");
+
+			return;
+		}
+
+		struct connection *c = malloc(sizeof(struct connection));
+		assert(c);
+
+		*c = (struct connection) {
+			.fd = fd,
+			.cap = TCP_SERVER_READ_SIZE,
+			.next = s->connections,
+		};
+		c->buf = malloc(sizeof(char) * c->cap);
+		assert(c->buf);
+
+		struct epoll_event event = {
+			.events = EPOLLIN | EPOLLRDHUP | EPOLLET,
+			.data.ptr = c,
+		};
+
+		if (epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+			perror("epoll_ctl");
+			close(fd);
+			free(c->buf);
+			free(c);
+
+			continue;
+		}
+
+		if (s->connections)
+			s->connections->prev = c;
+
+		s->connections = c;
+		s->connection_count++;
+	}
+}
+
+static void handle_line(struct tcp_server *s, struct payload_buffer **buf,
+			struct output_sink *out, const char *line, size_t len)
+{
+	// clients typing into telnet end their lines with \r\n
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+
+	if (len == 0)
+		return;
+
+	// a round lasts as long as clients keep sending, its payloads are
+	// released by batch, they are processed already
+	if ((*buf)->len == TCP_SERVER_BATCH_SIZE) {
+		destroy(*buf);
+		*buf = new_buffer();
+	}
+
+	size_t before = (*buf)->len;
+
+	push_client_payload(*buf, line, len);
+
+	if ((*buf)->len > before) {
+		process_next(*buf, out);
+		s->payload_count++;
+	}
+}
+
+/* handles every complete line in the buffer of c */
+static void frame_lines(struct tcp_server *s, struct connection *c,
+			struct payload_buffer **buf, struct output_sink *out)
+{
+	char *newline;
+
+	while ((newline = memchr(c->buf + c->scanned, '\n',
+				 c->end - c->scanned))) {
+		handle_line(s, buf, out, c->buf + c->begin,
+			    newline - (c->buf + c->begin));
+		c->begin = c->scanned = newline - c->buf + 1;
+	}
+
+	c->scanned = c->end;
+}
+
+/* makes room after end, false if the pending line is already too long */
+static bool make_room(struct connection *c)
+{
+	if (c->begin > 0) {
+		memmove(c->buf, c->buf + c->begin, c->end - c->begin);
+		c->scanned -= c->begin;
+		c->end -= c->begin;
+		c->begin = 0;
+	}
+
+	if (c->end < c->cap)
+		return true;
+
+	if (c->cap >= TCP_SERVER_MAX_LINE)
+		return false;
+
+	c->cap *= 2;
+	assert((c->buf = realloc(c->buf, sizeof(char) * c->cap)));
+
+	return true;
+}
+
+/* reads until the socket is drained or the budget is spent */
+static enum turn read_connection(struct tcp_server *s, struct connection *c,
+				 struct payload_buffer **buf,
+				 struct output_sink *out)
+{
+	size_t budget = TCP_SERVER_READ_BUDGET;
+
+	while (true) {
+		if (c->end == c->cap && !make_room(c))
+			return TURN_CLOSED;
+
+		size_t room = c->cap - c->end;
+
+		if (room > budget)
+			room = budget;
+
+		ssize_t n = read(c->fd, c->buf + c->end, room);
+
+		if (n > 0) {
+			c->end += n;
+			budget -= n;
+			frame_lines(s, c, buf, out);
+
+			// nothing pending, start over at the front
+			if (c->begin == c->end)
+				c->begin = c->scanned = c->end = 0;
+
+			if (budget == 0)
+				return TURN_READABLE;
+		} else if (n == 0) {
+			// last line, without a trailing newline
+			handle_line(s, buf, out, c->buf + c->begin,
+				    c->end - c->begin);
+
+			return TURN_CLOSED;
+		} else if (errno == EAGAIN) {
+			return TURN_DRAINED;
+		} else if (errno != EINTR) {
+			return TURN_CLOSED;
+		}
+	}
+}
+
+/* queues c for a turn, once however many events report it */
+static void mark_ready(struct tcp_server *s, struct connection *c)
+{
+	if (c->is_ready)
+		return;
+
+	c->is_ready = true;
+	c->ready_next = NULL;
+
+	if (s->ready_tail)
+		s->ready_tail->ready_next = c;
+	else
+		s->ready = c;
+
+	s->ready_tail = c;
+}
+
+size_t tcp_server_poll(struct tcp_server *s, struct output_sink *out,
+		       int timeout_ms)
+{
+	struct epoll_event events[TCP_SERVER_MAX_EVENTS];
+	int count;
+
+	// connections left readable by the last round do not wait
+	if (s->ready)
+		timeout_ms = 0;
+
+	do {
+		count = epoll_wait(s->epoll_fd, events, TCP_SERVER_MAX_EVENTS,
+				   timeout_ms);
+	} while (count == -1 && errno == EINTR);
+
+	for (int i = 0; i < count; i++) {
+		struct connection *c = events[i].data.ptr;
+
+		if (c == NULL)
+			accept_connections(s);
+		else
+			mark_ready(s, c);
+	}
+
+	// payloads of this round, released by batch
+	struct payload_buffer *buf = new_buffer();
+	size_t processed = s->payload_count;
+	struct connection *c = s->ready;
+
+	// one turn each, those with data left are queued again
+	s->ready = s->ready_tail = NULL;
+
+	while (c) {
+		struct connection *next = c->ready_next;
+
+		c->is_ready = false;
+
+		switch (read_connection(s, c, &buf, out)) {
+		case TURN_DRAINED:
+			break;
+		case TURN_READABLE:
+			mark_ready(s, c);
+			break;
+		case TURN_CLOSED:
+			close_connection(s, c);
+			break;
+		}
+
+		c = next;
+	}
+
+	destroy(buf);
+	sink_flush(out);
+
+	return s->payload_count - processed;
+}
+
+void tcp_server_close(struct tcp_server *s)
+{
+	while (s->connections)
+		close_connection(s, s->connections);
+
+	s->ready = s->ready_tail = NULL;
+
+	if (s->listen_fd != -1)
+		close(s->listen_fd);
+
+	if (s->epoll_fd != -1)
+		close(s->epoll_fd);
+
+	s->listen_fd = s->epoll_fd = -1;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file tcp_server.h
+ * @brief Relay over TCP, on a single thread, with edge-triggered epoll.
+ *
+ * Clients send payloads the way they are stored in a payloads file: one per
+ * line. Every socket is non-blocking and registered with epoll, so a single
+ * thread serves any number of clients, and sleeps while none of them sends
+ * anything.
+ */
+
+#ifndef TCP_SERVER_H
+#define TCP_SERVER_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Initial read buffer of a connection. */
+#define TCP_SERVER_READ_SIZE 4096
+
+/** @brief Longest line a client may send, longer ones drop the client. */
+#define TCP_SERVER_MAX_LINE (64 << 10)
+
+/** @brief Events handled per epoll_wait() call. */
+#define TCP_SERVER_MAX_EVENTS 256
+
+/**
+ * @brief Bytes read from a connection per round, before the others get
+ *        their turn.
+ */
+#define TCP_SERVER_READ_BUDGET (64 << 10)
+
+/** @brief Payloads of a round released together. */
+#define TCP_SERVER_BATCH_SIZE 4096
+
+struct connection;
+struct output_sink;
+
+struct tcp_server {
+	int listen_fd;
+	int epoll_fd;
+	struct connection *connections;  /**< Open ones, a linked list */
+	size_t connection_count;
+	struct connection *ready;  /**< Still readable after their turn */
+	struct connection *ready_tail;
+	size_t payload_count;  /**< Processed since the server was opened */
+};
+
+/**
+ * @brief Listens on every interface.
+ *
+ * @param s Server to open
+ * @param port TCP port, or 0 for any free port, see tcp_server_port()
+ * @return false if the socket could not be set up, errno tells why
+ */
+bool tcp_server_open(struct tcp_server *s, uint16_t port);
+
+/** @brief Port the server listens on. */
+uint16_t tcp_server_port(const struct tcp_server *s);
+
+/**
+ * @brief Waits for events once, and handles every one of them.
+ *
+ * New clients are accepted, and every complete line received is parsed and
+ * processed at once, in the order it was read. Lines of one client are
+ * processed in the order they were sent.
+ *
+ * Each connection reads at most TCP_SERVER_READ_BUDGET bytes per round. One
+ * that has more waits for the next round, which does not wait for events
+ * then, so a client sending without pause does not hold up the others.
+ *
+ * @param s Server
+ * @param out Sink the output of processed payloads is appended to, flushed
+ *        before returning
+ * @param timeout_ms Longest wait, -1 to wait until something happens
+ * @return Number of payloads processed
+ */
+size_t tcp_server_poll(struct tcp_server *s, struct output_sink *out,
+		       int timeout_ms);
+
+/**
+ * @brief Closes every connection and the listening socket.
+ *
+ * Unfinished lines of open connections are discarded.
+ */
+void tcp_server_close(struct tcp_server *s);
+
+
+#endif
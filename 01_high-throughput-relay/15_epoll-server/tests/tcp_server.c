@@ -0,0 +1,294 @@
+#include "../src/intern.h"
+#include "../src/output_sink.h"
+#include "../src/tcp_client.h"
+#include "../src/tcp_server.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+#define CLIENT_COUNT 300
+
+static size_t count_occurrences(const struct output_sink *out,
+				const char *needle)
+{
+	size_t count = 0;
+	size_t len = strlen(needle);
+
+	for (size_t i = 0; i + len <= out->len; i++)
+		if (memcmp(out->buf + i, needle, len) == 0)
+			count++;
+
+	return count;
+}
+
+/* a client is closed after its socket is drained, nothing is left then */
+static void poll_until_closed(struct tcp_server *server,
+			      struct output_sink *out)
+{
+	do
+		tcp_server_poll(server, out, 100);
+	while (server->connection_count > 0);
+}
+
+static void test_many_clients()
+{
+	struct tcp_server server;
+	struct output_sink out;
+	int clients[CLIENT_COUNT];
+
+	assert(tcp_server_open(&server, 0));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+
+	for (int i = 0; i < CLIENT_COUNT; i++) {
+		char line[64];
+
+		assert((clients[i] = tcp_connect("127.0.0.1", port)) != -1);
+		assert(send_all(clients[i], line,
+				sprintf(line, "/join channel%d\n", i)));
+	}
+
+	// every client is open, and each of them has sent a line
+	while (server.payload_count < CLIENT_COUNT)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(server.connection_count == CLIENT_COUNT);
+
+	// the last line has no newline, it ends with the connection
+	for (int i = 0; i < CLIENT_COUNT; i++) {
+		assert(send_all(clients[i], "@alice hi\r\nbye", 14));
+		close(clients[i]);
+	}
+
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 3 * CLIENT_COUNT);
+	assert(count_occurrences(&out, "Command: join") == CLIENT_COUNT);
+	assert(count_occurrences(&out, "Direct message to alice: hi\n") ==
+	       CLIENT_COUNT);
+	assert(count_occurrences(&out, "Global message: bye\n") ==
+	       CLIENT_COUNT);
+
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+static void test_split_lines()
+{
+	struct tcp_server server;
+	struct output_sink out;
+
+	assert(tcp_server_open(&server, 0));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	int client = tcp_connect("127.0.0.1", tcp_server_port(&server));
+	assert(client != -1);
+
+	// half a line is not a payload yet
+	assert(send_all(client, "/login alice pa", 15));
+	while (server.connection_count == 0)
+		tcp_server_poll(&server, &out, 100);
+	tcp_server_poll(&server, &out, 100);
+	assert(server.payload_count == 0);
+
+	assert(send_all(client, "ss\n\n/join gen", 13));
+	assert(send_all(client, "eral\n", 5));
+
+	// a line far longer than the initial read buffer
+	char *long_line = malloc(3 * TCP_SERVER_READ_SIZE);
+	assert(long_line);
+
+	memset(long_line, 'x', 3 * TCP_SERVER_READ_SIZE - 1);
+	long_line[3 * TCP_SERVER_READ_SIZE - 1] = '\n';
+	assert(send_all(client, long_line, 3 * TCP_SERVER_READ_SIZE));
+	close(client);
+
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 3);
+	assert(count_occurrences(&out, "[username: alice, password pass]") ==
+	       1);
+	assert(count_occurrences(&out, "[channel: general]") == 1);
+	assert(count_occurrences(&out, "Global message: xxx") == 1);
+
+	free(long_line);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+static void test_too_long_line()
+{
+	struct tcp_server server;
+	struct output_sink out;
+
+	assert(tcp_server_open(&server, 0));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	int client = tcp_connect("127.0.0.1", tcp_server_port(&server));
+	char *line = malloc(TCP_SERVER_MAX_LINE + 1);
+
+	assert(client != -1 && line);
+	memset(line, 'x', TCP_SERVER_MAX_LINE + 1);
+
+	// the server drops the client instead of buffering forever
+	send_all(client, line, TCP_SERVER_MAX_LINE + 1);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 0);
+
+	close(client);
+	free(line);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* lines no parser would accept, each alone on its line */
+static const char *malformed_lines[] = {
+	"/login onlyuser",
+	"/login alice ",
+	"/login",
+	"/join",
+	"/",
+	"/nosuchcommand",
+	"@alice",
+	"#general",
+	"@ hi",
+	"#general @bob",
+	"@nobody hi",   // receivers nobody logged in or joined as
+	"#nowhere hi",
+};
+
+#define MALFORMED_COUNT (sizeof(malformed_lines) / sizeof(*malformed_lines))
+
+static void test_malformed_lines()
+{
+	struct tcp_server server;
+	struct output_sink out;
+
+	assert(tcp_server_open(&server, 0));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+	int client = tcp_connect("127.0.0.1", port);
+	assert(client != -1);
+
+	// the client is ignored line by line, not the server taken down
+	for (size_t i = 0; i < MALFORMED_COUNT; i++) {
+		assert(send_all(client, malformed_lines[i],
+				strlen(malformed_lines[i])));
+		assert(send_all(client, "\n", 1));
+	}
+
+	assert(send_all(client, "/join general\n", 14));
+	close(client);
+
+	while (server.payload_count < 1)
+		tcp_server_poll(&server, &out, 100);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 1);
+
+	// and every other client is still served
+	client = tcp_connect("127.0.0.1", port);
+	assert(client != -1);
+	assert(send_all(client, "@alice hi\n", 10));
+	close(client);
+
+	while (server.payload_count < 2)
+		tcp_server_poll(&server, &out, 100);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 2);
+	assert(count_occurrences(&out, "[channel: general]") == 1);
+	assert(count_occurrences(&out, "Direct message to alice: hi\n") == 1);
+	assert(interned_id("nobody", 6) == INTERN_NONE);
+
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* sends what the socket takes without blocking, returns how much */
+static size_t send_some(int fd, const char *data, size_t len)
+{
+	ssize_t n = send(fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+	return n > 0 ? (size_t) n : 0;
+}
+
+#define FLOOD_LINE "/join general\n"
+#define FLOOD_LINE_LEN (sizeof(FLOOD_LINE) - 1)
+#define FLOOD_LINES 50000
+
+static void test_flood_does_not_starve()
+{
+	struct tcp_server server;
+	struct output_sink out;
+	size_t flood_len = FLOOD_LINES * FLOOD_LINE_LEN;
+	char *flood = malloc(flood_len);
+
+	assert(flood);
+	assert(tcp_server_open(&server, 0));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	for (size_t i = 0; i < FLOOD_LINES; i++)
+		memcpy(flood + i * FLOOD_LINE_LEN, FLOOD_LINE, FLOOD_LINE_LEN);
+
+	uint16_t port = tcp_server_port(&server);
+	int flooder = tcp_connect("127.0.0.1", port);
+	int other = tcp_connect("127.0.0.1", port);
+
+	assert(flooder != -1 && other != -1);
+	while (server.connection_count < 2)
+		tcp_server_poll(&server, &out, 100);
+
+	// more than one turn of the flooder waits in its socket, and a single
+	// line in the other one
+	size_t sent = send_some(flooder, flood, flood_len);
+
+	assert(sent > TCP_SERVER_READ_BUDGET + FLOOD_LINE_LEN);
+	assert(send_all(other, "@bob hi\n", 8));
+
+	while (count_occurrences(&out, "Direct message to bob") == 0)
+		tcp_server_poll(&server, &out, 100);
+
+	// the other client did not wait for the flood to be read
+	assert(server.payload_count < sent / FLOOD_LINE_LEN + 1);
+
+	while (sent < flood_len) {
+		tcp_server_poll(&server, &out, 0);
+		sent += send_some(flooder, flood + sent, flood_len - sent);
+	}
+
+	close(flooder);
+	close(other);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == FLOOD_LINES + 1);
+
+	free(flood);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+int main()
+{
+	// receivers of the messages below, as if they had logged in before
+	intern("alice", 5);
+	intern("bob", 3);
+
+	test_many_clients();
+	test_split_lines();
+	test_too_long_line();
+	test_malformed_lines();
+	test_flood_does_not_starve();
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
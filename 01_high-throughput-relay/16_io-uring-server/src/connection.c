@@ -0,0 +1,114 @@
+#include "connection.h"
+#include "dynamic_dispatch.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+struct connection *connection_new(int fd)
+{
+	struct connection *c = malloc(sizeof(struct connection));
+	assert(c);
+
+	*c = (struct connection) { .fd = fd };
+
+	return c;
+}
+
+static void handle_line(struct line_target *t, const char *line, size_t len)
+{
+	// clients typing into telnet end their lines with \r\n
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+
+	if (len == 0)
+		return;
+
+	// processed already, nothing refers to them anymore
+	if (t->buf->len == LINE_TARGET_BATCH_SIZE) {
+		destroy(t->buf);
+		t->buf = new_buffer();
+	}
+
+	size_t before = t->buf->len;
+
+	push_client_payload(t->buf, line, len);
+
+	if (t->buf->len > before) {
+		process_next(t->buf, t->out);
+		t->processed++;
+	}
+}
+
+/* copies the start of an unfinished line, false if it got too long */
+static bool keep_partial(struct connection *c, const char *data, size_t len)
+{
+	if (len == 0)
+		return true;
+
+	if (c->partial_len + len > CONNECTION_MAX_LINE)
+		return false;
+
+	if (c->partial_len + len > c->partial_cap) {
+		size_t cap = c->partial_cap ? c->partial_cap : 256;
+
+		while (cap < c->partial_len + len)
+			cap *= 2;
+
+		assert((c->partial = realloc(c->partial, sizeof(char) * cap)));
+		c->partial_cap = cap;
+	}
+
+	memcpy(c->partial + c->partial_len, data, len);
+	c->partial_len += len;
+
+	return true;
+}
+
+bool connection_feed(struct connection *c, const char *data, size_t len,
+		     struct line_target *t)
+{
+	const char *end = data + len;
+	const char *newline = memchr(data, '\n', len);
+
+	// the end of the line the previous chunk started
+	if (c->partial_len > 0) {
+		if (newline == NULL)
+			return keep_partial(c, data, len);
+
+		if (!keep_partial(c, data, newline - data))
+			return false;
+
+		handle_line(t, c->partial, c->partial_len);
+		c->partial_len = 0;
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	// lines in the middle are parsed where they are, without a copy
+	while (newline != NULL) {
+		handle_line(t, data, newline - data);
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	return keep_partial(c, data, end - data);
+}
+
+void connection_finish(struct connection *c, struct line_target *t)
+{
+	handle_line(t, c->partial, c->partial_len);
+	c->partial_len = 0;
+}
+
+void connection_free(struct connection *c)
+{
+	close(c->fd);
+	free(c->partial);
+	free(c->backlog);
+	free(c);
+}
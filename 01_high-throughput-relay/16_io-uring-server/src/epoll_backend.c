@@ -0,0 +1,207 @@
+// Edge-triggered epoll only reports that a socket *became* readable. Every
+// event must therefore be handled until read() or accept() says EAGAIN, or
+// the rest of the data would sit in the socket without another event.
+//
+// Every socket that has data costs one read() per chunk, plus the final one
+// that returns EAGAIN.
+//
+// Unless its budget for the round is spent first: then data may be left,
+// and epoll will not report it again. The connection goes on the ready list
+// instead, and reads on in the next round.
+
+// accept4() is a Linux extension
+#define _GNU_SOURCE
+
+#include "output_sink.h"
+#include "tcp_backend.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+/** @brief Bytes read from a socket at a time. */
+#define EPOLL_READ_SIZE (64 << 10)
+
+/** @brief Events handled per epoll_wait() call. */
+#define EPOLL_MAX_EVENTS 256
+
+struct epoll_state {
+	int epoll_fd;
+	char buf[EPOLL_READ_SIZE];  /**< Shared by every connection */
+};
+
+static bool epoll_open(struct tcp_server *s)
+{
+	struct epoll_state *state = malloc(sizeof(struct epoll_state));
+	assert(state);
+
+	state->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	// the listening socket is the only one without a connection
+	struct epoll_event event = {
+		.events = EPOLLIN | EPOLLET,
+		.data.ptr = NULL,
+	};
+	int flags = fcntl(s->listen_fd, F_GETFL);
+
+	if (state->epoll_fd == -1 ||
+	    fcntl(s->listen_fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+	    epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, s->listen_fd,
+		      &event) == -1) {
+		if (state->epoll_fd != -1)
+			close(state->epoll_fd);
+		free(state);
+
+		return false;
+	}
+
+	s->state = state;
+
+	return true;
+}
+
+static void accept_connections(struct tcp_server *s,
+			       struct epoll_state *state)
+{
+	while (true) {
+		int fd = accept4(s->listen_fd, NULL, NULL,
+				 SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if (fd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			// EAGAIN: every pending client is accepted. Others,
+			// e.g. EMFILE, leave clients in the backlog until a
+			// connection is closed.
+			if (errno != EAGAIN)
+				perror("accept4");
+
+			return;
+		}
+
+		struct connection *c = connection_new(fd);
+		struct epoll_event event = {
+			.events = EPOLLIN | EPOLLRDHUP | EPOLLET,
+			.data.ptr = c,
+		};
+
+		if (epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, fd, &event) ==
+		    -1) {
+			perror("epoll_ctl");
+			connection_free(c);
+
+			continue;
+		}
+
+		tcp_server_add(s, c);
+	}
+}
+
+/* what a turn of a connection leaves */
+enum turn {
+	TURN_DRAINED,   /**< Until EAGAIN, epoll reports new data */
+	TURN_READABLE,  /**< Budget spent, data may be left */
+	TURN_CLOSED,    /**< The connection must be closed */
+};
+
+/* reads until the socket is drained or the budget is spent */
+static enum turn read_connection(struct epoll_state *state,
+				 struct connection *c, struct line_target *t)
+{
+	size_t budget = CONNECTION_READ_BUDGET;
+
+	while (budget > 0) {
+		size_t size = budget < EPOLL_READ_SIZE ? budget : EPOLL_READ_SIZE;
+		ssize_t n = read(c->fd, state->buf, size);
+
+		if (n > 0) {
+			if (!connection_feed(c, state->buf, n, t))
+				return TURN_CLOSED;
+
+			budget -= n;
+		} else if (n == 0) {
+			connection_finish(c, t);
+
+			return TURN_CLOSED;
+		} else if (errno == EAGAIN) {
+			return TURN_DRAINED;
+		} else if (errno != EINTR) {
+			return TURN_CLOSED;
+		}
+	}
+
+	return TURN_READABLE;
+}
+
+static void epoll_poll(struct tcp_server *s, struct line_target *t,
+		       int timeout_ms)
+{
+	struct epoll_state *state = s->state;
+	struct epoll_event events[EPOLL_MAX_EVENTS];
+	int count;
+
+	// connections left readable by the last round do not wait
+	if (s->ready)
+		timeout_ms = 0;
+
+	do {
+		count = epoll_wait(state->epoll_fd, events, EPOLL_MAX_EVENTS,
+				   timeout_ms);
+	} while (count == -1 && errno == EINTR);
+
+	for (int i = 0; i < count; i++) {
+		struct connection *c = events[i].data.ptr;
+
+		if (c == NULL)
+			accept_connections(s, state);
+		else
+			tcp_server_mark_ready(s, c);
+	}
+
+	// one turn each, those with data left are queued again
+	struct connection *c = tcp_server_take_ready(s);
+
+	while (c) {
+		struct connection *next = c->ready_next;
+
+		c->is_ready = false;
+
+		// closing the socket also removes it from the epoll set
+		switch (read_connection(state, c, t)) {
+		case TURN_DRAINED:
+			break;
+		case TURN_READABLE:
+			tcp_server_mark_ready(s, c);
+			break;
+		case TURN_CLOSED:
+			tcp_server_remove(s, c);
+			break;
+		}
+
+		c = next;
+	}
+
+	sink_flush(t->out);
+}
+
+static void epoll_close(struct tcp_server *s)
+{
+	struct epoll_state *state = s->state;
+
+	close(state->epoll_fd);
+	free(state);
+}
+
+const struct tcp_backend epoll_backend = {
+	.name = "epoll",
+	.open = epoll_open,
+	.poll = epoll_poll,
+	.close = epoll_close,
+};
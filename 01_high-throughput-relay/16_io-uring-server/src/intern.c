@@ -0,0 +1,251 @@
+// Names live in an arena, so their pointers never move. Their records (a
+// pointer, a length and a hash) live in fixed-size segments, so that an ID
+// is turned into a name with two array lookups, and segments never move
+// either.
+//
+// The hash table maps names to IDs with open addressing. A slot is a single
+// 64-bit word, the hash of the name next to its ID, so that it is published
+// with one atomic store: a reader either sees an empty slot or a complete
+// one. Readers probe without locking. A reader that misses takes the mutex,
+// probes again, and only then adds the name.
+//
+// When the table grows, a new slot array is built and published, but the
+// old one is kept until intern_reset(): a reader may still be probing it.
+// Old arrays add up to less than the current one.
+
+#include "arena.h"
+#include "intern.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/** @brief Records per segment. */
+#define INTERN_SEGMENT_SIZE 4096
+
+/** @brief Chunk size of the arena names are copied to. */
+#define INTERN_ARENA_CHUNK_SIZE (64 << 10)
+
+struct interned {
+	const char *str;
+	uint32_t len;
+	uint32_t hash;
+};
+
+struct slots {
+	struct slots *previous;  /**< Older, smaller array, still readable */
+	size_t mask;             /**< Number of slots minus one */
+	_Atomic uint64_t slot[]; /**< hash << 32 | (ID + 1), 0 when empty */
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(struct slots *) table;
+static atomic_uint count;
+static size_t name_bytes;  /**< Taken by the names, under the lock */
+
+static struct arena names = { .chunk_size = INTERN_ARENA_CHUNK_SIZE };
+static struct interned *segments[INTERN_MAX_NAMES / INTERN_SEGMENT_SIZE];
+
+
+/* 32-bit FNV-1a, names are short */
+static uint32_t hash_name(const char *str, size_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ (uint8_t) str[i]) * 16777619u;
+
+	return hash;
+}
+
+static struct interned *record(uint32_t id)
+{
+	return &segments[id / INTERN_SEGMENT_SIZE][id % INTERN_SEGMENT_SIZE];
+}
+
+static bool find(struct slots *s, uint32_t hash, const char *str, size_t len,
+		 uint32_t *id)
+{
+	for (size_t i = hash & s->mask;; i = (i + 1) & s->mask) {
+		uint64_t slot = atomic_load_explicit(&s->slot[i],
+						     memory_order_acquire);
+
+		if (slot == 0)
+			return false;
+
+		if (slot >> 32 != hash)
+			continue;
+
+		// same hash, the names themselves decide
+		struct interned *r = record((uint32_t) slot - 1);
+
+		if (r->len == len && memcmp(r->str, str, len) == 0) {
+			*id = (uint32_t) slot - 1;
+
+			return true;
+		}
+	}
+}
+
+/* only while holding the lock, or before publishing s */
+static void insert(struct slots *s, uint32_t hash, uint32_t id)
+{
+	size_t i = hash & s->mask;
+
+	while (atomic_load_explicit(&s->slot[i], memory_order_relaxed) != 0)
+		i = (i + 1) & s->mask;
+
+	atomic_store_explicit(&s->slot[i], (uint64_t) hash << 32 | (id + 1),
+			      memory_order_release);
+}
+
+static struct slots *new_slots(size_t slot_count, struct slots *previous)
+{
+	struct slots *s = calloc(1, sizeof(struct slots) +
+				 sizeof(uint64_t) * slot_count);
+	assert(s);
+
+	s->previous = previous;
+	s->mask = slot_count - 1;
+
+	return s;
+}
+
+/* rehashes every name into a table twice as large, and publishes it */
+static struct slots *grow(struct slots *old, uint32_t name_count)
+{
+	size_t slot_count = old ? (old->mask + 1) * 2 : INTERN_INITIAL_SLOTS;
+	struct slots *s = new_slots(slot_count, old);
+
+	for (uint32_t id = 0; id < name_count; id++)
+		insert(s, record(id)->hash, id);
+
+	atomic_store_explicit(&table, s, memory_order_release);
+
+	return s;
+}
+
+static uint32_t add(const char *str, size_t len, uint32_t hash)
+{
+	struct slots *s = atomic_load_explicit(&table, memory_order_relaxed);
+	uint32_t id = atomic_load_explicit(&count, memory_order_relaxed);
+
+	if (id == INTERN_MAX_NAMES || len + 1 > INTERN_MAX_BYTES - name_bytes)
+		return INTERN_NONE;
+
+	// at most half full, probe sequences stay short
+	if (s == NULL || (size_t) (id + 1) * 2 > s->mask + 1)
+		s = grow(s, id);
+
+	if (id % INTERN_SEGMENT_SIZE == 0) {
+		segments[id / INTERN_SEGMENT_SIZE] =
+			malloc(sizeof(struct interned) * INTERN_SEGMENT_SIZE);
+		assert(segments[id / INTERN_SEGMENT_SIZE]);
+	}
+
+	char *copy = arena_alloc(&names, len + 1);
+
+	name_bytes += len + 1;
+
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+
+	*record(id) = (struct interned) {
+		.str = copy,
+		.len = len,
+		.hash = hash,
+	};
+
+	// the record is complete before any reader can find the slot
+	insert(s, hash, id);
+	atomic_store_explicit(&count, id + 1, memory_order_release);
+
+	return id;
+}
+
+uint32_t intern(const char *str, size_t len)
+{
+	uint32_t hash = hash_name(str, len);
+	struct slots *s = atomic_load_explicit(&table, memory_order_acquire);
+	uint32_t id;
+
+	if (s != NULL && find(s, hash, str, len, &id))
+		return id;
+
+	pthread_mutex_lock(&lock);
+
+	// another thread may have added it, or grown the table
+	s = atomic_load_explicit(&table, memory_order_relaxed);
+
+	if (s == NULL || !find(s, hash, str, len, &id))
+		id = add(str, len, hash);
+
+	pthread_mutex_unlock(&lock);
+
+	return id;
+}
+
+uint32_t interned_id(const char *str, size_t len)
+{
+	uint32_t hash = hash_name(str, len);
+	struct slots *s = atomic_load_explicit(&table, memory_order_acquire);
+	uint32_t id;
+
+	if (s != NULL && find(s, hash, str, len, &id))
+		return id;
+
+	// the name may be added meanwhile, to a table grown since
+	pthread_mutex_lock(&lock);
+
+	s = atomic_load_explicit(&table, memory_order_relaxed);
+
+	if (s == NULL || !find(s, hash, str, len, &id))
+		id = INTERN_NONE;
+
+	pthread_mutex_unlock(&lock);
+
+	return id;
+}
+
+const char *interned_name(uint32_t id)
+{
+	return record(id)->str;
+}
+
+size_t interned_len(uint32_t id)
+{
+	return record(id)->len;
+}
+
+size_t interned_count(void)
+{
+	return atomic_load_explicit(&count, memory_order_acquire);
+}
+
+void intern_reset(void)
+{
+	struct slots *s = atomic_load(&table);
+
+	while (s != NULL) {
+		struct slots *previous = s->previous;
+
+		free(s);
+		s = previous;
+	}
+
+	uint32_t name_count = atomic_load(&count);
+
+	for (uint32_t i = 0; i * INTERN_SEGMENT_SIZE < name_count; i++) {
+		free(segments[i]);
+		segments[i] = NULL;
+	}
+
+	arena_destroy(&names);
+	atomic_store(&table, NULL);
+	atomic_store(&count, 0);
+	name_bytes = 0;
+}
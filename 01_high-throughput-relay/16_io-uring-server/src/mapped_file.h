@@ -0,0 +1,62 @@
+/**
+ * @file mapped_file.h
+ * @brief Memory-mapped, read-only view of a payload file.
+ *
+ * Instead of copying the file into a stack buffer with fgets(), the whole file
+ * is mapped into our address space and every line is exposed as a pointer +
+ * length pair pointing directly into the mapping.
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+
+#include "line_view.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/**
+ * @brief A file mapped into memory and a cursor for line iteration.
+ */
+struct mapped_file {
+	const char *data;  /**< Start of the mapping (NULL for empty files) */
+	size_t size;       /**< File size in bytes */
+	size_t cursor;     /**< Offset of the next unread line */
+};
+
+/**
+ * @brief Maps the file at path into memory.
+ *
+ * Mapping is read-only and private. The kernel is told that we will read it
+ * sequentially (`MADV_SEQUENTIAL`), so it reads ahead aggressively and drops
+ * pages behind us. Offsets and sizes are 64-bit, files larger than 4 GiB are
+ * fine.
+ *
+ * @param f Output for the mapped file
+ * @param path Path of the file to map
+ * @return false if the file could not be opened or mapped, or if it is not
+ *         a regular file (pipes and sockets can not be mapped)
+ */
+bool map_file(struct mapped_file *f, const char *path);
+
+/**
+ * @brief Advances to the next line of the mapping.
+ *
+ * Uses a single memchr() per line, so the line is scanned exactly once. The
+ * last line does not need to end with a newline.
+ *
+ * @param f Mapped file
+ * @param line Output, view into the mapping
+ * @return false when there are no lines left
+ */
+bool next_line(struct mapped_file *f, struct line_view *line);
+
+/**
+ * @brief Unmaps the file. Every line_view obtained from it becomes invalid.
+ */
+void unmap_file(struct mapped_file *f);
+
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file tcp_server.h
+ * @brief Relay over TCP, on a single thread, with epoll or io_uring.
+ *
+ * Clients send payloads the way they are stored in a payloads file: one per
+ * line. A single thread serves any number of clients, and sleeps while none
+ * of them sends anything. How it learns about new data is up to a backend:
+ *
+ * - epoll: readiness notifications, then one read() per socket that has
+ *   data, see epoll_backend.c
+ * - io_uring: the kernel receives into buffers of ours, and reports
+ *   completed receives, see uring_backend.c
+ *
+ * Both feed the same framing layer, see connection.h.
+ */
+
+#ifndef TCP_SERVER_H
+#define TCP_SERVER_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+struct connection;
+struct output_sink;
+
+/**
+ * @brief Backend methods, see tcp_backend.h.
+ */
+struct tcp_backend;
+
+/** @brief Uses epoll on every kernel. */
+extern const struct tcp_backend epoll_backend;
+
+/** @brief Uses io_uring, requires Linux 6.0 or later. */
+extern const struct tcp_backend uring_backend;
+
+struct tcp_server {
+	const struct tcp_backend *backend;  /**< The one in use */
+	void *state;                        /**< Of the backend */
+	int listen_fd;
+	struct connection *connections;     /**< Open ones, a linked list */
+	size_t connection_count;
+	struct connection *ready;  /**< Waiting for a turn, see tcp_backend.h */
+	struct connection *ready_tail;
+	size_t payload_count;  /**< Processed since the server was opened */
+};
+
+/**
+ * @brief Listens on every interface.
+ *
+ * If the kernel does not support the requested backend, e.g. io_uring is
+ * too old or disabled, the server falls back to epoll.
+ *
+ * @param s Server to open
+ * @param port TCP port, or 0 for any free port, see tcp_server_port()
+ * @param backend &uring_backend or &epoll_backend
+ * @return false if the socket could not be set up, errno tells why
+ */
+bool tcp_server_open(struct tcp_server *s, uint16_t port,
+		     const struct tcp_backend *backend);
+
+/** @brief Name of the backend in use, "epoll" or "io_uring". */
+const char *tcp_server_backend_name(const struct tcp_server *s);
+
+/** @brief Port the server listens on. */
+uint16_t tcp_server_port(const struct tcp_server *s);
+
+/**
+ * @brief Waits for events once, and handles every one of them.
+ *
+ * New clients are accepted, and every complete line received is parsed and
+ * processed at once, in the order it was read. Lines of one client are
+ * processed in the order they were sent.
+ *
+ * Each connection takes at most CONNECTION_READ_BUDGET bytes per round. One
+ * that has more waits for the next round, which does not wait for events
+ * then, so a client sending without pause does not hold up the others.
+ *
+ * @param s Server
+ * @param out Sink the output of processed payloads is appended to, the same
+ *        one at every call. With epoll, it is flushed before returning. With
+ *        io_uring, its output is queued, and written by the next call or by
+ *        tcp_server_close().
+ * @param timeout_ms Longest wait, -1 to wait until something happens
+ * @return Number of payloads processed
+ */
+size_t tcp_server_poll(struct tcp_server *s, struct output_sink *out,
+		       int timeout_ms);
+
+/**
+ * @brief Closes every connection and the listening socket.
+ *
+ * Unfinished lines of open connections are discarded. Output submitted by
+ * tcp_server_poll() is written before returning.
+ */
+void tcp_server_close(struct tcp_server *s);
+
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * @file channel_registry.h
+ * @brief Which sessions joined which channel, both ways.
+ *
+ * A channel is known by its interned name, see intern.h, and the ID is the
+ * index of the channel in the registry: the hash probe happened when the
+ * name was parsed, finding the members of a channel is one array lookup.
+ * Members of a channel are a contiguous array of session IDs, so a group
+ * message reaches all of them in a single pass.
+ *
+ * Every session also keeps the channels it joined, usually a handful: they
+ * tell whether it is a member already, and what to leave when it goes away.
+ */
+
+#ifndef CHANNEL_REGISTRY_H
+#define CHANNEL_REGISTRY_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Growable array of IDs, the members of a channel or the channels of
+ *        a session.
+ */
+struct id_list {
+	uint32_t *ids;
+	uint32_t len;
+	uint32_t cap;
+};
+
+struct channel_registry {
+	struct id_list *channels;  /**< Members, indexed by channel ID */
+	size_t channel_cap;
+	struct id_list *sessions;  /**< Channels joined, by session ID */
+	size_t session_cap;
+};
+
+
+void channel_registry_init(struct channel_registry *r);
+
+/**
+ * @brief Adds a session to the members of a channel.
+ *
+ * @param r Registry
+ * @param channel Interned channel name
+ * @param session Session ID, small integers keep the registry small, e.g.
+ *        the file descriptor of a connection
+ * @return false if the session already was a member
+ */
+bool channel_join(struct channel_registry *r, uint32_t channel,
+		  uint32_t session);
+
+/**
+ * @brief Removes a session from the members of a channel.
+ *
+ * The last member takes its place, the order of members is not kept.
+ *
+ * @return false if the session was not a member
+ */
+bool channel_leave(struct channel_registry *r, uint32_t channel,
+		   uint32_t session);
+
+/**
+ * @brief Removes a session from every channel it joined, e.g. when its
+ *        connection is closed, before its ID is given to another one.
+ */
+void channel_leave_all(struct channel_registry *r, uint32_t session);
+
+/**
+ * @brief Members of a channel, in no particular order.
+ *
+ * The array is valid until the next join or leave.
+ *
+ * @param r Registry
+ * @param channel Interned channel name
+ * @param count Output for the number of members, 0 if nobody joined
+ */
+const uint32_t *channel_members(const struct channel_registry *r,
+				uint32_t channel, size_t *count);
+
+void channel_registry_destroy(struct channel_registry *r);
+
+
+#endif
@@ -0,0 +1,182 @@
+#include "channel_registry.h"
+#include "connection.h"
+#include "dynamic_dispatch.h"
+#include "intern.h"
+#include "payload.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+struct connection *connection_new(int fd)
+{
+	struct connection *c = malloc(sizeof(struct connection));
+	assert(c);
+
+	*c = (struct connection) { .fd = fd };
+
+	return c;
+}
+
+/*
+ * The line is sent in pieces straight from the payload and the intern table,
+ * the same pieces to every member. A member whose socket cannot take a whole
+ * line does not read its messages: it is shut down, and its backend closes it
+ * like any client that leaves.
+ */
+static void deliver_group_message(const struct line_target *t,
+				  uint32_t channel, const char *content)
+{
+	size_t count;
+	const uint32_t *members = channel_members(t->channels, channel, &count);
+
+	struct iovec pieces[] = {
+		{ "Group message to ", 17 },
+		{ (char *) interned_name(channel), interned_len(channel) },
+		{ ": ", 2 },
+		{ (char *) content, strlen(content) },
+		{ "\n", 1 },
+	};
+	struct msghdr msg = {
+		.msg_iov = pieces,
+		.msg_iovlen = sizeof(pieces) / sizeof(pieces[0]),
+	};
+	size_t len = 0;
+
+	for (size_t i = 0; i < msg.msg_iovlen; i++)
+		len += pieces[i].iov_len;
+
+	for (size_t i = 0; i < count; i++) {
+		ssize_t sent = sendmsg(members[i], &msg,
+				       MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if (sent != (ssize_t) len)
+			shutdown(members[i], SHUT_RDWR);
+	}
+}
+
+/* joins and group messages also act on the channels of the server */
+static void route_payload(const struct connection *c,
+			  const struct line_target *t, const struct payload *p)
+{
+	if (p->vtable == &command_join_vtable) {
+		channel_join(t->channels, p->data.command_join.channel, c->fd);
+
+		return;
+	}
+
+	if (p->vtable != &message_vtable)
+		return;
+
+	const struct message_receiving_entity *receivers = \
+		p->data.message.receivers;
+
+	for (int i = 0; i < p->data.message.receiver_count; i++)
+		if (receivers[i].vtable == &group_message_vtable)
+			deliver_group_message(t, receivers[i].name,
+					      p->data.message.content);
+}
+
+static void handle_line(const struct connection *c, struct line_target *t,
+			const char *line, size_t len)
+{
+	// clients typing into telnet end their lines with \r\n
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+
+	if (len == 0)
+		return;
+
+	// processed already, nothing refers to them anymore
+	if (t->buf->len == LINE_TARGET_BATCH_SIZE) {
+		destroy(t->buf);
+		t->buf = new_buffer();
+	}
+
+	size_t before = t->buf->len;
+
+	push_client_payload(t->buf, line, len);
+
+	if (t->buf->len > before) {
+		process_next(t->buf, t->out);
+		t->processed++;
+
+		if (t->channels)
+			route_payload(c, t,
+				      payload_at(t->buf, t->buf->len - 1));
+	}
+}
+
+/* copies the start of an unfinished line, false if it got too long */
+static bool keep_partial(struct connection *c, const char *data, size_t len)
+{
+	if (len == 0)
+		return true;
+
+	if (c->partial_len + len > CONNECTION_MAX_LINE)
+		return false;
+
+	if (c->partial_len + len > c->partial_cap) {
+		size_t cap = c->partial_cap ? c->partial_cap : 256;
+
+		while (cap < c->partial_len + len)
+			cap *= 2;
+
+		assert((c->partial = realloc(c->partial, sizeof(char) * cap)));
+		c->partial_cap = cap;
+	}
+
+	memcpy(c->partial + c->partial_len, data, len);
+	c->partial_len += len;
+
+	return true;
+}
+
+bool connection_feed(struct connection *c, const char *data, size_t len,
+		     struct line_target *t)
+{
+	const char *end = data + len;
+	const char *newline = memchr(data, '\n', len);
+
+	// the end of the line the previous chunk started
+	if (c->partial_len > 0) {
+		if (newline == NULL)
+			return keep_partial(c, data, len);
+
+		if (!keep_partial(c, data, newline - data))
+			return false;
+
+		handle_line(c, t, c->partial, c->partial_len);
+		c->partial_len = 0;
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	// lines in the middle are parsed where they are, without a copy
+	while (newline != NULL) {
+		handle_line(c, t, data, newline - data);
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	return keep_partial(c, data, end - data);
+}
+
+void connection_finish(struct connection *c, struct line_target *t)
+{
+	handle_line(c, t, c->partial, c->partial_len);
+	c->partial_len = 0;
+}
+
+void connection_free(struct connection *c)
+{
+	close(c->fd);
+	free(c->partial);
+	free(c->backlog);
+	free(c);
+}
@@ -0,0 +1,229 @@
+// Main method in ths file, parse_payload, gets unstructured input (text),
+// parses it into "struct payload". It sets appropriate function pointers.
+//
+// It is hard to write a clean parser with standard C. Parsing of unstructured
+// text input requires lots of edge case/error checking. We shall use external
+// libraries to handle that complexity - actually this approach just transfers
+// complexity into the library's code, e.g. maintained by specialized
+// open-source communities who have already navigated the minefield of
+// edge-case handling, and memory safety.
+//
+// In later chapters, we will use external dependencies to write more clean
+// parsers (http://github.com/metwse/rdesc)
+
+#include "arena.h"
+#include "command_registry.h"
+#include "intern.h"
+#include "payload.h"
+#include "tokenizer.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+
+/* Payloads are allocated from the arena if there is one, or from the heap
+ * otherwise. Heap payloads are freed one by one via their vtable. */
+static void *allocate(struct arena *arena, size_t size)
+{
+	void *ptr = arena ? arena_alloc(arena, size) : malloc(size);
+	assert(ptr);
+
+	return ptr;
+}
+
+static void *reallocate(struct arena *arena, void *ptr, size_t old_size,
+			size_t new_size)
+{
+	void *grown = arena ? arena_realloc(arena, ptr, old_size, new_size)
+			    : realloc(ptr, new_size);
+	assert(grown);
+
+	return grown;
+}
+
+/* copy a token into a new null-terminated string */
+static char *extract_token(struct arena *arena, struct token token)
+{
+	char *copy;
+
+	if (token.len == 0) {
+		return NULL;
+	} else {
+		copy = allocate(arena, sizeof(char) * (token.len + 1));
+
+		memcpy(copy, token.ptr, token.len);
+		copy[token.len] = '\0';
+
+		return copy;
+	}
+}
+
+static bool message_constructor(struct payload *p, const char *raw,
+				size_t len, struct arena *arena,
+				uint32_t (*receiver_id)(const char *, size_t))
+{
+	p->vtable = &message_vtable;
+
+	// Nested polymorphism: each receiver is polymorphic!
+	// They can be direct (@user), group (#channel), or global (no prefix)
+	// Each receiver knows how to transmit and destroy itself shorthand
+	// variable for receivers field
+	struct message_receiving_entity *receivers =
+		allocate(arena, sizeof(struct message_receiving_entity));
+
+	int receiver_count = 0;
+
+	struct tokenizer t;
+	struct token token;
+
+	tokenizer_init(&t, raw, len);
+
+	// Only the receivers are tokenized. As soon as a token is not a
+	// receiver, the rest of the line is the content, and its spaces are
+	// never looked at.
+	size_t content_offset = 0;
+	while (next_token(&t, &token) && token.len > 0 &&
+	       (token.ptr[0] == '@' || token.ptr[0] == '#')) {
+		// lines come from clients, a receiver without a name or a
+		// message without content is theirs to get wrong
+		if (tokenizer_done(&t) || token.len == 1)
+			goto invalid;
+
+		// the same few names on every line, stored once, or looked up
+		// only, see parse_client_payload()
+		uint32_t receiver_name =
+			receiver_id(token.ptr + 1, token.len - 1);
+
+		if (receiver_name == INTERN_NONE)
+			goto invalid;
+
+		if (receiver_count >= 1) {
+			receivers = reallocate(arena, receivers,
+				sizeof(struct message_receiving_entity) *
+				receiver_count,
+				sizeof(struct message_receiving_entity) *
+			        (receiver_count + 1));
+		}
+
+		receivers[receiver_count] = (struct message_receiving_entity) {
+			.name = receiver_name,
+			.vtable = \
+				token.ptr[0] == '@' ?
+				&direct_message_vtable : &group_message_vtable,
+		};
+
+		receiver_count++;
+
+		content_offset = t.pos;
+	}
+
+	// fallback to global message if no receiver found
+	if (content_offset == 0) {
+		receivers->vtable = &global_message_vtable;
+		receiver_count = 1;
+	};
+
+	size_t content_len = len - content_offset;
+
+	p->data.message.content = allocate(arena,
+					   sizeof(char) * (content_len + 1));
+
+	memcpy(p->data.message.content, raw + content_offset, content_len);
+	p->data.message.content[content_len] = '\0';
+	p->data.message.receivers = receivers;
+	p->data.message.receiver_count = receiver_count;
+
+	return true;
+
+invalid:
+	printf("Ignoring invalid message to %.*s\n", (int) token.len,
+	       token.ptr);
+
+	if (arena == NULL)
+		free(receivers);
+
+	return false;
+}
+
+bool construct_command_login(struct payload *p, const struct token *args,
+			     size_t arg_count, struct arena *arena)
+{
+	if (arg_count != 2 || args[0].len == 0 || args[1].len == 0)
+		return false;
+
+	uint32_t username = intern(args[0].ptr, args[0].len);
+
+	// the intern table is full
+	if (username == INTERN_NONE)
+		return false;
+
+	p->data.command_login.username = username;
+	p->data.command_login.password = extract_token(arena, args[1]);
+
+	return true;
+}
+
+bool construct_command_join(struct payload *p, const struct token *args,
+			    size_t arg_count,
+			    [[maybe_unused]] struct arena *arena)
+{
+	if (arg_count < 1 || args[0].len == 0)
+		return false;
+
+	p->data.command_join.channel = intern(args[0].ptr, args[0].len);
+
+	return p->data.command_join.channel != INTERN_NONE;
+}
+
+bool construct_command_logout([[maybe_unused]] struct payload *p,
+			      [[maybe_unused]] const struct token *args,
+			      [[maybe_unused]] size_t arg_count,
+			      [[maybe_unused]] struct arena *arena)
+{
+	return true;
+}
+
+static bool parse_line(struct payload *p, const char *raw, size_t len,
+		       struct arena *arena,
+		       uint32_t (*receiver_id)(const char *, size_t))
+{
+	if (raw[0] == '/') {
+		// command name and its arguments, all in one pass
+		struct token tokens[COMMAND_MAX_ARGUMENTS + 1];
+		size_t token_count = tokenize(raw + 1, len - 1, tokens,
+					      COMMAND_MAX_ARGUMENTS + 1);
+
+		// no more PAIN: a single lookup, no matter how many commands
+		// there are
+		const struct command *command = find_command(tokens[0]);
+
+		if (command == NULL ||
+		    !command->construct(p, tokens + 1, token_count - 1,
+					arena)) {
+			printf("Ignoring invalid command %.*s\n",
+			       (int) tokens[0].len, tokens[0].ptr);
+			return false;
+		}
+
+		p->vtable = command->vtable;
+	} else {
+		return message_constructor(p, raw, len, arena, receiver_id);
+	}
+
+	return true;
+}
+
+bool parse_payload(struct payload *p, const char *raw, size_t len,
+		   struct arena *arena)
+{
+	return parse_line(p, raw, len, arena, intern);
+}
+
+bool parse_client_payload(struct payload *p, const char *raw, size_t len,
+			  struct arena *arena)
+{
+	return parse_line(p, raw, len, arena, interned_id);
+}
@@ -0,0 +1,188 @@
+// The part of the server every backend shares: the listening socket, the
+// list of connections, and the payload buffer of each round.
+
+#include "dynamic_dispatch.h"
+#include "output_sink.h"
+#include "tcp_backend.h"
+#include "tcp_server.h"
+
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+bool tcp_server_open(struct tcp_server *s, uint16_t port,
+		     const struct tcp_backend *backend)
+{
+	*s = (struct tcp_server) { .listen_fd = -1 };
+	channel_registry_init(&s->channels);
+
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+	int reuse = 1;
+
+	// blocking, backends that need otherwise change it
+	s->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (s->listen_fd == -1)
+		return false;
+
+	// a restarted server can listen again while old connections linger
+	setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse,
+		   sizeof(reuse));
+
+	if (bind(s->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+	    listen(s->listen_fd, SOMAXCONN) == -1)
+		goto fail;
+
+	if (backend->open(s)) {
+		s->backend = backend;
+
+		return true;
+	}
+
+	if (backend != &epoll_backend) {
+		fprintf(stderr, "%s is not supported, falling back to epoll\n",
+			backend->name);
+
+		if (epoll_backend.open(s)) {
+			s->backend = &epoll_backend;
+
+			return true;
+		}
+	}
+
+fail:
+	close(s->listen_fd);
+	s->listen_fd = -1;
+
+	return false;
+}
+
+const char *tcp_server_backend_name(const struct tcp_server *s)
+{
+	return s->backend->name;
+}
+
+uint16_t tcp_server_port(const struct tcp_server *s)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+
+	if (getsockname(s->listen_fd, (struct sockaddr *) &addr, &len) == -1)
+		return 0;
+
+	return ntohs(addr.sin_port);
+}
+
+void tcp_server_add(struct tcp_server *s, struct connection *c)
+{
+	c->prev = NULL;
+	c->next = s->connections;
+
+	if (s->connections)
+		s->connections->prev = c;
+
+	s->connections = c;
+	s->connection_count++;
+}
+
+/* the ready list is short and rarely walked, only for a client that
+ * leaves while waiting for its turn */
+static void unlink_ready(struct tcp_server *s, struct connection *c)
+{
+	struct connection **link = &s->ready;
+	struct connection *prev = NULL;
+
+	while (*link && *link != c) {
+		prev = *link;
+		link = &prev->ready_next;
+	}
+
+	if (*link == NULL)
+		return;
+
+	*link = c->ready_next;
+
+	if (s->ready_tail == c)
+		s->ready_tail = prev;
+}
+
+void tcp_server_remove(struct tcp_server *s, struct connection *c)
+{
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		s->connections = c->next;
+
+	if (c->next)
+		c->next->prev = c->prev;
+
+	s->connection_count--;
+
+	if (c->is_ready)
+		unlink_ready(s, c);
+
+	// the descriptor may be reused by the next client
+	channel_leave_all(&s->channels, c->fd);
+	connection_free(c);
+}
+
+void tcp_server_mark_ready(struct tcp_server *s, struct connection *c)
+{
+	if (c->is_ready)
+		return;
+
+	c->is_ready = true;
+	c->ready_next = NULL;
+
+	if (s->ready_tail)
+		s->ready_tail->ready_next = c;
+	else
+		s->ready = c;
+
+	s->ready_tail = c;
+}
+
+struct connection *tcp_server_take_ready(struct tcp_server *s)
+{
+	struct connection *ready = s->ready;
+
+	s->ready = s->ready_tail = NULL;
+
+	return ready;
+}
+
+size_t tcp_server_poll(struct tcp_server *s, struct output_sink *out,
+		       int timeout_ms)
+{
+	// payloads of this round, released by batch
+	struct line_target t = {
+		.buf = new_buffer(),
+		.out = out,
+		.channels = &s->channels,
+	};
+
+	s->backend->poll(s, &t, timeout_ms);
+
+	destroy(t.buf);
+	s->payload_count += t.processed;
+
+	return t.processed;
+}
+
+void tcp_server_close(struct tcp_server *s)
+{
+	while (s->connections)
+		tcp_server_remove(s, s->connections);
+
+	s->backend->close(s);
+	channel_registry_destroy(&s->channels);
+
+	close(s->listen_fd);
+	s->listen_fd = -1;
+}
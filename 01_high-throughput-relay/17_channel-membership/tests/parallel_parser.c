@@ -0,0 +1,111 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/output_sink.h"
+#include "../src/parallel_parser.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* processes every payload of buf into a string */
+static char *process_all(struct payload_buffer *buf, size_t *len)
+{
+	FILE *file = tmpfile();
+	assert(file);
+
+	struct output_sink out;
+	sink_init(&out, fileno(file), OUTPUT_SINK_SIZE);
+
+	while (buf->process_base < buf->len)
+		process_next(buf, &out);
+
+	sink_destroy(&out);
+
+	*len = ftell(file);
+	char *result = malloc(*len + 1);
+	assert(result);
+
+	rewind(file);
+	assert(fread(result, 1, *len, file) == *len);
+	fclose(file);
+
+	return result;
+}
+
+static void check(const char *input, size_t workers)
+{
+	size_t size = strlen(input);
+	struct payload_buffer *sequential = new_buffer();
+	struct payload_buffer *parallel = new_buffer();
+
+	// the reference, one line after the other
+	for (const char *line = input; line < input + size;) {
+		const char *newline = memchr(line, '\n', input + size - line);
+		size_t len = newline ? (size_t) (newline - line)
+				     : (size_t) (input + size - line);
+
+		if (len > 0)
+			push_payload(sequential, line, len);
+
+		line += len + 1;
+	}
+
+	push_payloads_parallel(parallel, input, size, workers);
+	assert(parallel->len == sequential->len);
+
+	size_t expected_len, actual_len;
+	char *expected = process_all(sequential, &expected_len);
+	char *actual = process_all(parallel, &actual_len);
+
+	// same payloads, in the same order
+	assert(actual_len == expected_len);
+	assert(memcmp(actual, expected, expected_len) == 0);
+
+	free(expected);
+	free(actual);
+	destroy(sequential);
+	destroy(parallel);
+}
+
+int main()
+{
+	char *input = malloc(1 << 16);
+	size_t len = 0;
+
+	assert(input);
+
+	for (int i = 0; i < 500; i++) {
+		switch (i % 5) {
+		case 0:
+			len += sprintf(input + len, "/login user%d pass%d\n",
+				       i, i);
+			break;
+		case 1:
+			len += sprintf(input + len, "/join channel%d\n", i);
+			break;
+		case 2:
+			len += sprintf(input + len, "@a%d #b%d message %d\n",
+				       i, i, i);
+			break;
+		case 3:
+			// empty lines are skipped
+			len += sprintf(input + len, "\n\n");
+			break;
+		default:
+			len += sprintf(input + len, "/logout\n");
+		}
+	}
+
+	for (size_t workers = 1; workers <= 16; workers++)
+		check(input, workers);
+
+	// more workers than lines, and no trailing newline
+	check("/join a\n\n/unknown\n/join b", 8);
+	check("/logout", 3);
+	check("", 4);
+
+	free(input);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,237 @@
+#include "channel_registry.h"
+#include "connection.h"
+#include "dynamic_dispatch.h"
+#include "intern.h"
+#include "payload.h"
+#include "session_table.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+struct connection *connection_new(int fd)
+{
+	struct connection *c = malloc(sizeof(struct connection));
+	assert(c);
+
+	*c = (struct connection) { .fd = fd };
+
+	return c;
+}
+
+/** @brief Pieces of a delivered line: prefix, name, ": ", content, "\n". */
+#define LINE_PIECES 5
+
+/* returns the length of the whole line */
+static size_t message_line(struct iovec pieces[LINE_PIECES],
+			   const char *prefix, uint32_t name,
+			   const char *content)
+{
+	pieces[0] = (struct iovec) { (char *) prefix, strlen(prefix) };
+	pieces[1] = (struct iovec) {
+		(char *) interned_name(name), interned_len(name)
+	};
+	pieces[2] = (struct iovec) { ": ", 2 };
+	pieces[3] = (struct iovec) { (char *) content, strlen(content) };
+	pieces[4] = (struct iovec) { "\n", 1 };
+
+	return pieces[0].iov_len + pieces[1].iov_len + 2 + pieces[3].iov_len +
+	       1;
+}
+
+/*
+ * The line is sent in pieces straight from the payload and the intern table,
+ * the same pieces to every recipient. A recipient whose socket cannot take a
+ * whole line does not read its messages: it is shut down, and its backend
+ * closes it like any client that leaves.
+ */
+static void send_line(int fd, struct iovec pieces[LINE_PIECES], size_t len)
+{
+	struct msghdr msg = {
+		.msg_iov = pieces,
+		.msg_iovlen = LINE_PIECES,
+	};
+
+	if (sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t) len)
+		shutdown(fd, SHUT_RDWR);
+}
+
+static void deliver_group_message(const struct line_target *t,
+				  uint32_t channel, const char *content)
+{
+	struct iovec pieces[LINE_PIECES];
+	size_t len = message_line(pieces, "Group message to ", channel,
+				  content);
+	size_t count;
+	const uint32_t *members = channel_members(t->channels, channel, &count);
+
+	for (size_t i = 0; i < count; i++)
+		send_line(members[i], pieces, len);
+}
+
+/* to every connection the user is logged in from */
+static void deliver_direct_message(const struct line_target *t,
+				   uint32_t user, const char *content)
+{
+	struct iovec pieces[LINE_PIECES];
+	size_t len = message_line(pieces, "Direct message to ", user, content);
+
+	for (size_t i = session_find(t->sessions, user); i != SESSION_NONE;
+	     i = session_find_next(t->sessions, i))
+		send_line(t->sessions->slots[i].fd, pieces, len);
+}
+
+void connection_logout(struct connection *c, struct session_table *sessions)
+{
+	if (c->is_logged_in)
+		session_logout(sessions, c->user, c->fd);
+
+	c->is_logged_in = false;
+}
+
+/* commands and messages also act on the channels and sessions of the server */
+static void route_payload(struct connection *c, const struct line_target *t,
+			  const struct payload *p)
+{
+	if (p->vtable == &command_join_vtable) {
+		channel_join(t->channels, p->data.command_join.channel, c->fd);
+
+		return;
+	}
+
+	// logging in as someone else logs out first
+	if (p->vtable == &command_login_vtable) {
+		connection_logout(c, t->sessions);
+		session_login(t->sessions, p->data.command_login.username,
+			      c->fd);
+		c->user = p->data.command_login.username;
+		c->is_logged_in = true;
+
+		return;
+	}
+
+	if (p->vtable == &command_logout_vtable) {
+		connection_logout(c, t->sessions);
+
+		return;
+	}
+
+	if (p->vtable != &message_vtable)
+		return;
+
+	const struct message_receiving_entity *receivers = \
+		p->data.message.receivers;
+
+	for (int i = 0; i < p->data.message.receiver_count; i++) {
+		if (receivers[i].vtable == &group_message_vtable)
+			deliver_group_message(t, receivers[i].name,
+					      p->data.message.content);
+		else if (receivers[i].vtable == &direct_message_vtable)
+			deliver_direct_message(t, receivers[i].name,
+					       p->data.message.content);
+	}
+}
+
+static void handle_line(struct connection *c, struct line_target *t,
+			const char *line, size_t len)
+{
+	// clients typing into telnet end their lines with \r\n
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+
+	if (len == 0)
+		return;
+
+	// processed already, nothing refers to them anymore
+	if (t->buf->len == LINE_TARGET_BATCH_SIZE) {
+		destroy(t->buf);
+		t->buf = new_buffer();
+	}
+
+	size_t before = t->buf->len;
+
+	push_client_payload(t->buf, line, len);
+
+	if (t->buf->len > before) {
+		process_next(t->buf, t->out);
+		t->processed++;
+
+		if (t->channels && t->sessions)
+			route_payload(c, t,
+				      payload_at(t->buf, t->buf->len - 1));
+	}
+}
+
+/* copies the start of an unfinished line, false if it got too long */
+static bool keep_partial(struct connection *c, const char *data, size_t len)
+{
+	if (len == 0)
+		return true;
+
+	if (c->partial_len + len > CONNECTION_MAX_LINE)
+		return false;
+
+	if (c->partial_len + len > c->partial_cap) {
+		size_t cap = c->partial_cap ? c->partial_cap : 256;
+
+		while (cap < c->partial_len + len)
+			cap *= 2;
+
+		assert((c->partial = realloc(c->partial, sizeof(char) * cap)));
+		c->partial_cap = cap;
+	}
+
+	memcpy(c->partial + c->partial_len, data, len);
+	c->partial_len += len;
+
+	return true;
+}
+
+bool connection_feed(struct connection *c, const char *data, size_t len,
+		     struct line_target *t)
+{
+	const char *end = data + len;
+	const char *newline = memchr(data, '\n', len);
+
+	// the end of the line the previous chunk started
+	if (c->partial_len > 0) {
+		if (newline == NULL)
+			return keep_partial(c, data, len);
+
+		if (!keep_partial(c, data, newline - data))
+			return false;
+
+		handle_line(c, t, c->partial, c->partial_len);
+		c->partial_len = 0;
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	// lines in the middle are parsed where they are, without a copy
+	while (newline != NULL) {
+		handle_line(c, t, data, newline - data);
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	return keep_partial(c, data, end - data);
+}
+
+void connection_finish(struct connection *c, struct line_target *t)
+{
+	handle_line(c, t, c->partial, c->partial_len);
+	c->partial_len = 0;
+}
+
+void connection_free(struct connection *c)
+{
+	close(c->fd);
+	free(c->partial);
+	free(c->backlog);
+	free(c);
+}
@@ -0,0 +1,122 @@
+/**
+ * @file connection.h
+ * @brief A client of the TCP server, and the framing of its stream.
+ *
+ * Every backend of the server receives bytes its own way, and feeds them to
+ * the connection they came from. The connection cuts them into lines, and
+ * parses and processes every complete one at once. Only the unfinished line
+ * at the end of a chunk is copied, to wait for the rest of it.
+ *
+ * A connection is also a session of the channel registry, known by its file
+ * descriptor: what it joins, it leaves when it is closed. Group messages are
+ * delivered to the sockets of every member of their channels.
+ *
+ * Logging in adds the connection to the session table, under the username:
+ * direct messages are delivered to every connection of the user.
+ */
+
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Longest line a client may send, longer ones drop the client. */
+#define CONNECTION_MAX_LINE (64 << 10)
+
+/**
+ * @brief Bytes a connection takes per round, before the others get their
+ *        turn, see tcp_server_poll().
+ */
+#define CONNECTION_READ_BUDGET (64 << 10)
+
+/**
+ * @brief Payloads of a round released together.
+ *
+ * A round lasts as long as clients keep sending, its payloads are released
+ * by batch once they are processed.
+ */
+#define LINE_TARGET_BATCH_SIZE 4096
+
+struct channel_registry;
+struct output_sink;
+struct payload_buffer;
+struct session_table;
+
+/**
+ * @brief Where complete lines go.
+ */
+struct line_target {
+	struct payload_buffer *buf;  /**< Parsed payloads, of the current round */
+	struct output_sink *out;     /**< Output of processed payloads */
+	struct channel_registry *channels;  /**< Of the server, or NULL */
+	struct session_table *sessions;     /**< Of the server, or NULL */
+	size_t processed;            /**< Payloads processed so far */
+};
+
+struct connection {
+	int fd;
+	char *partial;       /**< Unfinished line, NULL until one is needed */
+	size_t partial_len;
+	size_t partial_cap;
+	bool is_dropped;     /**< Sent a line that is too long */
+
+	// taking turns, see tcp_server_poll()
+	bool is_ready;       /**< On the ready list, its turn is coming */
+	struct connection *ready_next;
+	unsigned round;      /**< Round turn_bytes were taken in */
+	size_t turn_bytes;   /**< Taken in that round */
+
+	// io_uring only, see uring_backend.c
+	char *backlog;       /**< Received beyond the budget, not fed yet */
+	size_t backlog_begin;  /**< Fed part, backlog[backlog_begin, len) */
+	size_t backlog_len;
+	size_t backlog_cap;
+	bool is_receiving;   /**< A receive is armed */
+	bool is_paused;      /**< Its receive is cancelled until its turn */
+	bool is_finished;    /**< The stream ended, the backlog did not */
+
+	bool is_logged_in;
+	uint32_t user;       /**< Interned username, if logged in */
+	struct connection *prev;
+	struct connection *next;
+};
+
+/**
+ * @brief Allocates a connection for an accepted socket, now owned by it.
+ */
+struct connection *connection_new(int fd);
+
+/**
+ * @brief Handles every complete line of data, keeps the unfinished end.
+ *
+ * @param c Connection data was received from
+ * @param data Bytes received, in stream order
+ * @param len Length of data
+ * @param t Where to parse and process lines
+ * @return false if the pending line is longer than CONNECTION_MAX_LINE, the
+ *         connection must be dropped then
+ */
+bool connection_feed(struct connection *c, const char *data, size_t len,
+		     struct line_target *t);
+
+/**
+ * @brief Handles the last line of a stream, the one without a newline.
+ */
+void connection_finish(struct connection *c, struct line_target *t);
+
+/**
+ * @brief Removes the session of the connection, if it is logged in.
+ */
+void connection_logout(struct connection *c, struct session_table *sessions);
+
+/**
+ * @brief Closes the socket and frees the connection.
+ */
+void connection_free(struct connection *c);
+
+
+#endif
@@ -0,0 +1,24 @@
+/**
+ * @file line_view.h
+ * @brief Non-owning view of one input line.
+ */
+
+#ifndef LINE_VIEW_H
+#define LINE_VIEW_H
+
+
+#include <stddef.h>
+
+
+/**
+ * @brief Non-owning view of one line, without the trailing newline.
+ *
+ * @note `ptr` is NOT null-terminated. Always use `len`.
+ */
+struct line_view {
+	const char *ptr;  /**< First character of the line */
+	size_t len;       /**< Number of characters, '\n' excluded */
+};
+
+
+#endif
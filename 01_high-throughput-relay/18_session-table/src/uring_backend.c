@@ -0,0 +1,713 @@
+// io_uring is a pair of rings shared with the kernel: we put requests into
+// the submission queue, the kernel puts their results into the completion
+// queue. A single io_uring_enter() call submits every queued request and
+// waits for results, so a round of the server costs one system call, however
+// many clients sent something.
+//
+// Three features make the common case free of system calls:
+//
+// - multishot accept: one request accepts every client, until cancelled
+// - multishot receive: one request per connection receives every chunk the
+//   client sends, each one reported as a completion
+// - provided buffers: receives pick a buffer from a ring we fill, instead of
+//   each having a buffer of its own waiting for a slow client
+//
+// Output is transmitted the same way. The sink's buffer is queued as a write
+// request, submitted by the next io_uring_enter() along with the rest, and
+// the sink goes on with a second buffer meanwhile.
+//
+// A multishot receive keeps receiving as long as the client sends. A
+// connection that took its budget for the round has its receive cancelled,
+// and what was received before the cancel took effect waits in its backlog.
+// Its next turn feeds the backlog, and arms a new receive once it is empty;
+// meanwhile the data left waits in the socket. A round only handles the
+// completions that were there when it started, so it ends.
+//
+// liburing would wrap most of this, we use the system calls directly, there
+// are only three of them.
+
+#include "output_sink.h"
+#include "tcp_backend.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+/** @brief Requests the submission queue holds. */
+#define URING_ENTRIES 256
+
+/** @brief Completions the completion queue holds, receives come in bursts. */
+#define URING_CQ_ENTRIES 4096
+
+/** @brief Provided buffers, a power of two. */
+#define URING_BUF_COUNT 256
+
+/** @brief Size of each provided buffer. */
+#define URING_BUF_SIZE (16 << 10)
+
+#define URING_BUF_GROUP 0
+
+/* user_data of requests that are not a receive, whose user_data is their
+ * connection; connections are aligned, never at these addresses */
+#define ACCEPT_TAG 1
+#define WRITE_TAG 2
+#define CANCEL_TAG 3
+#define PROBE_TAG 4
+
+struct uring_state {
+	int fd;
+
+	// submission queue, shared with the kernel
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned sq_entries;
+	unsigned sq_local_tail;  /**< Includes requests not yet submitted */
+	unsigned pending;        /**< Requests not yet submitted */
+	struct io_uring_sqe *sqes;
+
+	// completion queue, shared with the kernel
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+
+	// provided buffers
+	struct io_uring_buf_ring *buf_ring;
+	char *bufs;
+	uint16_t buf_tail;
+
+	bool is_accept_paused;  /**< Out of file descriptors */
+	unsigned round;         /**< Rounds polled so far */
+
+	// output being written
+	char *write_buf;    /**< The sink's previous buffer */
+	size_t write_cap;
+	size_t write_len;
+	size_t write_done;  /**< Written so far, writes may be short */
+	int write_fd;
+	bool is_writing;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg, unsigned count)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+/* submits queued requests, and waits for wait_nr completions */
+static int uring_enter(struct uring_state *u, unsigned wait_nr,
+		       int timeout_ms)
+{
+	struct __kernel_timespec ts = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (timeout_ms % 1000) * 1000000L,
+	};
+	struct io_uring_getevents_arg arg = {
+		.sigmask_sz = _NSIG / 8,
+		.ts = (uintptr_t) &ts,
+	};
+	unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+	void *argp = NULL;
+	size_t arg_size = 0;
+
+	if (wait_nr > 0 && timeout_ms >= 0) {
+		flags |= IORING_ENTER_EXT_ARG;
+		argp = &arg;
+		arg_size = sizeof(arg);
+	}
+
+	// requests become visible to the kernel once the tail moves
+	__atomic_store_n(u->sq_tail, u->sq_local_tail, __ATOMIC_RELEASE);
+
+	int ret;
+
+	do {
+		ret = syscall(__NR_io_uring_enter, u->fd, u->pending, wait_nr,
+			      flags, argp, arg_size);
+	} while (ret == -1 && errno == EINTR);
+
+	// ETIME: timed out, not an error
+	if (ret > 0)
+		u->pending -= ret;
+
+	return ret;
+}
+
+/* next free request, zeroed, submitted by the next uring_enter() */
+static struct io_uring_sqe *next_sqe(struct uring_state *u)
+{
+	// a full queue is submitted early
+	if (u->sq_local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) ==
+	    u->sq_entries)
+		uring_enter(u, 0, -1);
+
+	unsigned index = u->sq_local_tail & *u->sq_mask;
+	struct io_uring_sqe *sqe = &u->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	u->sq_array[index] = index;
+	u->sq_local_tail++;
+	u->pending++;
+
+	return sqe;
+}
+
+/* oldest unhandled completion, copied out of the ring, false if none */
+static bool next_cqe(struct uring_state *u, struct io_uring_cqe *cqe)
+{
+	unsigned head = *u->cq_head;
+
+	if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+
+	*cqe = u->cqes[head & *u->cq_mask];
+	__atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/* gives a buffer back to the kernel */
+static void provide_buffer(struct uring_state *u, uint16_t bid)
+{
+	struct io_uring_buf *b =
+		&u->buf_ring->bufs[u->buf_tail & (URING_BUF_COUNT - 1)];
+
+	b->addr = (uintptr_t) (u->bufs + (size_t) bid * URING_BUF_SIZE);
+	b->len = URING_BUF_SIZE;
+	b->bid = bid;
+
+	u->buf_tail++;
+	__atomic_store_n(&u->buf_ring->tail, u->buf_tail, __ATOMIC_RELEASE);
+}
+
+static void arm_accept(struct uring_state *u, int listen_fd)
+{
+	struct io_uring_sqe *sqe = next_sqe(u);
+
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = listen_fd;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->accept_flags = SOCK_CLOEXEC;
+	sqe->user_data = ACCEPT_TAG;
+}
+
+static void arm_recv(struct uring_state *u, int fd, uint64_t user_data)
+{
+	struct io_uring_sqe *sqe = next_sqe(u);
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUF_GROUP;
+	sqe->user_data = user_data;
+}
+
+static void cancel_recv(struct uring_state *u, struct connection *c)
+{
+	struct io_uring_sqe *sqe = next_sqe(u);
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->addr = (uintptr_t) c;
+	sqe->user_data = CANCEL_TAG;
+}
+
+static void submit_write(struct uring_state *u)
+{
+	struct io_uring_sqe *sqe = next_sqe(u);
+
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = u->write_fd;
+	sqe->addr = (uintptr_t) (u->write_buf + u->write_done);
+	sqe->len = u->write_len - u->write_done;
+	sqe->off = (uint64_t) -1;  // at the current position, like write()
+	sqe->user_data = WRITE_TAG;
+}
+
+static void write_completed(struct uring_state *u, int res)
+{
+	if (res <= 0) {
+		fprintf(stderr, "io_uring write: %s\n", strerror(-res));
+		u->is_writing = false;
+
+		return;
+	}
+
+	u->write_done += res;
+
+	// a full pipe takes part of the buffer, write the rest
+	if (u->write_done < u->write_len)
+		submit_write(u);
+	else
+		u->is_writing = false;
+}
+
+/* queues the sink's output, and hands the sink a fresh buffer */
+static void queue_output(struct uring_state *u, struct output_sink *out)
+{
+	if (out->fd == SINK_MEMORY || out->len == 0 || u->is_writing)
+		return;
+
+	if (u->write_buf == NULL) {
+		u->write_cap = out->cap;
+		u->write_buf = malloc(sizeof(char) * u->write_cap);
+		assert(u->write_buf);
+	}
+
+	char *buf = u->write_buf;
+	size_t cap = u->write_cap;
+
+	u->write_buf = out->buf;
+	u->write_cap = out->cap;
+	u->write_len = out->len;
+	u->write_done = 0;
+	u->write_fd = out->fd;
+	u->is_writing = true;
+
+	out->buf = buf;
+	out->cap = cap;
+	out->len = 0;
+
+	submit_write(u);
+}
+
+/* unmaps and frees whatever open() got to set up */
+static void uring_destroy(struct uring_state *u)
+{
+	if (u->fd != -1)
+		close(u->fd);
+
+	if (u->sq_ring)
+		munmap(u->sq_ring, u->sq_ring_size);
+
+	if (u->cq_ring)
+		munmap(u->cq_ring, u->cq_ring_size);
+
+	if (u->sqes)
+		munmap(u->sqes, u->sqes_size);
+
+	if (u->buf_ring)
+		munmap(u->buf_ring, URING_BUF_COUNT * sizeof(struct io_uring_buf));
+
+	free(u->bufs);
+	free(u->write_buf);
+	free(u);
+}
+
+static void *map_ring(int fd, size_t size, off_t offset)
+{
+	void *ring = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, fd, offset);
+
+	return ring == MAP_FAILED ? NULL : ring;
+}
+
+static bool map_rings(struct uring_state *u, const struct io_uring_params *p)
+{
+	u->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+	u->cq_ring_size = p->cq_off.cqes +
+		p->cq_entries * sizeof(struct io_uring_cqe);
+	u->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+
+	u->sq_ring = map_ring(u->fd, u->sq_ring_size, IORING_OFF_SQ_RING);
+	u->cq_ring = map_ring(u->fd, u->cq_ring_size, IORING_OFF_CQ_RING);
+	u->sqes = map_ring(u->fd, u->sqes_size, IORING_OFF_SQES);
+
+	if (!u->sq_ring || !u->cq_ring || !u->sqes)
+		return false;
+
+	char *sq = u->sq_ring, *cq = u->cq_ring;
+
+	u->sq_head = (unsigned *) (sq + p->sq_off.head);
+	u->sq_tail = (unsigned *) (sq + p->sq_off.tail);
+	u->sq_mask = (unsigned *) (sq + p->sq_off.ring_mask);
+	u->sq_array = (unsigned *) (sq + p->sq_off.array);
+	u->sq_entries = p->sq_entries;
+	u->sq_local_tail = *u->sq_tail;
+
+	u->cq_head = (unsigned *) (cq + p->cq_off.head);
+	u->cq_tail = (unsigned *) (cq + p->cq_off.tail);
+	u->cq_mask = (unsigned *) (cq + p->cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *) (cq + p->cq_off.cqes);
+
+	return true;
+}
+
+static bool register_buffers(struct uring_state *u)
+{
+	// the ring must be page-aligned, mmap gives whole pages
+	void *ring = mmap(NULL, URING_BUF_COUNT * sizeof(struct io_uring_buf),
+			  PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+			  -1, 0);
+
+	if (ring == MAP_FAILED)
+		return false;
+
+	u->buf_ring = ring;
+	u->bufs = malloc((size_t) URING_BUF_COUNT * URING_BUF_SIZE);
+	assert(u->bufs);
+
+	struct io_uring_buf_reg reg = {
+		.ring_addr = (uintptr_t) ring,
+		.ring_entries = URING_BUF_COUNT,
+		.bgid = URING_BUF_GROUP,
+	};
+
+	// before Linux 5.19, EINVAL
+	if (uring_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1)
+		return false;
+
+	for (uint16_t bid = 0; bid < URING_BUF_COUNT; bid++)
+		provide_buffer(u, bid);
+
+	return true;
+}
+
+/* multishot receive came with Linux 6.0, older kernels reject the flag; a
+ * receive on a socket pair tells */
+static bool probe_multishot_recv(struct uring_state *u)
+{
+	int pair[2];
+	struct io_uring_cqe cqe;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == -1)
+		return false;
+
+	arm_recv(u, pair[0], PROBE_TAG);
+	write(pair[1], "x", 1);
+
+	while (!next_cqe(u, &cqe))
+		uring_enter(u, 1, -1);
+
+	bool is_supported = cqe.res == 1;
+
+	if (cqe.flags & IORING_CQE_F_BUFFER)
+		provide_buffer(u, cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+	// end of stream ends the receive
+	close(pair[1]);
+
+	while (cqe.flags & IORING_CQE_F_MORE)
+		while (!next_cqe(u, &cqe))
+			uring_enter(u, 1, -1);
+
+	close(pair[0]);
+
+	return is_supported;
+}
+
+static bool uring_open(struct tcp_server *s)
+{
+	struct uring_state *u = calloc(1, sizeof(struct uring_state));
+	assert(u);
+
+	struct io_uring_params p = {
+		.flags = IORING_SETUP_CQSIZE,
+		.cq_entries = URING_CQ_ENTRIES,
+	};
+
+	// ENOSYS without io_uring, EPERM when disabled by kernel.io_uring_disabled
+	u->fd = uring_setup(URING_ENTRIES, &p);
+
+	if (u->fd == -1 || !(p.features & IORING_FEAT_EXT_ARG) ||
+	    !map_rings(u, &p) || !register_buffers(u) ||
+	    !probe_multishot_recv(u)) {
+		uring_destroy(u);
+
+		return false;
+	}
+
+	arm_accept(u, s->listen_fd);
+	s->state = u;
+
+	return true;
+}
+
+static void start_recv(struct uring_state *u, struct connection *c)
+{
+	arm_recv(u, c->fd, (uintptr_t) c);
+	c->is_receiving = true;
+	c->is_paused = false;
+}
+
+static void accept_completed(struct tcp_server *s, struct uring_state *u,
+			     const struct io_uring_cqe *cqe)
+{
+	if (cqe->res >= 0) {
+		struct connection *c = connection_new(cqe->res);
+
+		tcp_server_add(s, c);
+		start_recv(u, c);
+	} else if (cqe->res == -EMFILE || cqe->res == -ENFILE) {
+		// accepting again would fail at once, wait for a close
+		u->is_accept_paused = true;
+
+		return;
+	}
+
+	if (!(cqe->flags & IORING_CQE_F_MORE))
+		arm_accept(u, s->listen_fd);
+}
+
+static void remove_connection(struct tcp_server *s, struct uring_state *u,
+			      struct connection *c)
+{
+	tcp_server_remove(s, c);
+
+	if (u->is_accept_paused) {
+		u->is_accept_paused = false;
+		arm_accept(u, s->listen_fd);
+	}
+}
+
+/* stops handling c, its receive is cancelled if one is armed */
+static void drop(struct uring_state *u, struct connection *c)
+{
+	if (c->is_receiving && !c->is_paused)
+		cancel_recv(u, c);
+
+	c->is_dropped = true;
+	c->is_paused = true;
+	c->backlog_begin = c->backlog_len = 0;
+}
+
+/* the budget of c is spent, it waits for its next turn */
+static void wait_turn(struct tcp_server *s, struct uring_state *u,
+		      struct connection *c)
+{
+	if (c->is_receiving && !c->is_paused)
+		cancel_recv(u, c);
+
+	c->is_paused = true;
+	tcp_server_mark_ready(s, c);
+}
+
+static void keep_backlog(struct connection *c, const char *data, size_t len)
+{
+	if (c->backlog_len + len > c->backlog_cap && c->backlog_begin > 0) {
+		memmove(c->backlog, c->backlog + c->backlog_begin,
+			c->backlog_len - c->backlog_begin);
+		c->backlog_len -= c->backlog_begin;
+		c->backlog_begin = 0;
+	}
+
+	if (c->backlog_len + len > c->backlog_cap) {
+		size_t cap = c->backlog_cap ? c->backlog_cap : URING_BUF_SIZE;
+
+		while (cap < c->backlog_len + len)
+			cap *= 2;
+
+		assert((c->backlog = realloc(c->backlog, sizeof(char) * cap)));
+		c->backlog_cap = cap;
+	}
+
+	memcpy(c->backlog + c->backlog_len, data, len);
+	c->backlog_len += len;
+}
+
+/* counts bytes taken by c in the current round */
+static void take_bytes(struct uring_state *u, struct connection *c,
+		       size_t len)
+{
+	if (c->round != u->round) {
+		c->round = u->round;
+		c->turn_bytes = 0;
+	}
+
+	c->turn_bytes += len;
+}
+
+/* feeds received data, or keeps it for the next turn of c */
+static void take_data(struct tcp_server *s, struct uring_state *u,
+		      struct connection *c, const char *data, size_t len,
+		      struct line_target *t)
+{
+	take_bytes(u, c, 0);
+
+	// behind the backlog, or beyond the budget
+	if (c->backlog_len > 0 || c->turn_bytes >= CONNECTION_READ_BUDGET) {
+		keep_backlog(c, data, len);
+		return;
+	}
+
+	if (!connection_feed(c, data, len, t)) {
+		drop(u, c);
+		return;
+	}
+
+	take_bytes(u, c, len);
+
+	if (c->turn_bytes >= CONNECTION_READ_BUDGET)
+		wait_turn(s, u, c);
+}
+
+/* the receive of c ended, and c is not waiting for its turn */
+static void settle(struct tcp_server *s, struct uring_state *u,
+		   struct connection *c, struct line_target *t)
+{
+	if (c->is_dropped) {
+		remove_connection(s, u, c);
+	} else if (c->is_finished) {
+		connection_finish(c, t);
+		remove_connection(s, u, c);
+	} else {
+		// cancelled for its turn, or stopped, e.g. the completion
+		// queue overflowed or every buffer was in use
+		start_recv(u, c);
+	}
+}
+
+static void recv_completed(struct tcp_server *s, struct uring_state *u,
+			   const struct io_uring_cqe *cqe,
+			   struct line_target *t)
+{
+	struct connection *c = (struct connection *) (uintptr_t) cqe->user_data;
+
+	if (!(cqe->flags & IORING_CQE_F_MORE))
+		c->is_receiving = false;
+
+	if (cqe->res > 0) {
+		uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+		const char *data = u->bufs + (size_t) bid * URING_BUF_SIZE;
+
+		if (!c->is_dropped)
+			take_data(s, u, c, data, cqe->res, t);
+
+		provide_buffer(u, bid);
+	} else if (cqe->res == 0) {
+		// end of stream, after the backlog
+		c->is_finished = true;
+	} else if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+		c->is_dropped = true;
+	}
+
+	// until the receive ends, or the turn of c comes: nothing refers to
+	// c anymore after settle()
+	if (!c->is_receiving && !c->is_ready)
+		settle(s, u, c, t);
+}
+
+/* feeds up to a budget of the backlog of c */
+static void take_turn(struct tcp_server *s, struct uring_state *u,
+		      struct connection *c, struct line_target *t)
+{
+	size_t len = c->backlog_len - c->backlog_begin;
+
+	if (len > CONNECTION_READ_BUDGET)
+		len = CONNECTION_READ_BUDGET;
+
+	c->is_ready = false;
+	c->round = u->round;
+	c->turn_bytes = len;
+
+	if (len > 0) {
+		if (!connection_feed(c, c->backlog + c->backlog_begin, len,
+				     t)) {
+			drop(u, c);
+		} else if ((c->backlog_begin += len) == c->backlog_len) {
+			c->backlog_begin = c->backlog_len = 0;
+		} else {
+			tcp_server_mark_ready(s, c);
+			return;
+		}
+	}
+
+	if (!c->is_receiving)
+		settle(s, u, c, t);
+}
+
+static void uring_poll(struct tcp_server *s, struct line_target *t,
+		       int timeout_ms)
+{
+	struct uring_state *u = s->state;
+	struct io_uring_cqe cqe;
+	int fd = t->out->fd;
+
+	// connections with a backlog left do not wait
+	uring_enter(u, 1, s->ready ? 0 : timeout_ms);
+	u->round++;
+
+	// the sink must not write behind the back of a write in progress,
+	// it grows in memory until the end of the round instead
+	if (u->is_writing)
+		t->out->fd = SINK_MEMORY;
+
+	// one turn each, those with a backlog left are queued again
+	struct connection *c = tcp_server_take_ready(s);
+
+	while (c) {
+		struct connection *next = c->ready_next;
+
+		take_turn(s, u, c, t);
+		c = next;
+	}
+
+	// completions arriving meanwhile wait for the next round
+	unsigned end = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+
+	while (*u->cq_head != end && next_cqe(u, &cqe)) {
+		switch (cqe.user_data) {
+		case ACCEPT_TAG:
+			accept_completed(s, u, &cqe);
+			break;
+		case WRITE_TAG:
+			write_completed(u, cqe.res);
+			break;
+		case CANCEL_TAG:
+			break;
+		default:
+			recv_completed(s, u, &cqe, t);
+			break;
+		}
+	}
+
+	t->out->fd = fd;
+	queue_output(u, t->out);
+}
+
+static void uring_close(struct tcp_server *s)
+{
+	struct uring_state *u = s->state;
+	struct io_uring_cqe cqe;
+
+	// the buffer being written is ours, wait until the kernel is done
+	// with it; connections are gone, their completions are ignored
+	while (u->is_writing) {
+		uring_enter(u, 1, -1);
+
+		while (next_cqe(u, &cqe))
+			if (cqe.user_data == WRITE_TAG)
+				write_completed(u, cqe.res);
+	}
+
+	uring_destroy(u);
+}
+
+const struct tcp_backend uring_backend = {
+	.name = "io_uring",
+	.open = uring_open,
+	.poll = uring_poll,
+	.close = uring_close,
+};
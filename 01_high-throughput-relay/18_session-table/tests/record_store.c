@@ -0,0 +1,210 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/intern.h"
+#include "../src/output_sink.h"
+#include "../src/record_store.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const char *lines[] = {
+	"/login alice pass123", "/join general", "@alice @bob Hello everyone!",
+	"#general #random Check this out!", "Global message to all",
+	"/logout", "@carol #general @alice  two  spaces ",
+};
+
+#define LINE_COUNT (sizeof(lines) / sizeof(*lines))
+
+static void test_record_size()
+{
+	// sixteen records per pair of cache lines
+	assert(sizeof(struct record) == 8);
+	assert(16 * sizeof(struct record) <= 128);
+}
+
+static void test_same_output_as_payloads()
+{
+	struct payload_buffer *buf = new_buffer();
+	struct record_store store;
+	struct output_sink expected, actual;
+
+	record_store_init(&store);
+	sink_init(&expected, SINK_MEMORY, 16);
+	sink_init(&actual, SINK_MEMORY, 16);
+
+	for (int i = 0; i < 1000; i++) {
+		const char *line = lines[(i * 5 + i / 4) % LINE_COUNT];
+
+		push_payload(buf, line, strlen(line));
+		assert(record_store_push(&store, line, strlen(line)));
+	}
+
+	assert(store.len == buf->len);
+
+	while (buf->process_base < buf->len)
+		process_next(buf, &expected);
+	record_store_dispatch(&store, &actual);
+
+	assert(actual.len == expected.len);
+	assert(memcmp(actual.buf, expected.buf, actual.len) == 0);
+
+	sink_destroy(&expected);
+	sink_destroy(&actual);
+	record_store_destroy(&store);
+	destroy(buf);
+}
+
+static void test_fields()
+{
+	struct record_store store;
+
+	record_store_init(&store);
+	record_store_reserve(&store, 1000);
+	assert(store.records.count == 1);
+
+	assert(record_store_push(&store, "/join general", 13));
+	assert(record_store_push(&store, "@alice #general hi", 18));
+	assert(record_store_push(&store, "everyone", 8));
+	assert(!record_store_push(&store, "/unknown", 8));
+	assert(store.len == 3);
+
+	struct record *join = record_at(&store, 0);
+	struct record *message = record_at(&store, 1);
+	struct record *global = record_at(&store, 2);
+
+	assert(join->kind == RECORD_JOIN);
+	assert(join->offset == intern("general", 7));
+
+	// receivers in the side array, in order
+	assert(message->kind == RECORD_MESSAGE);
+	assert(message->receiver_count == 2);
+	assert(store.receiver_len == 2);
+	assert(receiver_at(&store, 0) == RECORD_RECEIVER(intern("alice", 5), 0));
+	assert(receiver_at(&store, 1) ==
+	       RECORD_RECEIVER(intern("general", 7), 1));
+
+	// a 32-bit length, then the content
+	uint32_t len;
+
+	memcpy(&len, record_fields(&store, message->offset), sizeof(len));
+	assert(len == 2);
+	assert(memcmp(record_fields(&store, message->offset) + 4, "hi", 2) == 0);
+
+	assert(global->kind == RECORD_MESSAGE && global->receiver_count == 0);
+
+	record_store_destroy(&store);
+}
+
+static void test_chunks()
+{
+	struct record_store store;
+	struct output_sink out;
+	size_t big_len = 3 * RECORD_CHUNK_BYTES / 2;
+	char *big = malloc(big_len);
+	assert(big);
+
+	memset(big, 'x', big_len);
+	record_store_init(&store);
+	sink_init(&out, SINK_MEMORY, 16);
+
+	assert(record_store_push(&store, "/join general", 13));
+
+	const struct record *first = record_at(&store, 0);
+
+	// records and receivers over several chunks, and a field larger than
+	// a chunk in the middle
+	for (size_t i = 0; i < 3 * RECEIVER_CHUNK_SIZE; i++) {
+		if (i == RECORD_CHUNK_SIZE)
+			assert(record_store_push(&store, big, big_len));
+
+		assert(record_store_push(&store, "@alice #general hi", 18));
+	}
+
+	// the first record has not moved
+	assert(record_at(&store, 0) == first);
+	assert(first->kind == RECORD_JOIN);
+	assert(store.len == 3 * RECEIVER_CHUNK_SIZE + 2);
+	assert(store.receiver_len == 6 * RECEIVER_CHUNK_SIZE);
+
+	const struct record *global = record_at(&store, RECORD_CHUNK_SIZE + 1);
+	const char *field = record_fields(&store, global->offset);
+	uint32_t len;
+
+	memcpy(&len, field, sizeof(len));
+	assert(global->receiver_count == 0 && len == big_len);
+	assert(field[4] == 'x' && field[4 + big_len - 1] == 'x');
+
+	// the field after the large one starts at a chunk of its own
+	const struct record *next = record_at(&store, RECORD_CHUNK_SIZE + 2);
+
+	assert(next->offset % RECORD_CHUNK_BYTES == 0);
+	assert(memcmp(record_fields(&store, next->offset) + 4, "hi", 2) == 0);
+
+	record_store_dispatch(&store, &out);
+
+	const char *expected = "Group message to general: hi\n";
+
+	assert(out.len > strlen(expected));
+	assert(memcmp(out.buf + out.len - strlen(expected), expected,
+		      strlen(expected)) == 0);
+
+	sink_destroy(&out);
+	record_store_destroy(&store);
+	free(big);
+}
+
+/* a global message of len bytes of 'x' */
+static void push_big(struct record_store *s, size_t len)
+{
+	char *big = malloc(len);
+	assert(big);
+
+	memset(big, 'x', len);
+	assert(record_store_push(s, big, len));
+	free(big);
+}
+
+static void test_big_fields_on_chunk_boundaries()
+{
+	struct record_store store;
+	size_t big_len = 100000;
+
+	// first in a fresh store, at offset 0, then right after another one
+	record_store_init(&store);
+	push_big(&store, big_len);
+	push_big(&store, big_len);
+	assert(record_store_push(&store, "@alice hi", 9));
+
+	for (size_t i = 0; i < 2; i++) {
+		const struct record *r = record_at(&store, i);
+		const char *field = record_fields(&store, r->offset);
+		uint32_t len;
+
+		memcpy(&len, field, sizeof(len));
+		assert(r->offset % RECORD_CHUNK_BYTES == 0 && len == big_len);
+		assert(field[4] == 'x' && field[4 + big_len - 1] == 'x');
+	}
+
+	assert(record_at(&store, 0)->offset == 0);
+	assert(record_at(&store, 1)->offset == 2 * RECORD_CHUNK_BYTES);
+	assert(record_at(&store, 2)->offset == 4 * RECORD_CHUNK_BYTES);
+	assert(memcmp(record_fields(&store, record_at(&store, 2)->offset) + 4,
+		      "hi", 2) == 0);
+
+	record_store_destroy(&store);
+}
+
+int main()
+{
+	test_record_size();
+	test_same_output_as_payloads();
+	test_fields();
+	test_chunks();
+	test_big_fields_on_chunk_boundaries();
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
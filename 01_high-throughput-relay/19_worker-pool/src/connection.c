@@ -0,0 +1,365 @@
+#include "channel_registry.h"
+#include "connection.h"
+#include "dynamic_dispatch.h"
+#include "intern.h"
+#include "payload.h"
+#include "session_table.h"
+
+#include "output_sink.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+/* a line handed to the workers, tasks are in arrival order */
+struct line_task {
+	struct pool_task task;        /**< Keyed by the sender's descriptor */
+	const struct payload *payload;
+	struct connection *sender;
+	size_t worker;                /**< Whose scratch sink has the output */
+	size_t start;
+	size_t len;
+};
+
+struct connection *connection_new(int fd)
+{
+	struct connection *c = malloc(sizeof(struct connection));
+	assert(c);
+
+	*c = (struct connection) { .fd = fd };
+
+	return c;
+}
+
+/** @brief Pieces of a delivered line: prefix, name, ": ", content, "\n". */
+#define LINE_PIECES 5
+
+/* returns the length of the whole line */
+static size_t message_line(struct iovec pieces[LINE_PIECES],
+			   const char *prefix, uint32_t name,
+			   const char *content)
+{
+	pieces[0] = (struct iovec) { (char *) prefix, strlen(prefix) };
+	pieces[1] = (struct iovec) {
+		(char *) interned_name(name), interned_len(name)
+	};
+	pieces[2] = (struct iovec) { ": ", 2 };
+	pieces[3] = (struct iovec) { (char *) content, strlen(content) };
+	pieces[4] = (struct iovec) { "\n", 1 };
+
+	return pieces[0].iov_len + pieces[1].iov_len + 2 + pieces[3].iov_len +
+	       1;
+}
+
+/*
+ * The line is sent in pieces straight from the payload and the intern table,
+ * the same pieces to every recipient. A recipient whose socket cannot take a
+ * whole line does not read its messages: it is shut down, and its backend
+ * closes it like any client that leaves.
+ */
+static void send_line(int fd, struct iovec pieces[LINE_PIECES], size_t len)
+{
+	struct msghdr msg = {
+		.msg_iov = pieces,
+		.msg_iovlen = LINE_PIECES,
+	};
+
+	if (sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t) len)
+		shutdown(fd, SHUT_RDWR);
+}
+
+static void deliver_group_message(struct relay_state *r, uint32_t channel,
+				  const char *content)
+{
+	struct iovec pieces[LINE_PIECES];
+	size_t len = message_line(pieces, "Group message to ", channel,
+				  content);
+	size_t count;
+	const uint32_t *members = channel_members(&r->channels, channel, &count);
+
+	for (size_t i = 0; i < count; i++)
+		send_line(members[i], pieces, len);
+}
+
+/* to every connection the user is logged in from */
+static void deliver_direct_message(struct relay_state *r, uint32_t user,
+				   const char *content)
+{
+	struct iovec pieces[LINE_PIECES];
+	size_t len = message_line(pieces, "Direct message to ", user, content);
+
+	for (size_t i = session_find(&r->sessions, user); i != SESSION_NONE;
+	     i = session_find_next(&r->sessions, i))
+		send_line(r->sessions.slots[i].fd, pieces, len);
+}
+
+void connection_logout(struct connection *c, struct session_table *sessions)
+{
+	if (c->is_logged_in)
+		session_logout(sessions, c->user, c->fd);
+
+	c->is_logged_in = false;
+}
+
+/*
+ * Commands and messages also act on the channels and sessions of the server.
+ * Commands change them, under the write lock; messages only read them, and
+ * are delivered in parallel under the read lock.
+ */
+static void route_payload(struct connection *c, struct relay_state *r,
+			  const struct payload *p)
+{
+	if (p->vtable == &command_join_vtable) {
+		pthread_rwlock_wrlock(&r->lock);
+		channel_join(&r->channels, p->data.command_join.channel, c->fd);
+		pthread_rwlock_unlock(&r->lock);
+
+		return;
+	}
+
+	// logging in as someone else logs out first
+	if (p->vtable == &command_login_vtable) {
+		pthread_rwlock_wrlock(&r->lock);
+		connection_logout(c, &r->sessions);
+		session_login(&r->sessions, p->data.command_login.username,
+			      c->fd);
+		pthread_rwlock_unlock(&r->lock);
+
+		c->user = p->data.command_login.username;
+		c->is_logged_in = true;
+
+		return;
+	}
+
+	if (p->vtable == &command_logout_vtable) {
+		pthread_rwlock_wrlock(&r->lock);
+		connection_logout(c, &r->sessions);
+		pthread_rwlock_unlock(&r->lock);
+
+		return;
+	}
+
+	if (p->vtable != &message_vtable)
+		return;
+
+	const struct message_receiving_entity *receivers = \
+		p->data.message.receivers;
+
+	pthread_rwlock_rdlock(&r->lock);
+
+	for (int i = 0; i < p->data.message.receiver_count; i++) {
+		if (receivers[i].vtable == &group_message_vtable)
+			deliver_group_message(r, receivers[i].name,
+					      p->data.message.content);
+		else if (receivers[i].vtable == &direct_message_vtable)
+			deliver_direct_message(r, receivers[i].name,
+					       p->data.message.content);
+	}
+
+	pthread_rwlock_unlock(&r->lock);
+}
+
+/* on a worker: its output goes to the worker's scratch sink, for now */
+static void run_line(struct pool_task *task, size_t worker, void *ctx)
+{
+	struct line_task *l = (struct line_task *) task;
+	struct relay_state *r = ctx;
+	struct output_sink *scratch = &r->scratch[worker];
+
+	l->worker = worker;
+	l->start = scratch->len;
+	l->payload->vtable->process(l->payload, scratch);
+	l->len = scratch->len - l->start;
+
+	route_payload(l->sender, r, l->payload);
+}
+
+void relay_state_init(struct relay_state *r, size_t threads)
+{
+	channel_registry_init(&r->channels);
+	session_table_init(&r->sessions, 0);
+	pthread_rwlock_init(&r->lock, NULL);
+
+	r->scratch = malloc(sizeof(struct output_sink) * (threads + 1));
+	assert(r->scratch);
+
+	for (size_t i = 0; i <= threads; i++)
+		sink_init(&r->scratch[i], SINK_MEMORY, OUTPUT_SINK_SIZE);
+
+	r->tasks = malloc(sizeof(struct line_task) * LINE_TARGET_MAX_PENDING);
+	assert(r->tasks);
+	r->task_count = 0;
+
+	worker_pool_init(&r->pool, threads, run_line, r);
+}
+
+void relay_state_destroy(struct relay_state *r)
+{
+	size_t workers = r->pool.worker_count;
+
+	worker_pool_destroy(&r->pool);
+
+	for (size_t i = 0; i < workers; i++)
+		sink_destroy(&r->scratch[i]);
+
+	free(r->scratch);
+	free(r->tasks);
+	pthread_rwlock_destroy(&r->lock);
+	session_table_destroy(&r->sessions);
+	channel_registry_destroy(&r->channels);
+}
+
+void line_target_drain(struct line_target *t)
+{
+	struct relay_state *r = t->relay;
+
+	if (r == NULL || r->task_count == 0)
+		return;
+
+	worker_pool_wait(&r->pool);
+
+	for (size_t i = 0; i < r->task_count; i++) {
+		struct line_task *l = &r->tasks[i];
+
+		sink_write(t->out, r->scratch[l->worker].buf + l->start,
+			   l->len);
+	}
+
+	for (size_t i = 0; i < r->pool.worker_count; i++)
+		r->scratch[i].len = 0;
+
+	r->task_count = 0;
+}
+
+/* hands the payload to the workers, behind the earlier lines of c */
+static void submit_line(struct connection *c, struct line_target *t,
+			const struct payload *p)
+{
+	struct relay_state *r = t->relay;
+	struct line_task *l = &r->tasks[r->task_count++];
+
+	*l = (struct line_task) {
+		.task.key = c->fd,
+		.payload = p,
+		.sender = c,
+	};
+
+	worker_pool_submit(&r->pool, &l->task);
+
+	// the array is full, its output is emitted to make room
+	if (r->task_count == LINE_TARGET_MAX_PENDING)
+		line_target_drain(t);
+}
+
+static void handle_line(struct connection *c, struct line_target *t,
+			const char *line, size_t len)
+{
+	// clients typing into telnet end their lines with \r\n
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+
+	if (len == 0)
+		return;
+
+	// workers may still read them, their output is emitted first
+	if (t->buf->len == LINE_TARGET_BATCH_SIZE) {
+		line_target_drain(t);
+		destroy(t->buf);
+		t->buf = new_buffer();
+	}
+
+	size_t before = t->buf->len;
+
+	push_client_payload(t->buf, line, len);
+
+	if (t->buf->len == before)
+		return;
+
+	t->processed++;
+
+	struct relay_state *r = t->relay;
+
+	// without other workers, the scratch sinks would only add a copy
+	if (r && r->pool.worker_count > 1) {
+		submit_line(c, t, payload_at(t->buf, t->buf->len - 1));
+	} else {
+		process_next(t->buf, t->out);
+
+		if (r)
+			route_payload(c, r, payload_at(t->buf, t->buf->len - 1));
+	}
+}
+
+/* copies the start of an unfinished line, false if it got too long */
+static bool keep_partial(struct connection *c, const char *data, size_t len)
+{
+	if (len == 0)
+		return true;
+
+	if (c->partial_len + len > CONNECTION_MAX_LINE)
+		return false;
+
+	if (c->partial_len + len > c->partial_cap) {
+		size_t cap = c->partial_cap ? c->partial_cap : 256;
+
+		while (cap < c->partial_len + len)
+			cap *= 2;
+
+		assert((c->partial = realloc(c->partial, sizeof(char) * cap)));
+		c->partial_cap = cap;
+	}
+
+	memcpy(c->partial + c->partial_len, data, len);
+	c->partial_len += len;
+
+	return true;
+}
+
+bool connection_feed(struct connection *c, const char *data, size_t len,
+		     struct line_target *t)
+{
+	const char *end = data + len;
+	const char *newline = memchr(data, '\n', len);
+
+	// the end of the line the previous chunk started
+	if (c->partial_len > 0) {
+		if (newline == NULL)
+			return keep_partial(c, data, len);
+
+		if (!keep_partial(c, data, newline - data))
+			return false;
+
+		handle_line(c, t, c->partial, c->partial_len);
+		c->partial_len = 0;
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	// lines in the middle are parsed where they are, without a copy
+	while (newline != NULL) {
+		handle_line(c, t, data, newline - data);
+
+		data = newline + 1;
+		newline = memchr(data, '\n', end - data);
+	}
+
+	return keep_partial(c, data, end - data);
+}
+
+void connection_finish(struct connection *c, struct line_target *t)
+{
+	handle_line(c, t, c->partial, c->partial_len);
+	c->partial_len = 0;
+}
+
+void connection_free(struct connection *c)
+{
+	close(c->fd);
+	free(c->partial);
+	free(c->backlog);
+	free(c);
+}
@@ -0,0 +1,45 @@
+/**
+ * @file parallel_parser.h
+ * @brief Parses a mapped payload file on several threads.
+ *
+ * The input is split into chunks that end at line boundaries. Every worker
+ * parses its chunk into a private payload buffer, then the buffers are
+ * appended to the result in input order.
+ */
+
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+
+#include "dynamic_dispatch.h"
+
+#include <stddef.h>
+
+
+/** @brief Smaller chunks are not worth a thread, 1 MiB. */
+#define PARALLEL_MIN_CHUNK_SIZE (1 << 20)
+
+/**
+ * @brief Number of workers to use for an input of the given size.
+ *
+ * One per online CPU, but no more than one per PARALLEL_MIN_CHUNK_SIZE bytes
+ * of input, and at least one.
+ */
+size_t parallel_worker_count(size_t size);
+
+/**
+ * @brief Parses every line of data and adds the payloads to the buffer.
+ *
+ * Payloads end up in the same order as the lines of data, as if they were
+ * pushed one by one with push_payload(). Empty lines are skipped.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param data Input, e.g. a mapped file, may be NULL if size is 0
+ * @param size Size of data in bytes
+ * @param workers Number of threads to parse with, at least 1
+ */
+void push_payloads_parallel(struct payload_buffer *buf, const char *data,
+			    size_t size, size_t workers);
+
+
+#endif
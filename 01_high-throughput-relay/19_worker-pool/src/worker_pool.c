@@ -0,0 +1,272 @@
+// A key's queue is in at most one place at a time: idle, in the ready list
+// of one worker, or taken by the worker running it. It stays scheduled while
+// it runs, so tasks submitted meanwhile wait in it instead of being handed
+// to a second worker. That is the whole ordering guarantee.
+//
+// A worker takes every task of a queue at once, and runs them without the
+// lock. The lock is taken twice per queue, not per task.
+//
+// Owners take queues from the front of their list, thieves from the back:
+// the queue that waited longest stays with its owner.
+
+#include "worker_pool.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+struct key_queue {
+	struct pool_task *head;
+	struct pool_task *tail;
+	bool is_scheduled;  /**< In a ready list, or running */
+};
+
+struct worker_arg {
+	struct worker_pool *pool;
+	size_t worker;
+};
+
+size_t worker_pool_default_threads(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return cpus > 1 ? (size_t) cpus - 1 : 0;
+}
+
+static void push_ready(struct ready_list *list, struct key_queue *q)
+{
+	if (list->len == list->cap) {
+		size_t cap = list->cap ? list->cap * 2 : 16;
+		struct key_queue **queues = malloc(sizeof(*queues) * cap);
+		assert(queues);
+
+		// unwrapped into the new ring
+		for (size_t i = 0; i < list->len; i++)
+			queues[i] = list->queues[(list->head + i) % list->cap];
+
+		free(list->queues);
+		list->queues = queues;
+		list->head = 0;
+		list->cap = cap;
+	}
+
+	list->queues[(list->head + list->len) % list->cap] = q;
+	list->len++;
+}
+
+static struct key_queue *pop_front(struct ready_list *list)
+{
+	if (list->len == 0)
+		return NULL;
+
+	struct key_queue *q = list->queues[list->head];
+
+	list->head = (list->head + 1) % list->cap;
+	list->len--;
+
+	return q;
+}
+
+static struct key_queue *pop_back(struct ready_list *list)
+{
+	if (list->len == 0)
+		return NULL;
+
+	list->len--;
+
+	return list->queues[(list->head + list->len) % list->cap];
+}
+
+/* the next queue for a worker, its own or stolen, with the lock held */
+static struct key_queue *take_queue(struct worker_pool *pool, size_t worker)
+{
+	struct key_queue *q = pop_front(&pool->ready[worker]);
+
+	for (size_t i = 1; q == NULL && i < pool->worker_count; i++)
+		q = pop_back(&pool->ready[(worker + i) % pool->worker_count]);
+
+	return q;
+}
+
+/* runs every task of q, with the lock held on entry and on return */
+static void run_queue(struct worker_pool *pool, struct key_queue *q,
+		      size_t worker)
+{
+	struct pool_task *task = q->head;
+	size_t count = 0;
+
+	q->head = q->tail = NULL;
+	pthread_mutex_unlock(&pool->lock);
+
+	while (task) {
+		// run may reuse the task, read next first
+		struct pool_task *next = task->next;
+
+		pool->run(task, worker, pool->ctx);
+		task = next;
+		count++;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+
+	// tasks submitted meanwhile keep the queue scheduled, on this worker
+	if (q->head)
+		push_ready(&pool->ready[worker], q);
+	else
+		q->is_scheduled = false;
+
+	pool->pending -= count;
+
+	if (pool->pending == 0)
+		pthread_cond_broadcast(&pool->is_done);
+}
+
+static void *work(void *arg)
+{
+	struct worker_arg *w = arg;
+	struct worker_pool *pool = w->pool;
+	size_t worker = w->worker;
+
+	free(w);
+	pthread_mutex_lock(&pool->lock);
+
+	while (!pool->is_stopping) {
+		struct key_queue *q = take_queue(pool, worker);
+
+		if (q)
+			run_queue(pool, q, worker);
+		else
+			pthread_cond_wait(&pool->has_work, &pool->lock);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+void worker_pool_init(struct worker_pool *pool, size_t threads, pool_run run,
+		      void *ctx)
+{
+	*pool = (struct worker_pool) {
+		.worker_count = threads + 1,
+		.run = run,
+		.ctx = ctx,
+	};
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->has_work, NULL);
+	pthread_cond_init(&pool->is_done, NULL);
+
+	pool->ready = calloc(pool->worker_count, sizeof(struct ready_list));
+	pool->threads = malloc(sizeof(pthread_t) * (threads ? threads : 1));
+	assert(pool->ready && pool->threads);
+
+	for (size_t i = 0; i < threads; i++) {
+		struct worker_arg *w = malloc(sizeof(struct worker_arg));
+		assert(w);
+
+		*w = (struct worker_arg) { .pool = pool, .worker = i + 1 };
+		assert(pthread_create(&pool->threads[i], NULL, work, w) == 0);
+	}
+}
+
+/* the queue of a key, with the lock held; queues never move */
+static struct key_queue *key_queue(struct worker_pool *pool, uint32_t key)
+{
+	if (key >= pool->key_cap) {
+		size_t cap = pool->key_cap ? pool->key_cap : 64;
+
+		while (cap <= key)
+			cap *= 2;
+
+		assert((pool->keys = realloc(pool->keys,
+					     sizeof(*pool->keys) * cap)));
+		memset(pool->keys + pool->key_cap, 0,
+		       sizeof(*pool->keys) * (cap - pool->key_cap));
+		pool->key_cap = cap;
+	}
+
+	if (pool->keys[key] == NULL) {
+		pool->keys[key] = calloc(1, sizeof(struct key_queue));
+		assert(pool->keys[key]);
+	}
+
+	return pool->keys[key];
+}
+
+void worker_pool_submit(struct worker_pool *pool, struct pool_task *task)
+{
+	// nobody to hand it to, and nothing to wait for
+	if (pool->worker_count == 1) {
+		pool->run(task, 0, pool->ctx);
+
+		return;
+	}
+
+	task->next = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+
+	struct key_queue *q = key_queue(pool, task->key);
+
+	if (q->tail)
+		q->tail->next = task;
+	else
+		q->head = task;
+
+	q->tail = task;
+	pool->pending++;
+
+	if (!q->is_scheduled) {
+		q->is_scheduled = true;
+		push_ready(&pool->ready[task->key % pool->worker_count], q);
+		pthread_cond_signal(&pool->has_work);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_wait(struct worker_pool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->pending > 0) {
+		struct key_queue *q = take_queue(pool, 0);
+
+		// the rest is running on other workers
+		if (q)
+			run_queue(pool, q, 0);
+		else
+			pthread_cond_wait(&pool->is_done, &pool->lock);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_destroy(struct worker_pool *pool)
+{
+	worker_pool_wait(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->is_stopping = true;
+	pthread_cond_broadcast(&pool->has_work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (size_t i = 0; i + 1 < pool->worker_count; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	for (size_t i = 0; i < pool->key_cap; i++)
+		free(pool->keys[i]);
+
+	for (size_t i = 0; i < pool->worker_count; i++)
+		free(pool->ready[i].queues);
+
+	free(pool->keys);
+	free(pool->ready);
+	free(pool->threads);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->has_work);
+	pthread_cond_destroy(&pool->is_done);
+}
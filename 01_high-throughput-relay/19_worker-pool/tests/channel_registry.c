@@ -0,0 +1,89 @@
+#include "../src/channel_registry.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+
+#define SESSIONS 1000
+
+static bool is_member(const struct channel_registry *r, uint32_t channel,
+		      uint32_t session)
+{
+	size_t count;
+	const uint32_t *members = channel_members(r, channel, &count);
+
+	for (size_t i = 0; i < count; i++)
+		if (members[i] == session)
+			return true;
+
+	return false;
+}
+
+static void test_join_and_leave()
+{
+	struct channel_registry r;
+	size_t count;
+
+	channel_registry_init(&r);
+
+	// nobody joined yet, whatever the ID
+	assert(channel_members(&r, 12345, &count) == NULL && count == 0);
+
+	assert(channel_join(&r, 7, 3));
+	assert(!channel_join(&r, 7, 3));
+	assert(channel_join(&r, 7, 4));
+	assert(channel_join(&r, 8, 3));
+
+	channel_members(&r, 7, &count);
+	assert(count == 2 && is_member(&r, 7, 3) && is_member(&r, 7, 4));
+
+	assert(channel_leave(&r, 7, 3));
+	assert(!channel_leave(&r, 7, 3));
+	assert(!channel_leave(&r, 9, 100));
+	assert(!is_member(&r, 7, 3) && is_member(&r, 7, 4));
+	assert(is_member(&r, 8, 3));
+
+	// and joins again
+	assert(channel_join(&r, 7, 3));
+
+	channel_registry_destroy(&r);
+}
+
+static void test_leave_all()
+{
+	struct channel_registry r;
+	size_t count;
+
+	channel_registry_init(&r);
+
+	for (uint32_t session = 0; session < SESSIONS; session++) {
+		assert(channel_join(&r, 0, session));
+		assert(channel_join(&r, 1 + session % 10, session));
+	}
+
+	channel_members(&r, 0, &count);
+	assert(count == SESSIONS);
+
+	channel_leave_all(&r, 42);
+	channel_leave_all(&r, 42);
+	channel_leave_all(&r, 5 * SESSIONS);
+
+	channel_members(&r, 0, &count);
+	assert(count == SESSIONS - 1 && !is_member(&r, 0, 42));
+	channel_members(&r, 3, &count);
+	assert(count == SESSIONS / 10 - 1 && !is_member(&r, 3, 42));
+
+	// the ID can be given to a new session
+	assert(channel_join(&r, 5, 42));
+	assert(is_member(&r, 5, 42) && !is_member(&r, 0, 42));
+
+	channel_registry_destroy(&r);
+}
+
+int main()
+{
+	test_join_and_leave();
+	test_leave_all();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+// Both directions are arrays indexed by ID, with an id_list in each slot.
+// Channel IDs come from the intern table, which also holds usernames, so a
+// few slots belong to names that are not channels; an empty slot costs 16
+// bytes. Session IDs are file descriptors, small and reused.
+//
+// A join scans the channels of the session, not the members of the channel:
+// a channel may have thousands of members, a session joins a few channels.
+
+#include "channel_registry.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ID_LIST_INITIAL_CAP 4
+
+/* grows a slot array so that index is valid, new slots are empty */
+static struct id_list *grow_slots(struct id_list *slots, size_t *cap,
+				  uint32_t index)
+{
+	if (index < *cap)
+		return slots;
+
+	size_t new_cap = *cap ? *cap : 64;
+
+	while (new_cap <= index)
+		new_cap *= 2;
+
+	assert((slots = realloc(slots, sizeof(struct id_list) * new_cap)));
+	memset(slots + *cap, 0, sizeof(struct id_list) * (new_cap - *cap));
+	*cap = new_cap;
+
+	return slots;
+}
+
+static void push_id(struct id_list *list, uint32_t id)
+{
+	if (list->len == list->cap) {
+		list->cap = list->cap ? list->cap * 2 : ID_LIST_INITIAL_CAP;
+		assert((list->ids = realloc(list->ids,
+					    sizeof(uint32_t) * list->cap)));
+	}
+
+	list->ids[list->len++] = id;
+}
+
+/* swaps the last ID into its place, false if id is not in the list */
+static bool remove_id(struct id_list *list, uint32_t id)
+{
+	for (uint32_t i = 0; i < list->len; i++) {
+		if (list->ids[i] == id) {
+			list->ids[i] = list->ids[--list->len];
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void channel_registry_init(struct channel_registry *r)
+{
+	*r = (struct channel_registry) { 0 };
+}
+
+bool channel_join(struct channel_registry *r, uint32_t channel,
+		  uint32_t session)
+{
+	r->sessions = grow_slots(r->sessions, &r->session_cap, session);
+
+	struct id_list *joined = &r->sessions[session];
+
+	for (uint32_t i = 0; i < joined->len; i++)
+		if (joined->ids[i] == channel)
+			return false;
+
+	r->channels = grow_slots(r->channels, &r->channel_cap, channel);
+
+	push_id(joined, channel);
+	push_id(&r->channels[channel], session);
+
+	return true;
+}
+
+bool channel_leave(struct channel_registry *r, uint32_t channel,
+		   uint32_t session)
+{
+	if (session >= r->session_cap ||
+	    !remove_id(&r->sessions[session], channel))
+		return false;
+
+	// members and joined channels always agree
+	assert(remove_id(&r->channels[channel], session));
+
+	return true;
+}
+
+void channel_leave_all(struct channel_registry *r, uint32_t session)
+{
+	if (session >= r->session_cap)
+		return;
+
+	struct id_list *joined = &r->sessions[session];
+
+	for (uint32_t i = 0; i < joined->len; i++)
+		assert(remove_id(&r->channels[joined->ids[i]], session));
+
+	joined->len = 0;
+}
+
+const uint32_t *channel_members(const struct channel_registry *r,
+				uint32_t channel, size_t *count)
+{
+	if (channel >= r->channel_cap) {
+		*count = 0;
+
+		return NULL;
+	}
+
+	*count = r->channels[channel].len;
+
+	return r->channels[channel].ids;
+}
+
+void channel_registry_destroy(struct channel_registry *r)
+{
+	for (size_t i = 0; i < r->channel_cap; i++)
+		free(r->channels[i].ids);
+
+	for (size_t i = 0; i < r->session_cap; i++)
+		free(r->sessions[i].ids);
+
+	free(r->channels);
+	free(r->sessions);
+	*r = (struct channel_registry) { 0 };
+}
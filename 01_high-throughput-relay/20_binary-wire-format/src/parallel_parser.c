@@ -0,0 +1,109 @@
+// Lines are independent of each other, so any line can be parsed by any
+// thread. The only shared state of the sequential parser is the payload
+// buffer: its array and its arena. Instead of locking them, each worker gets
+// a buffer of its own, and nothing is shared until the workers are done.
+//
+// Stitching is cheap: the payload structs are copied once, but the strings
+// they point to stay where they are, in arena chunks that change owner.
+
+#include "dynamic_dispatch.h"
+#include "mapped_file.h"
+#include "parallel_parser.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+struct worker {
+	pthread_t thread;
+	struct mapped_file chunk;       /**< Lines of this worker */
+	struct payload_buffer *result;  /**< Private, until stitched */
+};
+
+size_t parallel_worker_count(size_t size)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t workers = size / PARALLEL_MIN_CHUNK_SIZE;
+
+	if (cpus > 0 && workers > (size_t) cpus)
+		workers = cpus;
+
+	return workers > 0 ? workers : 1;
+}
+
+static void *parse_chunk(void *arg)
+{
+	struct worker *w = arg;
+	struct line_view line;
+
+	while (next_line(&w->chunk, &line))
+		if (line.len > 0)
+			push_payload(w->result, line.ptr, line.len);
+
+	return NULL;
+}
+
+/* end of the chunk starting at start: just past the first newline at or
+ * after target, so that no line is split between two chunks */
+static size_t chunk_end(const char *data, size_t size, size_t start,
+			size_t target)
+{
+	if (target <= start)
+		target = start;
+
+	if (target >= size)
+		return size;
+
+	const char *newline = memchr(data + target, '\n', size - target);
+
+	return newline ? (size_t) (newline - data) + 1 : size;
+}
+
+void push_payloads_parallel(struct payload_buffer *buf, const char *data,
+			    size_t size, size_t workers)
+{
+	assert(workers > 0);
+
+	if (size == 0)
+		return;
+
+	struct worker *pool = malloc(sizeof(struct worker) * workers);
+	assert(pool);
+
+	size_t start = 0;
+
+	for (size_t i = 0; i < workers; i++) {
+		size_t target = size / workers * (i + 1);
+		size_t end = i + 1 == workers ?
+			size : chunk_end(data, size, start, target);
+
+		pool[i].chunk = (struct mapped_file) {
+			.data = data + start,
+			.size = end - start,
+			.cursor = 0,
+		};
+		pool[i].result = new_buffer();
+
+		start = end;
+	}
+
+	// the calling thread parses the first chunk itself
+	for (size_t i = 1; i < workers; i++)
+		pthread_create(&pool[i].thread, NULL, parse_chunk, &pool[i]);
+
+	parse_chunk(&pool[0]);
+
+	// in input order, a worker's payloads can be appended as soon as it
+	// and every worker before it are done
+	for (size_t i = 0; i < workers; i++) {
+		if (i > 0)
+			pthread_join(pool[i].thread, NULL);
+
+		append_buffer(buf, pool[i].result);
+	}
+
+	free(pool);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file tcp_backend.h
+ * @brief Methods every backend of the TCP server implements.
+ *
+ * Internal to the server: tcp_server.c owns the listening socket and the
+ * list of connections, a backend decides how to wait for them.
+ */
+
+#ifndef TCP_BACKEND_H
+#define TCP_BACKEND_H
+
+
+#include "connection.h"
+#include "tcp_server.h"
+
+#include <stdbool.h>
+
+
+struct tcp_backend {
+	const char *name;
+
+	/**
+	 * @brief Sets up s->state, the listening socket is already open.
+	 *
+	 * @return false if the kernel does not support the backend, nothing
+	 *         is left to clean up then
+	 */
+	bool (*open)(struct tcp_server *s);
+
+	/**
+	 * @brief Waits for events once, feeds received bytes to t.
+	 *
+	 * Drains t with line_target_drain(), then flushes t->out, or queues
+	 * its output to be written, before returning.
+	 */
+	void (*poll)(struct tcp_server *s, struct line_target *t,
+		     int timeout_ms);
+
+	/**
+	 * @brief Frees s->state, after every connection was removed.
+	 */
+	void (*close)(struct tcp_server *s);
+};
+
+/** @brief Adds an accepted connection to the list of the server. */
+void tcp_server_add(struct tcp_server *s, struct connection *c);
+
+/** @brief Removes a connection from the list, and frees it. */
+void tcp_server_remove(struct tcp_server *s, struct connection *c);
+
+/**
+ * @brief Queues a connection for a turn in the next round.
+ *
+ * A connection is queued once, however many times it is marked before its
+ * turn.
+ */
+void tcp_server_mark_ready(struct tcp_server *s, struct connection *c);
+
+/**
+ * @brief Takes the ready list, linked by ready_next, in the order
+ *        connections were marked.
+ *
+ * Connections stay is_ready until the backend takes their turn, so marking
+ * them again meanwhile does not queue them twice.
+ */
+struct connection *tcp_server_take_ready(struct tcp_server *s);
+
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file wire_format.h
+ * @brief Length-prefixed binary encoding of payloads.
+ *
+ * A frame is a kind byte, the length of its body as a varint, then the body.
+ * Strings are a varint length followed by their bytes, with no terminator:
+ *
+ *     login    username, password
+ *     join     channel
+ *     logout   (empty body)
+ *     message  receiver count, receivers, then the content up to the end
+ *
+ * A receiver is a varint, the length of its name shifted left by one with
+ * the low bit set for a channel, followed by the name. A message without
+ * receivers is a global message.
+ *
+ * Varints are little-endian base 128: 7 bits per byte, the high bit set on
+ * every byte but the last. Kind bytes are control characters that never
+ * start a text line, so one stream may carry both lines and frames.
+ */
+
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Longest varint of a 32-bit value. */
+#define WIRE_VARINT_MAX 5
+
+/** @brief Longest frame header: the kind byte and the body length. */
+#define WIRE_HEADER_MAX (1 + WIRE_VARINT_MAX)
+
+/** @brief Returned by wire_frame_len() for a malformed header. */
+#define WIRE_FRAME_INVALID SIZE_MAX
+
+enum wire_kind {
+	WIRE_LOGIN = 1,
+	WIRE_JOIN,
+	WIRE_LOGOUT,
+	WIRE_MESSAGE,
+	WIRE_KIND_END,
+};
+
+struct arena;
+struct output_sink;
+struct payload;
+
+/**
+ * @brief Returns true if a frame, rather than a text line, starts with c.
+ */
+static inline bool is_wire_frame(char c)
+{
+	return (unsigned char) c - WIRE_LOGIN < WIRE_KIND_END - WIRE_LOGIN;
+}
+
+/**
+ * @brief Length of the frame at the start of data, header included.
+ *
+ * @param data Bytes received, data[0] is a kind byte
+ * @param len Length of data, the frame may end beyond it
+ * @return 0 if data ends inside the header, WIRE_FRAME_INVALID if the header
+ *         is malformed
+ */
+size_t wire_frame_len(const char *data, size_t len);
+
+/**
+ * @brief Returns true if str could be a name or a password of a line: no
+ *        spaces, no control bytes.
+ *
+ * Both parsers check names with it, a frame must not fill a payload that no
+ * line could.
+ */
+bool is_valid_token(const char *str, size_t len);
+
+/**
+ * @brief Appends the frame of a payload to out.
+ *
+ * @return false if the payload has no frame kind, nothing is appended then
+ */
+bool encode_payload(const struct payload *p, struct output_sink *out);
+
+/**
+ * @brief Constructs a payload from a frame, like parse_payload() does from a
+ *        line.
+ *
+ * Every field is checked against the frame's bounds, frames come from the
+ * network, and content may not hold a newline or a NUL. Names are interned,
+ * the password and the content are copied, and the receivers are allocated
+ * at once: their count is known up front.
+ *
+ * @param p Output for the decoded payload
+ * @param raw Whole frame, header included
+ * @param len Length of the frame, as returned by wire_frame_len()
+ * @param arena Arena to allocate fields from, or NULL for the heap
+ * @return false if the frame is malformed
+ */
+bool parse_payload_binary(struct payload *p, const char *raw, size_t len,
+			  struct arena *arena);
+
+/**
+ * @brief Same as parse_payload_binary(), for frames of clients: receivers
+ *        are only looked up, see parse_client_payload().
+ */
+bool parse_client_payload_binary(struct payload *p, const char *raw,
+				 size_t len, struct arena *arena);
+
+
+#endif
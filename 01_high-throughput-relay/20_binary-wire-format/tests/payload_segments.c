@@ -0,0 +1,139 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/intern.h"
+#include "../src/output_sink.h"
+#include "../src/payload.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* the i-th line of a test buffer, the channel tells lines apart */
+static void push_numbered(struct payload_buffer *buf, size_t i)
+{
+	char line[32];
+
+	push_payload(buf, line, sprintf(line, "/join channel%zu", i));
+}
+
+static int channel_number(struct payload *p)
+{
+	return atoi(interned_name(p->data.command_join.channel) +
+		    strlen("channel"));
+}
+
+static void test_pointers_are_stable()
+{
+	struct payload_buffer *buf = new_buffer();
+
+	for (int i = 0; i < 5000; i++)
+		push_numbered(buf, i);
+
+	struct payload *first = payload_at(buf, 0);
+	struct payload *middle = payload_at(buf, 4500);
+
+	for (size_t i = 5000; i < 3 * PAYLOAD_SEGMENT_SIZE; i++)
+		push_numbered(buf, i);
+
+	// every segment is full, and nothing has moved
+	assert(buf->segment_count == 3);
+	assert(payload_at(buf, 0) == first && channel_number(first) == 0);
+	assert(payload_at(buf, 4500) == middle &&
+	       channel_number(middle) == 4500);
+
+	// invalid lines take no room
+	push_payload(buf, "/unknown", 8);
+	assert(buf->len == 3 * PAYLOAD_SEGMENT_SIZE);
+
+	destroy(buf);
+}
+
+static void test_reserve()
+{
+	struct payload_buffer *buf = new_buffer();
+
+	reserve_payloads(buf, 2 * PAYLOAD_SEGMENT_SIZE + 1);
+	assert(buf->segment_count == 0 && buf->spare_count == 3);
+
+	size_t cap = buf->segment_cap;
+
+	for (size_t i = 0; i < 2 * PAYLOAD_SEGMENT_SIZE + 1; i++)
+		push_numbered(buf, i);
+
+	// reserved segments were used, none was added
+	assert(buf->segment_count == 3 && buf->spare_count == 0);
+	assert(buf->segment_cap == cap);
+
+	// the last segment still has room
+	reserve_payloads(buf, 100);
+	assert(buf->spare_count == 0);
+
+	destroy(buf);
+}
+
+static void test_append_partial_segments()
+{
+	struct payload_buffer *buf = new_buffer();
+	int sizes[] = { 5000, 0, 3000, 1, PAYLOAD_SEGMENT_SIZE };
+	int next = 0;
+
+	// spares of buf must survive appending
+	reserve_payloads(buf, 3 * PAYLOAD_SEGMENT_SIZE);
+
+	for (size_t k = 0; k < sizeof(sizes) / sizeof(*sizes); k++) {
+		struct payload_buffer *other = new_buffer();
+
+		for (int i = 0; i < sizes[k]; i++)
+			push_numbered(other, next++);
+
+		append_buffer(buf, other);
+	}
+
+	for (int i = 0; i < 100; i++)
+		push_numbered(buf, next++);
+
+	assert(buf->len == (size_t) next);
+
+	for (int i = 0; i < next; i++)
+		assert(channel_number(payload_at(buf, i)) == i);
+
+	// windows stop at the end of each partial segment
+	struct batch_output batch;
+	struct output_sink expected;
+	size_t processed = 0;
+
+	batch_output_init(&batch);
+	sink_init(&expected, SINK_MEMORY, 16);
+
+	while (process_batch(buf, &batch) > 0) {
+		sink_literal(&expected, "Command: join\n  Arguments: [channel: ");
+		sink_string(&expected,
+			    interned_name(payload_at(buf, processed)
+					  ->data.command_join.channel));
+		sink_literal(&expected, "]\n");
+
+		assert(memcmp(batch.scratch.buf, expected.buf,
+			      batch.len[0]) == 0);
+
+		processed += batch.count;
+		expected.len = 0;
+	}
+
+	assert(processed == buf->len);
+
+	sink_destroy(&expected);
+	batch_output_destroy(&batch);
+	destroy(buf);
+}
+
+int main()
+{
+	test_pointers_are_stable();
+	test_reserve();
+	test_append_partial_segments();
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file connection.h
+ * @brief A client of the TCP server, and the framing of its stream.
+ *
+ * Every backend of the server receives bytes its own way, and feeds them to
+ * the connection they came from. The connection cuts them into lines, and
+ * parses and processes every complete one at once. Only the unfinished line
+ * at the end of a chunk is copied, to wait for the rest of it.
+ *
+ * Binary clients send frames instead, see wire_format.h. A frame's first
+ * byte never starts a line, so each line or frame says what it is, and one
+ * connection may even mix them. Frames are cut by their length, newlines
+ * inside them mean nothing.
+ *
+ * A connection is also a session of the channel registry, known by its file
+ * descriptor: what it joins, it leaves when it is closed. Group messages are
+ * delivered to the sockets of every member of their channels.
+ *
+ * Logging in adds the connection to the session table, under the username:
+ * direct messages are delivered to every connection of the user.
+ *
+ * Processing and delivering happen on the workers of the server, keyed by
+ * connection: lines of one connection are handled in the order they were
+ * sent, lines of different connections in parallel. Their output still
+ * reaches the output sink in the order the lines were received.
+ */
+
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+
+#include "channel_registry.h"
+#include "session_table.h"
+#include "worker_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Longest line or frame a client may send, longer ones drop it. */
+#define CONNECTION_MAX_LINE (64 << 10)
+
+/**
+ * @brief Bytes a connection takes per round, before the others get their
+ *        turn, see tcp_server_poll().
+ */
+#define CONNECTION_READ_BUDGET (64 << 10)
+
+/**
+ * @brief Payloads of a round released together.
+ *
+ * A round lasts as long as clients keep sending, its payloads are released
+ * by batch once they are processed.
+ */
+#define LINE_TARGET_BATCH_SIZE 4096
+
+/**
+ * @brief Lines handed to the workers before the framing waits for them.
+ *
+ * A round lasts as long as clients keep sending. Waiting now and then
+ * bounds the memory and the delay of the output.
+ */
+#define LINE_TARGET_MAX_PENDING 4096
+
+struct line_task;
+struct output_sink;
+struct payload_buffer;
+struct payload_log;
+
+/**
+ * @brief What lines act on, shared by every connection of a server.
+ */
+struct relay_state {
+	struct channel_registry channels;
+	struct session_table sessions;
+	pthread_rwlock_t lock;        /**< Of channels and sessions */
+	struct worker_pool pool;      /**< Keyed by file descriptor */
+	struct output_sink *scratch;  /**< Output of each worker, in memory */
+	struct line_task *tasks;      /**< LINE_TARGET_MAX_PENDING, reused */
+	size_t task_count;            /**< Handed to workers, not drained */
+};
+
+/**
+ * @brief Where complete lines go.
+ */
+struct line_target {
+	struct payload_buffer *buf;  /**< Parsed payloads, of the current round */
+	struct output_sink *out;     /**< Output of processed payloads */
+	struct relay_state *relay;   /**< Of the server, NULL to only process */
+	struct payload_log *log;     /**< Appended to, NULL to keep nothing */
+	size_t processed;            /**< Payloads processed so far */
+};
+
+struct connection {
+	int fd;
+	char *partial;       /**< Unfinished line, NULL until one is needed */
+	size_t partial_len;
+	size_t partial_cap;
+	bool is_dropped;     /**< Sent a line that is too long */
+
+	// taking turns, see tcp_server_poll()
+	bool is_ready;       /**< On the ready list, its turn is coming */
+	struct connection *ready_next;
+	unsigned round;      /**< Round turn_bytes were taken in */
+	size_t turn_bytes;   /**< Taken in that round */
+
+	// io_uring only, see uring_backend.c
+	char *backlog;       /**< Received beyond the budget, not fed yet */
+	size_t backlog_begin;  /**< Fed part, backlog[backlog_begin, len) */
+	size_t backlog_len;
+	size_t backlog_cap;
+	bool is_receiving;   /**< A receive is armed */
+	bool is_paused;      /**< Its receive is cancelled until its turn */
+	bool is_finished;    /**< The stream ended, the backlog did not */
+
+	bool is_logged_in;
+	uint32_t user;       /**< Interned username, if logged in */
+	struct connection *prev;
+	struct connection *next;
+};
+
+/**
+ * @brief Starts the workers, see worker_pool_init().
+ *
+ * The relay must not move afterwards, its workers refer to it.
+ */
+void relay_state_init(struct relay_state *r, size_t threads);
+
+/**
+ * @brief Waits for the workers, and frees everything.
+ */
+void relay_state_destroy(struct relay_state *r);
+
+/**
+ * @brief Waits until every line handed to the workers is handled, and
+ *        appends their output to t->out in the order lines were received.
+ *
+ * Backends call it at the end of a round, before t->out is flushed.
+ */
+void line_target_drain(struct line_target *t);
+
+/**
+ * @brief Allocates a connection for an accepted socket, now owned by it.
+ */
+struct connection *connection_new(int fd);
+
+/**
+ * @brief Handles every complete line of data, keeps the unfinished end.
+ *
+ * @param c Connection data was received from
+ * @param data Bytes received, in stream order
+ * @param len Length of data
+ * @param t Where to parse and process lines
+ * @return false if the pending line or frame is longer than
+ *         CONNECTION_MAX_LINE, or a frame's header is malformed: the
+ *         connection must be dropped then
+ */
+bool connection_feed(struct connection *c, const char *data, size_t len,
+		     struct line_target *t);
+
+/**
+ * @brief Handles the last line of a stream, the one without a newline.
+ *
+ * A frame cut short by the end of the stream is dropped.
+ */
+void connection_finish(struct connection *c, struct line_target *t);
+
+/**
+ * @brief Removes the session of the connection, if it is logged in.
+ */
+void connection_logout(struct connection *c, struct session_table *sessions);
+
+/**
+ * @brief Closes the socket and frees the connection.
+ */
+void connection_free(struct connection *c);
+
+
+#endif
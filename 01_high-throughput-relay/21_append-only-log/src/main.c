@@ -0,0 +1,298 @@
+#include "dynamic_dispatch.h"
+#include "intern.h"
+#include "line_reader.h"
+#include "mapped_file.h"
+#include "output_sink.h"
+#include "parallel_parser.h"
+#include "payload_log.h"
+#include "tcp_client.h"
+#include "tcp_server.h"
+#include "wire_format.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* regular files are mapped as a whole, and parsed on every core */
+static void read_mapped(struct payload_buffer *buf, struct mapped_file *file)
+{
+	push_payloads_parallel(buf, file->data, file->size,
+			       parallel_worker_count(file->size));
+
+	unmap_file(file);
+}
+
+/* pipes, stdin and other streams are read chunk by chunk */
+static void read_stream(struct payload_buffer *buf, int fd)
+{
+	struct line_reader reader;
+	struct line_view line;
+
+	line_reader_init(&reader, fd, LINE_READER_CHUNK_SIZE);
+
+	while (read_line(&reader, &line))
+		if (line.len > 0)
+			push_payload(buf, line.ptr, line.len);
+
+	line_reader_destroy(&reader);
+}
+
+/* opens path for reading, "-" is stdin */
+static int open_input(const char *path)
+{
+	if (strcmp(path, "-") == 0)
+		return STDIN_FILENO;
+
+	int fd = open(path, O_RDONLY);
+
+	if (fd == -1)
+		fprintf(stderr, "Could not open %s.\n", path);
+
+	return fd;
+}
+
+/* a regular file is mapped, anything else is read as a stream */
+static bool read_payloads(struct payload_buffer *buf, const char *path)
+{
+	struct mapped_file file;
+
+	if (strcmp(path, "-") != 0 && map_file(&file, path)) {
+		read_mapped(buf, &file);
+
+		return true;
+	}
+
+	int fd = open_input(path);
+
+	if (fd == -1)
+		return false;
+
+	read_stream(buf, fd);
+
+	if (fd != STDIN_FILENO)
+		close(fd);
+
+	return true;
+}
+
+static bool parse_port(const char *str, uint16_t *port)
+{
+	char *end;
+	unsigned long value = strtoul(str, &end, 10);
+
+	if (*str == '\0' || *end != '\0' || value > UINT16_MAX)
+		return false;
+
+	*port = value;
+
+	return true;
+}
+
+/* processes payloads of every client as they arrive, until killed */
+static int serve(uint16_t port, const struct tcp_backend *backend,
+		 const char *log_dir)
+{
+	struct tcp_server server;
+	struct payload_log log;
+	size_t threads = worker_pool_default_threads();
+
+	if (log_dir &&
+	    !payload_log_open(&log, log_dir, PAYLOAD_LOG_SEGMENT_SIZE)) {
+		perror("Could not open the log");
+
+		return EXIT_FAILURE;
+	}
+
+	if (!tcp_server_open(&server, port, backend, threads)) {
+		perror("Could not listen");
+
+		if (log_dir)
+			payload_log_close(&log);
+
+		return EXIT_FAILURE;
+	}
+
+	printf("--- Listening on port %u, with %s and %zu workers ---\n",
+	       tcp_server_port(&server), tcp_server_backend_name(&server),
+	       threads + 1);
+
+	if (log_dir) {
+		server.log = &log;
+		printf("--- Logging payloads to %s ---\n", log_dir);
+	}
+
+	fflush(stdout);
+
+	struct output_sink out;
+	sink_init(&out, STDOUT_FILENO, OUTPUT_SINK_SIZE);
+
+	while (true)
+		tcp_server_poll(&server, &out, -1);
+}
+
+/* the bundled client: sends a payloads file to a server on loopback */
+static int send_payloads(uint16_t port, const char *path)
+{
+	int in_fd = open_input(path);
+
+	if (in_fd == -1)
+		return EXIT_FAILURE;
+
+	int fd = tcp_connect("127.0.0.1", port);
+
+	if (fd == -1) {
+		perror("Could not connect");
+
+		return EXIT_FAILURE;
+	}
+
+	bool is_sent = send_stream(fd, in_fd);
+
+	close(fd);
+	if (in_fd != STDIN_FILENO)
+		close(in_fd);
+
+	return is_sent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* the bundled client, in frames: lines are parsed here, not on the server */
+static int send_payloads_binary(uint16_t port, const char *path)
+{
+	struct payload_buffer *buf = new_buffer();
+
+	if (!read_payloads(buf, path)) {
+		destroy(buf);
+
+		return EXIT_FAILURE;
+	}
+
+	struct output_sink frames;
+	sink_init(&frames, SINK_MEMORY, OUTPUT_SINK_SIZE);
+
+	for (size_t i = 0; i < buf->len; i++)
+		encode_payload(payload_at(buf, i), &frames);
+
+	destroy(buf);
+
+	int fd = tcp_connect("127.0.0.1", port);
+	bool is_sent = fd != -1 && send_all(fd, frames.buf, frames.len);
+
+	if (fd == -1)
+		perror("Could not connect");
+	else
+		close(fd);
+
+	sink_destroy(&frames);
+	intern_reset();
+
+	return is_sent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s <payloads file | ->\n"
+			"       %s --replay <log directory>\n"
+			"       %s --serve <port> [--backend io_uring|epoll] "
+			"[--log <directory>]\n"
+			"       %s --send <port> <payloads file | ->\n"
+			"       %s --send-binary <port> <payloads file | ->\n",
+		name, name, name, name, name);
+}
+
+int main(int argc, const char **args)
+{
+	uint16_t port;
+
+	if (argc >= 3 && strcmp(args[1], "--serve") == 0 &&
+	    parse_port(args[2], &port)) {
+		// io_uring by default, epoll if the kernel lacks it
+		const struct tcp_backend *backend = &uring_backend;
+		const char *log_dir = NULL;
+		int i = 3;
+
+		for (; i + 1 < argc; i += 2) {
+			if (strcmp(args[i], "--backend") == 0 &&
+			    strcmp(args[i + 1], "io_uring") == 0)
+				backend = &uring_backend;
+			else if (strcmp(args[i], "--backend") == 0 &&
+				 strcmp(args[i + 1], "epoll") == 0)
+				backend = &epoll_backend;
+			else if (strcmp(args[i], "--log") == 0)
+				log_dir = args[i + 1];
+			else
+				break;
+		}
+
+		if (i == argc)
+			return serve(port, backend, log_dir);
+	}
+
+	if (argc == 4 && strcmp(args[1], "--send") == 0 &&
+	    parse_port(args[2], &port))
+		return send_payloads(port, args[3]);
+
+	if (argc == 4 && strcmp(args[1], "--send-binary") == 0 &&
+	    parse_port(args[2], &port))
+		return send_payloads_binary(port, args[3]);
+
+	bool is_replay = argc == 3 && strcmp(args[1], "--replay") == 0;
+
+	if (!is_replay && (argc != 2 || strncmp(args[1], "--", 2) == 0)) {
+		usage(args[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	struct payload_buffer *buf = new_buffer();
+
+	printf("--- Reading payloads ---\n");
+	if (is_replay) {
+		size_t segments = payload_log_replay(buf, args[2]);
+
+		printf("Replayed %zu segments\n", segments);
+	} else if (!read_payloads(buf, args[1])) {
+		destroy(buf);
+
+		return EXIT_FAILURE;
+	}
+	printf("Read %zu payloads\n\n", buf->len);
+
+	// stdout has its own buffer, empty it before writing around it
+	fflush(stdout);
+
+	struct output_sink out;
+	sink_init(&out, STDOUT_FILENO, OUTPUT_SINK_SIZE);
+
+	struct batch_output batch;
+	batch_output_init(&batch);
+
+	sink_literal(&out, "--- Processing payloads ---\n");
+	while (buf->process_base < buf->len) {
+		size_t base = buf->process_base;
+
+		// grouped by type, emitted in arrival order
+		process_batch(buf, &batch);
+
+		for (size_t i = 0; i < batch.count; i++) {
+			sink_printf(&out, "Processing payload %zu of %zu\n",
+				    base + i + 1, buf->len);
+			sink_write(&out, batch.scratch.buf + batch.start[i],
+				   batch.len[i]);
+			sink_literal(&out, "\n");
+		}
+	}
+
+	batch_output_destroy(&batch);
+
+	// one write() for the whole batch, unless it outgrew the sink
+	sink_destroy(&out);
+	destroy(buf);
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,496 @@
+// The server's thread never waits for the disk. It appends frames to a
+// buffer of its own, and at the end of a round moves them to the committed
+// buffer, under the lock. The syncer swaps the committed buffer for an empty
+// one, and writes and syncs it without the lock: a round committed
+// meanwhile joins the next group.
+//
+// Segments are allocated at their full size up front. Writing into them then
+// never changes the size of the file, so fdatasync() has no metadata to
+// write, only the data itself.
+//
+// Checksums are CRC-32C, the polynomial that SSE 4.2 computes 8 bytes at a
+// time. They are chosen at startup, like the tokenizer's comparisons.
+
+#define _GNU_SOURCE
+
+#include "dynamic_dispatch.h"
+#include "mapped_file.h"
+#include "parallel_parser.h"
+#include "payload.h"
+#include "payload_log.h"
+#include "wire_format.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+
+/* reflected CRC-32C polynomial */
+#define CRC32C_POLY 0x82f63b78u
+
+static uint32_t crc32c_table[256];
+
+static uint32_t crc32c_scalar(const char *data, size_t len)
+{
+	uint32_t crc = ~0u;
+
+	for (size_t i = 0; i < len; i++)
+		crc = crc32c_table[(crc ^ (unsigned char) data[i]) & 0xff] ^
+		      crc >> 8;
+
+	return ~crc;
+}
+
+#ifdef __x86_64__
+// compiled for SSE 4.2 regardless of -march, only called if the CPU has it
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(const char *data, size_t len)
+{
+	uint64_t crc = ~0u;
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		uint64_t word;
+
+		memcpy(&word, data + i, sizeof(word));
+		crc = _mm_crc32_u64(crc, word);
+	}
+
+	for (; i < len; i++)
+		crc = _mm_crc32_u8(crc, data[i]);
+
+	return ~(uint32_t) crc;
+}
+#endif
+
+/* selected once at startup, before main runs */
+static uint32_t (*crc32c)(const char *data, size_t len) = crc32c_scalar;
+
+__attribute__((constructor))
+static void select_crc32c()
+{
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+
+		for (int bit = 0; bit < 8; bit++)
+			crc = crc & 1 ? crc >> 1 ^ CRC32C_POLY : crc >> 1;
+
+		crc32c_table[i] = crc;
+	}
+
+#ifdef __x86_64__
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse4.2"))
+		crc32c = crc32c_sse42;
+#endif
+}
+
+static void segment_path(char path[PATH_MAX], const char *dir, size_t index)
+{
+	snprintf(path, PATH_MAX, "%s/%08zu.log", dir, index);
+}
+
+/* the file of a new segment, at its full size, -1 on failure */
+static int create_segment(const char *dir, size_t index, size_t size)
+{
+	char path[PATH_MAX];
+
+	segment_path(path, dir, index);
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+	if (fd == -1)
+		return -1;
+
+	// posix_fallocate returns the error instead of setting errno
+	int error = posix_fallocate(fd, 0, size);
+
+	if (error != 0) {
+		close(fd);
+		errno = error;
+
+		return -1;
+	}
+
+	// the new name must survive a crash, too
+	int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (dir_fd != -1) {
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+
+	return fd;
+}
+
+/* moves on to the next segment, syncing the one that is full */
+static bool next_segment(struct payload_log *log)
+{
+	bool is_synced = fdatasync(log->fd) == 0;
+
+	log->sync_count++;
+	close(log->fd);
+
+	log->segment++;
+	log->offset = 0;
+	log->fd = create_segment(log->dir, log->segment, log->segment_size);
+
+	return is_synced && log->fd != -1;
+}
+
+static bool write_batch(struct payload_log *log, const char *frames,
+			size_t len)
+{
+	struct log_batch batch = {
+		.len = len,
+		.checksum = crc32c(frames, len),
+	};
+	struct iovec pieces[] = {
+		{ &batch, sizeof(batch) },
+		{ (char *) frames, len },
+	};
+
+	// a regular file takes the whole write, unless the disk fails
+	if (pwritev(log->fd, pieces, 2, log->offset) !=
+	    (ssize_t) (sizeof(batch) + len))
+		return false;
+
+	log->offset += sizeof(batch) + len;
+
+	return true;
+}
+
+/*
+ * Writes a group of frames as batches, as many frames per batch as the
+ * segment has room for, then syncs once.
+ */
+static bool write_group(struct payload_log *log, const char *data,
+			size_t len)
+{
+	const char *end = data + len;
+
+	while (data < end) {
+		size_t room = log->segment_size - log->offset;
+		size_t batch = 0;
+
+		// a frame is never split between two segments
+		while (data + batch < end) {
+			size_t frame = wire_frame_len(data + batch,
+						      end - (data + batch));
+
+			if (sizeof(struct log_batch) + batch + frame > room)
+				break;
+
+			batch += frame;
+		}
+
+		if (batch == 0) {
+			if (!next_segment(log))
+				return false;
+
+			continue;
+		}
+
+		if (!write_batch(log, data, batch))
+			return false;
+
+		data += batch;
+	}
+
+	log->sync_count++;
+
+	return fdatasync(log->fd) == 0;
+}
+
+static void swap_sinks(struct output_sink *a, struct output_sink *b)
+{
+	struct output_sink swapped = *a;
+
+	*a = *b;
+	*b = swapped;
+}
+
+static void *sync_groups(void *arg)
+{
+	struct payload_log *log = arg;
+
+	pthread_mutex_lock(&log->lock);
+
+	while (true) {
+		while (log->committed.len == 0 && !log->is_stopping)
+			pthread_cond_wait(&log->has_work, &log->lock);
+
+		if (log->committed.len == 0)
+			break;
+
+		// everything committed so far is one group
+		uint64_t group_end = log->commit_count;
+
+		swap_sinks(&log->committed, &log->writing);
+		pthread_mutex_unlock(&log->lock);
+
+		bool is_written = !log->is_failed &&
+			write_group(log, log->writing.buf, log->writing.len);
+
+		log->writing.len = 0;
+
+		pthread_mutex_lock(&log->lock);
+
+		if (!is_written)
+			log->is_failed = true;
+
+		log->synced_count = group_end;
+		pthread_cond_broadcast(&log->is_synced);
+	}
+
+	pthread_mutex_unlock(&log->lock);
+
+	return NULL;
+}
+
+bool payload_log_open(struct payload_log *log, const char *dir,
+		      size_t segment_size)
+{
+	assert(segment_size > sizeof(struct log_batch) &&
+	       segment_size <= UINT32_MAX);
+
+	if (mkdir(dir, 0755) == -1 && errno != EEXIST)
+		return false;
+
+	// after the last segment of a previous run
+	char path[PATH_MAX];
+	size_t segment = 0;
+
+	for (segment_path(path, dir, segment); access(path, F_OK) == 0;
+	     segment_path(path, dir, ++segment))
+		;
+
+	int fd = create_segment(dir, segment, segment_size);
+
+	if (fd == -1)
+		return false;
+
+	*log = (struct payload_log) {
+		.dir = strdup(dir),
+		.segment_size = segment_size,
+		.fd = fd,
+		.segment = segment,
+	};
+	assert(log->dir);
+
+	sink_init(&log->appended, SINK_MEMORY, OUTPUT_SINK_SIZE);
+	sink_init(&log->committed, SINK_MEMORY, OUTPUT_SINK_SIZE);
+	sink_init(&log->writing, SINK_MEMORY, OUTPUT_SINK_SIZE);
+
+	pthread_mutex_init(&log->lock, NULL);
+	pthread_cond_init(&log->has_work, NULL);
+	pthread_cond_init(&log->is_synced, NULL);
+	assert(pthread_create(&log->syncer, NULL, sync_groups, log) == 0);
+
+	return true;
+}
+
+bool payload_log_append(struct payload_log *log, const struct payload *p)
+{
+	size_t before = log->appended.len;
+
+	if (!encode_payload(p, &log->appended))
+		return false;
+
+	if (sizeof(struct log_batch) + log->appended.len - before >
+	    log->segment_size) {
+		log->appended.len = before;
+
+		return false;
+	}
+
+	return true;
+}
+
+void payload_log_commit(struct payload_log *log)
+{
+	if (log->appended.len == 0)
+		return;
+
+	pthread_mutex_lock(&log->lock);
+
+	// the syncer took the last commit, or is still behind: one copy then
+	if (log->committed.len == 0)
+		swap_sinks(&log->appended, &log->committed);
+	else
+		sink_write(&log->committed, log->appended.buf,
+			   log->appended.len);
+
+	log->appended.len = 0;
+	log->commit_count++;
+	pthread_cond_signal(&log->has_work);
+	pthread_mutex_unlock(&log->lock);
+}
+
+bool payload_log_sync(struct payload_log *log)
+{
+	payload_log_commit(log);
+
+	pthread_mutex_lock(&log->lock);
+
+	while (log->synced_count < log->commit_count)
+		pthread_cond_wait(&log->is_synced, &log->lock);
+
+	bool is_synced = !log->is_failed;
+
+	pthread_mutex_unlock(&log->lock);
+
+	return is_synced;
+}
+
+bool payload_log_close(struct payload_log *log)
+{
+	bool is_synced = payload_log_sync(log);
+
+	pthread_mutex_lock(&log->lock);
+	log->is_stopping = true;
+	pthread_cond_signal(&log->has_work);
+	pthread_mutex_unlock(&log->lock);
+
+	pthread_join(log->syncer, NULL);
+
+	if (log->fd != -1)
+		close(log->fd);
+
+	sink_destroy(&log->appended);
+	sink_destroy(&log->committed);
+	sink_destroy(&log->writing);
+	pthread_mutex_destroy(&log->lock);
+	pthread_cond_destroy(&log->has_work);
+	pthread_cond_destroy(&log->is_synced);
+	free(log->dir);
+
+	return is_synced;
+}
+
+/* payloads of the batches of a segment, up to its end or a torn batch */
+static void replay_segment(struct payload_buffer *buf,
+			   const struct mapped_file *segment)
+{
+	const char *data = segment->data;
+	size_t pos = 0;
+
+	while (segment->size - pos > sizeof(struct log_batch)) {
+		struct log_batch batch;
+
+		memcpy(&batch, data + pos, sizeof(batch));
+		pos += sizeof(batch);
+
+		if (batch.len == 0 || batch.len > segment->size - pos ||
+		    crc32c(data + pos, batch.len) != batch.checksum)
+			return;
+
+		const char *frame = data + pos;
+		const char *end = frame + batch.len;
+
+		// whole frames, the checksum says they are what was written
+		while (frame < end) {
+			size_t len = wire_frame_len(frame, end - frame);
+
+			if (len == 0 || len > (size_t) (end - frame))
+				return;
+
+			push_payload(buf, frame, len);
+			frame += len;
+		}
+
+		pos += batch.len;
+	}
+}
+
+struct replay_worker {
+	pthread_t thread;
+	const struct mapped_file *segments;  /**< Of this worker */
+	size_t segment_count;
+	struct payload_buffer *result;       /**< Private, until stitched */
+};
+
+static void *replay_segments(void *arg)
+{
+	struct replay_worker *w = arg;
+
+	for (size_t i = 0; i < w->segment_count; i++)
+		replay_segment(w->result, &w->segments[i]);
+
+	return NULL;
+}
+
+size_t payload_log_replay(struct payload_buffer *buf, const char *dir)
+{
+	struct mapped_file *segments = NULL;
+	size_t count = 0, size = 0;
+	char path[PATH_MAX];
+
+	for (segment_path(path, dir, count); access(path, F_OK) == 0;
+	     segment_path(path, dir, ++count)) {
+		assert((segments = realloc(segments,
+					   sizeof(*segments) * (count + 1))));
+
+		if (!map_file(&segments[count], path))
+			segments[count] = (struct mapped_file) { 0 };
+
+		size += segments[count].size;
+	}
+
+	if (count == 0)
+		return 0;
+
+	// whole segments per worker, in order
+	size_t workers = parallel_worker_count(size);
+
+	if (workers > count)
+		workers = count;
+
+	struct replay_worker *pool = malloc(sizeof(*pool) * workers);
+	assert(pool);
+
+	for (size_t i = 0, first = 0; i < workers; i++) {
+		size_t last = count * (i + 1) / workers;
+
+		pool[i] = (struct replay_worker) {
+			.segments = segments + first,
+			.segment_count = last - first,
+			.result = new_buffer(),
+		};
+		first = last;
+	}
+
+	// the calling thread replays the first segments itself
+	for (size_t i = 1; i < workers; i++)
+		pthread_create(&pool[i].thread, NULL, replay_segments,
+			       &pool[i]);
+
+	replay_segments(&pool[0]);
+
+	for (size_t i = 0; i < workers; i++) {
+		if (i > 0)
+			pthread_join(pool[i].thread, NULL);
+
+		append_buffer(buf, pool[i].result);
+	}
+
+	for (size_t i = 0; i < count; i++)
+		unmap_file(&segments[i]);
+
+	free(pool);
+	free(segments);
+
+	return count;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file payload_log.h
+ * @brief Append-only log of payloads, in segment files of a fixed size.
+ *
+ * Payloads are appended as frames of the binary wire format, see
+ * wire_format.h. Appending only encodes into memory. Committing hands what
+ * was appended to a thread of the log, which writes it and calls
+ * fdatasync(); everything committed while it syncs waits, and goes to disk
+ * with the next single fdatasync(). That is a *group commit*: the more the
+ * server appends, the more each sync carries.
+ *
+ * A segment is named after its index, 00000000.log, 00000001.log... and is
+ * allocated at its full size when it is created, filled with zeros. Frames
+ * are written in batches, each behind a header with its length and its
+ * checksum. A zero length ends a segment, a wrong checksum is a batch torn
+ * by a crash: replay stops reading the segment there.
+ *
+ * A log that is opened again starts a new segment, it never writes after
+ * what a crash may have left behind.
+ */
+
+#ifndef PAYLOAD_LOG_H
+#define PAYLOAD_LOG_H
+
+
+#include "output_sink.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Default size of a segment file, 64 MiB. */
+#define PAYLOAD_LOG_SEGMENT_SIZE (64 << 20)
+
+struct payload;
+struct payload_buffer;
+
+/**
+ * @brief Header of a batch of frames, in a segment.
+ */
+struct log_batch {
+	uint32_t len;       /**< Bytes of frames that follow, 0 if none */
+	uint32_t checksum;  /**< CRC-32C of those bytes */
+};
+
+struct payload_log {
+	char *dir;
+	size_t segment_size;
+	struct output_sink appended;   /**< Not committed yet, see append */
+
+	pthread_mutex_t lock;
+	pthread_cond_t has_work;
+	pthread_cond_t is_synced;
+	struct output_sink committed;  /**< Not taken by the syncer yet */
+	uint64_t commit_count;         /**< Commits with something in them */
+	uint64_t synced_count;         /**< Of those, on disk */
+	bool is_failed;                /**< A write or a sync failed */
+	bool is_stopping;
+	pthread_t syncer;
+
+	// only the syncer touches these once the log is open
+	struct output_sink writing;    /**< The group being written */
+	int fd;                        /**< Segment being written */
+	size_t segment;                /**< Its index */
+	size_t offset;                 /**< Where its next batch goes */
+	size_t sync_count;             /**< fdatasync() calls so far */
+};
+
+
+/**
+ * @brief Opens the log in dir, creating dir if needed, and starts a new
+ *        segment.
+ *
+ * @param log Log to open
+ * @param dir Directory of the segments
+ * @param segment_size Size of each segment, e.g. PAYLOAD_LOG_SEGMENT_SIZE
+ * @return false if dir or the segment could not be created, errno tells
+ *         why
+ */
+bool payload_log_open(struct payload_log *log, const char *dir,
+		      size_t segment_size);
+
+/**
+ * @brief Appends the frame of a payload, in memory.
+ *
+ * Only one thread may append and commit.
+ *
+ * @return false if the payload has no frame, or its frame does not fit in
+ *         a segment
+ */
+bool payload_log_append(struct payload_log *log, const struct payload *p);
+
+/**
+ * @brief Hands what was appended to the syncer, without waiting for it.
+ */
+void payload_log_commit(struct payload_log *log);
+
+/**
+ * @brief Commits, then waits until every commit is on disk.
+ *
+ * @return false if writing failed, payloads committed since are dropped
+ */
+bool payload_log_sync(struct payload_log *log);
+
+/**
+ * @brief Syncs, stops the syncer, and frees the log.
+ *
+ * @return false if writing failed, see payload_log_sync()
+ */
+bool payload_log_close(struct payload_log *log);
+
+/**
+ * @brief Maps every segment of dir, and adds their payloads to buf in the
+ *        order they were appended.
+ *
+ * Frames are decoded, not text: see parse_payload_binary(). Segments are
+ * replayed on several threads, like a payloads file is parsed, see
+ * parallel_parser.h.
+ *
+ * @param buf Pointer to the payload buffer
+ * @param dir Directory of the segments
+ * @return Number of segments replayed, 0 if there are none
+ */
+size_t payload_log_replay(struct payload_buffer *buf, const char *dir);
+
+
+#endif
@@ -0,0 +1,389 @@
+// Records are parsed from lines with the same tokenizer, command registry and
+// intern table as payloads, only the output differs: instead of filling a
+// struct payload, fields are appended to the strings and receivers arrays.
+//
+// Processing is a single switch on the kind of each record. There is no
+// vtable to load, the kind is in the record itself.
+
+#include "command_registry.h"
+#include "intern.h"
+#include "output_sink.h"
+#include "payload.h"
+#include "record_store.h"
+#include "tokenizer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* only the table of chunk pointers is ever reallocated */
+static void reserve_slots(struct record_chunks *c, size_t slots)
+{
+	if (c->cap >= slots)
+		return;
+
+	size_t cap = c->cap > 0 ? c->cap : 8;
+
+	while (cap < slots)
+		cap *= 2;
+
+	c->chunks = realloc(c->chunks, sizeof(char *) * cap);
+	assert(c->chunks);
+
+	c->cap = cap;
+}
+
+/* allocates chunks until len elements of the given size fit */
+static void reserve_chunks(struct record_chunks *c, size_t len, size_t size)
+{
+	size_t per_chunk = RECORD_CHUNK_BYTES / size;
+	size_t needed = (len + per_chunk - 1) / per_chunk;
+
+	if (c->count >= needed)
+		return;
+
+	reserve_slots(c, needed);
+
+	while (c->count < needed) {
+		c->chunks[c->count] = malloc(RECORD_CHUNK_BYTES);
+		assert(c->chunks[c->count]);
+		c->count++;
+	}
+}
+
+/*
+ * room for a field of size bytes, NULL if it does not fit under
+ * RECORD_STORE_MAX_STRINGS
+ */
+static char *alloc_field(struct record_store *s, size_t size,
+			 uint32_t *offset)
+{
+	size_t begin = s->strings_len;
+
+	// a field never straddles two chunks, it starts at the next one if it
+	// does not fit in the rest of this one
+	if (begin % RECORD_CHUNK_BYTES != 0 &&
+	    begin % RECORD_CHUNK_BYTES + size > RECORD_CHUNK_BYTES)
+		begin += RECORD_CHUNK_BYTES - begin % RECORD_CHUNK_BYTES;
+
+	size_t chunk = begin / RECORD_CHUNK_BYTES;
+
+	if (size <= RECORD_CHUNK_BYTES) {
+		if (begin + size > RECORD_STORE_MAX_STRINGS)
+			return NULL;
+
+		reserve_chunks(&s->strings, begin + size, 1);
+		s->strings_len = begin + size;
+	} else {
+		// as many slots as the field covers, the field starts at the
+		// first one
+		size_t slots = (size + RECORD_CHUNK_BYTES - 1) /
+			RECORD_CHUNK_BYTES;
+
+		if (begin + slots * RECORD_CHUNK_BYTES > RECORD_STORE_MAX_STRINGS)
+			return NULL;
+
+		reserve_slots(&s->strings, chunk + slots);
+
+		// slots between the last chunk and the field hold nothing
+		for (size_t i = s->strings.count; i < chunk; i++)
+			s->strings.chunks[i] = NULL;
+
+		s->strings.chunks[chunk] = malloc(size);
+		assert(s->strings.chunks[chunk]);
+
+		for (size_t i = 1; i < slots; i++)
+			s->strings.chunks[chunk + i] = NULL;
+
+		s->strings.count = chunk + slots;
+		s->strings_len = begin + slots * RECORD_CHUNK_BYTES;
+	}
+
+	*offset = begin;
+
+	return s->strings.chunks[chunk] + begin % RECORD_CHUNK_BYTES;
+}
+
+/* a 32-bit length followed by the string, at the end of a field */
+static void store_string(char *field, const char *str, size_t len)
+{
+	uint32_t len32 = len;
+
+	memcpy(field, &len32, sizeof(len32));
+	memcpy(field + sizeof(len32), str, len);
+}
+
+/* fields are not aligned in strings, memcpy compiles to a single load */
+static uint32_t load_u32(const char *p)
+{
+	uint32_t value;
+
+	memcpy(&value, p, sizeof(value));
+
+	return value;
+}
+
+static void push_receiver(struct record_store *s, uint32_t receiver)
+{
+	reserve_chunks(&s->receivers, s->receiver_len + 1, sizeof(uint32_t));
+
+	uint32_t *chunk = (uint32_t *)
+		s->receivers.chunks[s->receiver_len / RECEIVER_CHUNK_SIZE];
+
+	chunk[s->receiver_len++ % RECEIVER_CHUNK_SIZE] = receiver;
+}
+
+static bool pack_message(struct record_store *s, const char *raw, size_t len,
+			 struct record *r)
+{
+	struct tokenizer t;
+	struct token token;
+	size_t receiver_len = s->receiver_len;
+
+	*r = (struct record) { .kind = RECORD_MESSAGE };
+	tokenizer_init(&t, raw, len);
+
+	// receivers until the first token that is not one, the rest of the
+	// line is the content
+	size_t content_offset = 0;
+	while (next_token(&t, &token) && token.len > 0 &&
+	       (token.ptr[0] == '@' || token.ptr[0] == '#')) {
+		assert(!tokenizer_done(&t));
+		assert(token.len > 1);
+		assert(r->receiver_count < UINT16_MAX);
+
+		uint32_t name = intern(token.ptr + 1, token.len - 1);
+
+		if (name == INTERN_NONE) {
+			s->receiver_len = receiver_len;
+			return false;
+		}
+
+		push_receiver(s, RECORD_RECEIVER(name, token.ptr[0] == '#'));
+		r->receiver_count++;
+
+		content_offset = t.pos;
+	}
+
+	size_t content_len = len - content_offset;
+	char *field = alloc_field(s, sizeof(uint32_t) + content_len,
+				  &r->offset);
+
+	if (field == NULL) {
+		// the receivers belong to no record
+		s->receiver_len = receiver_len;
+		return false;
+	}
+
+	store_string(field, raw + content_offset, content_len);
+
+	return true;
+}
+
+static bool pack_command(struct record_store *s,
+			 const struct command *command,
+			 const struct token *args, size_t arg_count,
+			 struct record *r)
+{
+	*r = (struct record) { 0 };
+
+	if (command->vtable == &command_login_vtable) {
+		assert(arg_count == 2);
+		assert(args[0].len > 0 && args[1].len > 0);
+
+		uint32_t username = intern(args[0].ptr, args[0].len);
+
+		if (username == INTERN_NONE)
+			return false;
+
+		char *field = alloc_field(s, 2 * sizeof(uint32_t) + args[1].len,
+					  &r->offset);
+
+		if (field == NULL)
+			return false;
+
+		r->kind = RECORD_LOGIN;
+		memcpy(field, &username, sizeof(username));
+		store_string(field + sizeof(username), args[1].ptr,
+			     args[1].len);
+	} else if (command->vtable == &command_join_vtable) {
+		assert(arg_count >= 1);
+		assert(args[0].len > 0);
+
+		r->kind = RECORD_JOIN;
+		r->offset = intern(args[0].ptr, args[0].len);
+
+		if (r->offset == INTERN_NONE)
+			return false;
+	} else {
+		assert(command->vtable == &command_logout_vtable);
+
+		r->kind = RECORD_LOGOUT;
+	}
+
+	return true;
+}
+
+void record_store_init(struct record_store *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+void record_store_reserve(struct record_store *s, size_t count)
+{
+	reserve_chunks(&s->records, s->len + count, sizeof(struct record));
+}
+
+bool record_store_push(struct record_store *s, const char *raw, size_t len)
+{
+	struct record r;
+	bool packed;
+
+	if (raw[0] == '/') {
+		struct token tokens[COMMAND_MAX_ARGUMENTS + 1];
+		size_t token_count = tokenize(raw + 1, len - 1, tokens,
+					      COMMAND_MAX_ARGUMENTS + 1);
+		const struct command *command = find_command(tokens[0]);
+
+		if (command == NULL) {
+			printf("Ignoring invalid command %.*s\n",
+			       (int) tokens[0].len, tokens[0].ptr);
+			return false;
+		}
+
+		packed = pack_command(s, command, tokens + 1, token_count - 1,
+				      &r);
+	} else {
+		packed = pack_message(s, raw, len, &r);
+	}
+
+	if (!packed) {
+		printf("Ignoring %.*s, the record store or the intern table "
+		       "is full\n", (int) len, raw);
+		return false;
+	}
+
+	reserve_chunks(&s->records, s->len + 1, sizeof(struct record));
+	*record_at(s, s->len++) = r;
+
+	return true;
+}
+
+static void sink_name(struct output_sink *out, uint32_t id)
+{
+	sink_write(out, interned_name(id), interned_len(id));
+}
+
+/* walks the receivers array, from chunk to chunk */
+struct receiver_cursor {
+	const uint32_t *next;
+	const uint32_t *end;
+	char *const *chunk;  /**< Next chunk */
+};
+
+static uint32_t next_receiver(struct receiver_cursor *c)
+{
+	if (c->next == c->end) {
+		c->next = (const uint32_t *) *c->chunk++;
+		c->end = c->next + RECEIVER_CHUNK_SIZE;
+	}
+
+	return *c->next++;
+}
+
+static void dispatch_message(struct record r, const char *content,
+			     struct receiver_cursor *receivers,
+			     struct output_sink *out)
+{
+	size_t content_len = load_u32(content);
+
+	content += sizeof(uint32_t);
+
+	if (r.receiver_count == 0) {
+		sink_literal(out, "Global message: ");
+		sink_write(out, content, content_len);
+		sink_literal(out, "\n");
+	}
+
+	for (uint16_t i = 0; i < r.receiver_count; i++) {
+		uint32_t receiver = next_receiver(receivers);
+
+		if (receiver & 1)
+			sink_literal(out, "Group message to ");
+		else
+			sink_literal(out, "Direct message to ");
+
+		sink_name(out, receiver >> 1);
+		sink_literal(out, ": ");
+		sink_write(out, content, content_len);
+		sink_literal(out, "\n");
+	}
+}
+
+static void dispatch_record(const struct record_store *s, struct record r,
+			    struct receiver_cursor *receivers,
+			    struct output_sink *out)
+{
+	switch (r.kind) {
+	case RECORD_LOGIN: {
+		const char *field = record_fields(s, r.offset);
+		uint32_t username = load_u32(field);
+		uint32_t password_len = load_u32(field + 4);
+
+		sink_literal(out, "Command: login\n"
+				  "  Arguments: [username: ");
+		sink_name(out, username);
+		sink_literal(out, ", password ");
+		sink_write(out, field + 8, password_len);
+		sink_literal(out, "]\n");
+		break;
+	}
+	case RECORD_JOIN:
+		sink_literal(out, "Command: join\n"
+				  "  Arguments: [channel: ");
+		sink_name(out, r.offset);
+		sink_literal(out, "]\n");
+		break;
+	case RECORD_LOGOUT:
+		sink_literal(out, "Command: logout\n  Arguments: []\n");
+		break;
+	case RECORD_MESSAGE:
+		// receivers of each message follow those of the previous one
+		dispatch_message(r, record_fields(s, r.offset), receivers, out);
+		break;
+	}
+}
+
+void record_store_dispatch(const struct record_store *s,
+			   struct output_sink *out)
+{
+	struct receiver_cursor receivers = {
+		.chunk = s->receivers.chunks,
+	};
+
+	for (size_t first = 0; first < s->len; first += RECORD_CHUNK_SIZE) {
+		const struct record *chunk = record_at(s, first);
+		size_t count = s->len - first < RECORD_CHUNK_SIZE ?
+			s->len - first : RECORD_CHUNK_SIZE;
+
+		for (size_t i = 0; i < count; i++)
+			dispatch_record(s, chunk[i], &receivers, out);
+	}
+}
+
+static void free_chunks(struct record_chunks *c)
+{
+	for (size_t i = 0; i < c->count; i++)
+		free(c->chunks[i]);
+
+	free(c->chunks);
+}
+
+void record_store_destroy(struct record_store *s)
+{
+	free_chunks(&s->records);
+	free_chunks(&s->receivers);
+	free_chunks(&s->strings);
+}
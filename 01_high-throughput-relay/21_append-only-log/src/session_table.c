@@ -0,0 +1,145 @@
+// Linear probing: a session goes in the first free slot from the home slot
+// of its user. Lookups walk the slots from there until a free one, which
+// usually means reading one cache line.
+//
+// Usernames are interned in order of appearance, so user IDs are sequential.
+// Used as slot indices directly, a user with two connections would spill into
+// the home slot of the next user, and so on: they are scrambled with a
+// multiplication first.
+//
+// Removing a session cannot simply free its slot, that would cut the probe
+// sequence of sessions after it. The usual fix, a tombstone, makes every
+// lookup slower until the table is rebuilt, and a chat server logs users in
+// and out all day. Instead, sessions after the freed slot are moved back into
+// it when their home slot allows, until a free slot is reached.
+
+#include "session_table.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+
+static size_t home_slot(const struct session_table *t, uint32_t user)
+{
+	return (size_t) ((user * 0x9e3779b97f4a7c15ull) >> 32) & t->mask;
+}
+
+static void allocate_slots(struct session_table *t, size_t slot_count)
+{
+	t->slots = malloc(sizeof(struct session) * slot_count);
+	assert(t->slots);
+
+	for (size_t i = 0; i < slot_count; i++)
+		t->slots[i] = (struct session) { .fd = SESSION_EMPTY };
+
+	t->mask = slot_count - 1;
+}
+
+/* the slot of a new session, the table has a free one */
+static size_t free_slot(const struct session_table *t, uint32_t user)
+{
+	size_t i = home_slot(t, user);
+
+	while (t->slots[i].fd != SESSION_EMPTY)
+		i = (i + 1) & t->mask;
+
+	return i;
+}
+
+static void grow(struct session_table *t)
+{
+	struct session *old = t->slots;
+	size_t old_count = t->mask + 1;
+
+	allocate_slots(t, old_count * 2);
+
+	for (size_t i = 0; i < old_count; i++)
+		if (old[i].fd != SESSION_EMPTY)
+			t->slots[free_slot(t, old[i].user)] = old[i];
+
+	free(old);
+}
+
+void session_table_init(struct session_table *t, size_t expected)
+{
+	size_t slot_count = SESSION_TABLE_INITIAL_SLOTS;
+
+	// at most half full, probe sequences stay short
+	while (slot_count < expected * 2)
+		slot_count *= 2;
+
+	t->len = 0;
+	allocate_slots(t, slot_count);
+}
+
+void session_login(struct session_table *t, uint32_t user, int fd)
+{
+	assert(fd != SESSION_EMPTY);
+
+	if ((t->len + 1) * 2 > t->mask + 1)
+		grow(t);
+
+	t->slots[free_slot(t, user)] = (struct session) {
+		.user = user,
+		.fd = fd,
+	};
+	t->len++;
+}
+
+bool session_logout(struct session_table *t, uint32_t user, int fd)
+{
+	size_t i = home_slot(t, user);
+
+	while (t->slots[i].user != user || t->slots[i].fd != fd) {
+		if (t->slots[i].fd == SESSION_EMPTY)
+			return false;
+
+		i = (i + 1) & t->mask;
+	}
+
+	// i is free now, j looks for a session that may move there
+	for (size_t j = (i + 1) & t->mask; t->slots[j].fd != SESSION_EMPTY;
+	     j = (j + 1) & t->mask) {
+		size_t home = home_slot(t, t->slots[j].user);
+
+		// a session must stay between its home slot and j: it moves
+		// only if its home slot is not in (i, j], cyclically
+		if (((j - home) & t->mask) >= ((j - i) & t->mask)) {
+			t->slots[i] = t->slots[j];
+			i = j;
+		}
+	}
+
+	t->slots[i].fd = SESSION_EMPTY;
+	t->len--;
+
+	return true;
+}
+
+size_t session_find(const struct session_table *t, uint32_t user)
+{
+	for (size_t i = home_slot(t, user); t->slots[i].fd != SESSION_EMPTY;
+	     i = (i + 1) & t->mask)
+		if (t->slots[i].user == user)
+			return i;
+
+	return SESSION_NONE;
+}
+
+size_t session_find_next(const struct session_table *t, size_t slot)
+{
+	uint32_t user = t->slots[slot].user;
+
+	for (size_t i = (slot + 1) & t->mask; t->slots[i].fd != SESSION_EMPTY;
+	     i = (i + 1) & t->mask)
+		if (t->slots[i].user == user)
+			return i;
+
+	return SESSION_NONE;
+}
+
+void session_table_destroy(struct session_table *t)
+{
+	free(t->slots);
+	*t = (struct session_table) { 0 };
+}
@@ -0,0 +1,94 @@
+/**
+ * @file session_table.h
+ * @brief Logged in users and their connections, an open-addressing map.
+ *
+ * The key of a session is the interned username, see intern.h, so every key
+ * is 4 bytes and lives in the slot itself, next to the connection's file
+ * descriptor: a slot is 8 bytes, a cache line holds 8 of them, and a lookup
+ * reads the slots and nothing else.
+ *
+ * A user logged in from several connections has one slot per connection.
+ * They all are in the probe sequence of the username, a lookup walks them
+ * until it meets an empty slot.
+ */
+
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief Slots of a table sized for no user in particular. */
+#define SESSION_TABLE_INITIAL_SLOTS 1024
+
+/** @brief File descriptor of empty slots. */
+#define SESSION_EMPTY (-1)
+
+/** @brief Returned by lookups when there is no (more) session. */
+#define SESSION_NONE SIZE_MAX
+
+struct session {
+	uint32_t user;  /**< Interned username */
+	int32_t fd;     /**< Connection, SESSION_EMPTY if the slot is free */
+};
+
+struct session_table {
+	struct session *slots;
+	size_t mask;   /**< Number of slots minus one */
+	size_t len;    /**< Sessions in use */
+};
+
+
+/**
+ * @brief Allocates room for a number of sessions at once.
+ *
+ * @param t Table to initialize
+ * @param expected Sessions expected, e.g. millions, so that logins never
+ *        rehash the table; 0 for SESSION_TABLE_INITIAL_SLOTS
+ */
+void session_table_init(struct session_table *t, size_t expected);
+
+/**
+ * @brief Adds a session of user on connection fd.
+ *
+ * The pair must not be in the table already, a connection logs in once.
+ */
+void session_login(struct session_table *t, uint32_t user, int fd);
+
+/**
+ * @brief Removes the session of user on connection fd.
+ *
+ * Sessions after it in the probe sequence are moved back, no tombstone is
+ * left: tables with constant churn stay as fast as new ones.
+ *
+ * @return false if there was no such session
+ */
+bool session_logout(struct session_table *t, uint32_t user, int fd);
+
+/**
+ * @brief Slot of the first session of a user. Never allocates.
+ *
+ * Every session of the user is visited with:
+ *
+ *     for (size_t i = session_find(t, user); i != SESSION_NONE;
+ *          i = session_find_next(t, i))
+ *             send_to(t->slots[i].fd);
+ *
+ * Slots are valid until the next login or logout.
+ *
+ * @return Index in t->slots, or SESSION_NONE if the user is not logged in
+ */
+size_t session_find(const struct session_table *t, uint32_t user);
+
+/**
+ * @brief Slot of the next session of the same user, or SESSION_NONE.
+ */
+size_t session_find_next(const struct session_table *t, size_t slot);
+
+void session_table_destroy(struct session_table *t);
+
+
+#endif
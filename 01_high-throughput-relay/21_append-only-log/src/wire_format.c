@@ -0,0 +1,468 @@
+// Decoding a frame never searches for the end of a field: every length is
+// read before the bytes it covers, and the kind byte indexes a table of
+// decoders. The bytes a field covers are still checked: a frame may only
+// carry what a line could, or one client could forge lines of the output.
+//
+// A varint is read with one 8-byte load when the frame has that many bytes
+// left. Its last byte is the first without the high bit, found with a count
+// of trailing zeros, and the 7-bit groups are gathered with shifts and masks
+// instead of a loop. Only the last few bytes of a frame take the loop.
+
+#include "arena.h"
+#include "intern.h"
+#include "output_sink.h"
+#include "payload.h"
+#include "wire_format.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+
+/* bytes of a frame, not consumed yet */
+struct frame_reader {
+	const unsigned char *pos;
+	const unsigned char *end;
+	// intern(), or interned_id() for frames of clients
+	uint32_t (*receiver_id)(const char *, size_t);
+};
+
+static bool read_varint_slow(struct frame_reader *r, uint32_t *value)
+{
+	uint64_t v = 0;
+
+	for (int i = 0; i < WIRE_VARINT_MAX && r->pos < r->end; i++) {
+		unsigned char byte = *r->pos++;
+
+		v |= (uint64_t) (byte & 0x7f) << (7 * i);
+
+		if ((byte & 0x80) == 0) {
+			*value = v;
+
+			return v <= UINT32_MAX;
+		}
+	}
+
+	return false;
+}
+
+/* false if the varint is cut off, longer than 5 bytes, or above 32 bits */
+static bool read_varint(struct frame_reader *r, uint32_t *value)
+{
+	if (r->end - r->pos < 8)
+		return read_varint_slow(r, value);
+
+	uint64_t word;
+
+	memcpy(&word, r->pos, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	word = __builtin_bswap64(word);
+#endif
+
+	// the high bit of every byte, cleared on the last one of the varint
+	uint64_t stops = ~word & 0x8080808080808080ull;
+
+	if (stops == 0)
+		return false;
+
+	int bytes = __builtin_ctzll(stops) / 8 + 1;
+
+	if (bytes > WIRE_VARINT_MAX)
+		return false;
+
+	word &= ~0ull >> (64 - 8 * bytes);
+
+	uint64_t v = (word & 0x7f) | (word >> 1 & 0x3f80) |
+		     (word >> 2 & 0x1fc000) | (word >> 3 & 0xfe00000) |
+		     (word >> 4 & 0x7f0000000);
+
+	r->pos += bytes;
+	*value = v;
+
+	return v <= UINT32_MAX;
+}
+
+/* a varint length, then that many bytes, all within the frame */
+static bool read_string(struct frame_reader *r, const char **str,
+			uint32_t *len)
+{
+	if (!read_varint(r, len) || *len > (size_t) (r->end - r->pos))
+		return false;
+
+	*str = (const char *) r->pos;
+	r->pos += *len;
+
+	return true;
+}
+
+size_t wire_frame_len(const char *data, size_t len)
+{
+	struct frame_reader r = {
+		.pos = (const unsigned char *) data + 1,
+		.end = (const unsigned char *) data + len,
+	};
+	uint32_t body;
+
+	if (read_varint(&r, &body))
+		return (const char *) r.pos - data + (size_t) body;
+
+	// a cut varint may still be valid once the rest arrives
+	return len < WIRE_HEADER_MAX ? 0 : WIRE_FRAME_INVALID;
+}
+
+/* bit 7 of each byte of w that is below n, for n up to 128 */
+static inline uint64_t bytes_below(uint64_t w, unsigned char n)
+{
+	return (w - 0x0101010101010101ull * n) & ~w & 0x8080808080808080ull;
+}
+
+/* bit 7 of each byte of w equal to c */
+static inline uint64_t bytes_equal(uint64_t w, unsigned char c)
+{
+	return bytes_below(w ^ 0x0101010101010101ull * c, 1);
+}
+
+bool is_valid_token(const char *str, size_t len)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		uint64_t w;
+
+		memcpy(&w, str + i, sizeof(w));
+		if (bytes_below(w, '!') | bytes_equal(w, 0x7f))
+			return false;
+	}
+
+	for (; i < len; i++)
+		if ((unsigned char) str[i] <= ' ' || str[i] == 0x7f)
+			return false;
+
+	return true;
+}
+
+static void *allocate(struct arena *arena, size_t size)
+{
+	void *ptr = arena ? arena_alloc(arena, size) : malloc(size);
+	assert(ptr);
+
+	return ptr;
+}
+
+/* fields of payloads are null-terminated, those of frames are not */
+static char *copy_string(struct arena *arena, const char *str, size_t len)
+{
+	char *copy = allocate(arena, sizeof(char) * (len + 1));
+
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+
+	return copy;
+}
+
+/* copy_string() for content, checked in the same pass: false if it holds a
+ * newline or a NUL, which no line can */
+static bool copy_content(struct arena *arena, const char *str, size_t len,
+			 char **content)
+{
+	char *copy = allocate(arena, sizeof(char) * (len + 1));
+	bool is_valid;
+
+#ifdef __x86_64__
+	if (len >= 16) {
+		// SSE2 is part of x86-64, the last block overlaps the one
+		// before it
+		__m128i newlines = _mm_set1_epi8('\n');
+		__m128i bad = _mm_setzero_si128();
+
+		for (size_t i = 0; i < len; i += 16) {
+			size_t at = i + 16 <= len ? i : len - 16;
+			__m128i block =
+				_mm_loadu_si128((const __m128i *) (str + at));
+
+			bad = _mm_or_si128(bad, _mm_or_si128(
+				_mm_cmpeq_epi8(block, newlines),
+				_mm_cmpeq_epi8(block, _mm_setzero_si128())));
+			_mm_storeu_si128((__m128i *) (copy + at), block);
+		}
+
+		is_valid = _mm_movemask_epi8(bad) == 0;
+	} else
+#endif
+	{
+		memcpy(copy, str, len);
+		is_valid = memchr(str, '\n', len) == NULL &&
+			   memchr(str, '\0', len) == NULL;
+	}
+
+	if (!is_valid) {
+		if (arena == NULL)
+			free(copy);
+
+		return false;
+	}
+
+	copy[len] = '\0';
+	*content = copy;
+
+	return true;
+}
+
+static bool decode_login(struct payload *p, struct frame_reader *r,
+			 struct arena *arena)
+{
+	const char *username, *password;
+	uint32_t username_len, password_len;
+
+	if (!read_string(r, &username, &username_len) ||
+	    !read_string(r, &password, &password_len) ||
+	    username_len == 0 || password_len == 0 || r->pos != r->end ||
+	    !is_valid_token(username, username_len) ||
+	    !is_valid_token(password, password_len))
+		return false;
+
+	p->data.command_login.username = intern(username, username_len);
+
+	// the intern table is full
+	if (p->data.command_login.username == INTERN_NONE)
+		return false;
+
+	p->data.command_login.password =
+		copy_string(arena, password, password_len);
+
+	return true;
+}
+
+static bool decode_join(struct payload *p, struct frame_reader *r,
+			[[maybe_unused]] struct arena *arena)
+{
+	const char *channel;
+	uint32_t channel_len;
+
+	if (!read_string(r, &channel, &channel_len) || channel_len == 0 ||
+	    r->pos != r->end || !is_valid_token(channel, channel_len))
+		return false;
+
+	p->data.command_join.channel = intern(channel, channel_len);
+
+	return p->data.command_join.channel != INTERN_NONE;
+}
+
+static bool decode_logout([[maybe_unused]] struct payload *p,
+			  struct frame_reader *r,
+			  [[maybe_unused]] struct arena *arena)
+{
+	return r->pos == r->end;
+}
+
+static bool decode_message(struct payload *p, struct frame_reader *r,
+			   struct arena *arena)
+{
+	static const struct message_receiving_entity_vtable *const kinds[] = {
+		&direct_message_vtable,
+		&group_message_vtable,
+	};
+	uint32_t count;
+
+	// a receiver takes at least two bytes, a huge count is a lie and
+	// must not become a huge allocation
+	if (!read_varint(r, &count) || count > (size_t) (r->end - r->pos) / 2)
+		return false;
+
+	struct message_receiving_entity *receivers = allocate(
+		arena, sizeof(struct message_receiving_entity) *
+		(count ? count : 1));
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t tag;
+
+		if (!read_varint(r, &tag) || tag >> 1 == 0 ||
+		    tag >> 1 > (size_t) (r->end - r->pos) ||
+		    !is_valid_token((const char *) r->pos, tag >> 1))
+			goto fail;
+
+		receivers[i] = (struct message_receiving_entity) {
+			.vtable = kinds[tag & 1],
+			.name = r->receiver_id((const char *) r->pos, tag >> 1),
+		};
+		r->pos += tag >> 1;
+
+		if (receivers[i].name == INTERN_NONE)
+			goto fail;
+	}
+
+	// same shape as a parsed line: one global receiver
+	if (count == 0) {
+		receivers[0].vtable = &global_message_vtable;
+		count = 1;
+	}
+
+	p->data.message.receivers = receivers;
+	p->data.message.receiver_count = count;
+
+	if (copy_content(arena, (const char *) r->pos, r->end - r->pos,
+			 &p->data.message.content))
+		return true;
+
+fail:
+	if (arena == NULL)
+		free(receivers);
+
+	return false;
+}
+
+/* indexed by kind byte */
+static const struct {
+	const struct payload_vtable *vtable;
+	bool (*decode)(struct payload *p, struct frame_reader *r,
+		       struct arena *arena);
+} decoders[WIRE_KIND_END] = {
+	[WIRE_LOGIN] = { &command_login_vtable, decode_login },
+	[WIRE_JOIN] = { &command_join_vtable, decode_join },
+	[WIRE_LOGOUT] = { &command_logout_vtable, decode_logout },
+	[WIRE_MESSAGE] = { &message_vtable, decode_message },
+};
+
+static bool parse_frame(struct payload *p, const char *raw, size_t len,
+			struct arena *arena,
+			uint32_t (*receiver_id)(const char *, size_t))
+{
+	struct frame_reader r = {
+		.pos = (const unsigned char *) raw + 1,
+		.end = (const unsigned char *) raw + len,
+		.receiver_id = receiver_id,
+	};
+	uint32_t body;
+
+	assert(len > 0 && is_wire_frame(raw[0]));
+
+	if (!read_varint(&r, &body) || body != (size_t) (r.end - r.pos) ||
+	    !decoders[(unsigned char) raw[0]].decode(p, &r, arena)) {
+		printf("Ignoring invalid frame of kind %d\n", raw[0]);
+
+		return false;
+	}
+
+	p->vtable = decoders[(unsigned char) raw[0]].vtable;
+
+	return true;
+}
+
+bool parse_payload_binary(struct payload *p, const char *raw, size_t len,
+			  struct arena *arena)
+{
+	return parse_frame(p, raw, len, arena, intern);
+}
+
+bool parse_client_payload_binary(struct payload *p, const char *raw,
+				 size_t len, struct arena *arena)
+{
+	return parse_frame(p, raw, len, arena, interned_id);
+}
+
+static size_t varint_len(uint32_t value)
+{
+	return 1 + (value >= 1u << 7) + (value >= 1u << 14) +
+	       (value >= 1u << 21) + (value >= 1u << 28);
+}
+
+static void sink_varint(struct output_sink *out, uint32_t value)
+{
+	char bytes[WIRE_VARINT_MAX];
+	size_t len = 0;
+
+	while (value >= 0x80) {
+		bytes[len++] = (char) (value | 0x80);
+		value >>= 7;
+	}
+
+	bytes[len++] = (char) value;
+	sink_write(out, bytes, len);
+}
+
+/* body length of a string field */
+static size_t string_len(size_t len)
+{
+	return varint_len(len) + len;
+}
+
+static void sink_header(struct output_sink *out, enum wire_kind kind,
+			size_t body)
+{
+	char byte = kind;
+
+	sink_write(out, &byte, 1);
+	sink_varint(out, body);
+}
+
+static void sink_name_field(struct output_sink *out, uint32_t name)
+{
+	sink_varint(out, interned_len(name));
+	sink_write(out, interned_name(name), interned_len(name));
+}
+
+static void encode_message(const struct payload *p, struct output_sink *out)
+{
+	const struct message_receiving_entity *receivers =
+		p->data.message.receivers;
+	size_t count = p->data.message.receiver_count;
+	size_t content_len = strlen(p->data.message.content);
+
+	// a global message has no receiver on the wire
+	if (count == 1 && receivers[0].vtable == &global_message_vtable)
+		count = 0;
+
+	size_t body = varint_len(count) + content_len;
+
+	for (size_t i = 0; i < count; i++) {
+		size_t name_len = interned_len(receivers[i].name);
+
+		body += varint_len(name_len << 1) + name_len;
+	}
+
+	sink_header(out, WIRE_MESSAGE, body);
+	sink_varint(out, count);
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t name = receivers[i].name;
+		bool is_group = receivers[i].vtable == &group_message_vtable;
+
+		sink_varint(out, interned_len(name) << 1 | is_group);
+		sink_write(out, interned_name(name), interned_len(name));
+	}
+
+	sink_write(out, p->data.message.content, content_len);
+}
+
+bool encode_payload(const struct payload *p, struct output_sink *out)
+{
+	if (p->vtable == &command_login_vtable) {
+		uint32_t username = p->data.command_login.username;
+		const char *password = p->data.command_login.password;
+
+		sink_header(out, WIRE_LOGIN,
+			    string_len(interned_len(username)) +
+			    string_len(strlen(password)));
+		sink_name_field(out, username);
+		sink_varint(out, strlen(password));
+		sink_string(out, password);
+	} else if (p->vtable == &command_join_vtable) {
+		uint32_t channel = p->data.command_join.channel;
+
+		sink_header(out, WIRE_JOIN, string_len(interned_len(channel)));
+		sink_name_field(out, channel);
+	} else if (p->vtable == &command_logout_vtable) {
+		sink_header(out, WIRE_LOGOUT, 0);
+	} else if (p->vtable == &message_vtable) {
+		encode_message(p, out);
+	} else {
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file worker_pool.h
+ * @brief Threads that run tasks in parallel, in order within a key.
+ *
+ * Every task has a key, e.g. the connection it came from. Tasks of one key
+ * run one at a time, in the order they were submitted; tasks of different
+ * keys run on any worker, at the same time.
+ *
+ * The tasks of a key wait in a queue of their own. A key's queue is handed
+ * to one worker at a time, as a whole, and the worker runs every task in it
+ * before letting go. Each worker has a list of queues that are ready to
+ * run, keys are spread over those lists by value. A worker whose list is
+ * empty steals a queue from the list of another one.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Header of a task, embedded at the start of the caller's own struct.
+ */
+struct pool_task {
+	uint32_t key;            /**< Small integer, e.g. a file descriptor */
+	struct pool_task *next;  /**< Next task of the same key */
+};
+
+/**
+ * @brief Runs a task.
+ *
+ * @param task Task submitted with worker_pool_submit()
+ * @param worker Index of the worker running it, below worker_count; 0 is the
+ *        thread that submits and waits
+ * @param ctx Context given to worker_pool_init()
+ */
+typedef void (*pool_run)(struct pool_task *task, size_t worker, void *ctx);
+
+/** @brief Tasks of one key, internal. */
+struct key_queue;
+
+/** @brief Queues ready to run, of one worker, internal. */
+struct ready_list {
+	struct key_queue **queues;  /**< A ring */
+	size_t head;
+	size_t len;
+	size_t cap;
+};
+
+struct worker_pool {
+	pthread_mutex_t lock;   /**< Held to move queues, not to run tasks */
+	pthread_cond_t has_work;
+	pthread_cond_t is_done;
+	struct key_queue **keys;  /**< Queue of each key, NULL until used */
+	size_t key_cap;
+	struct ready_list *ready; /**< Of each worker */
+	pthread_t *threads;       /**< Of workers 1 and up */
+	size_t worker_count;      /**< Threads, plus the one that waits */
+	size_t pending;           /**< Submitted, not run yet */
+	bool is_stopping;
+	pool_run run;
+	void *ctx;
+};
+
+
+/**
+ * @brief Number of threads to start besides the caller: one per other
+ *        online CPU.
+ */
+size_t worker_pool_default_threads(void);
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param pool Pool to initialize
+ * @param threads Threads to start, 0 to run every task at once, in
+ *        worker_pool_submit()
+ * @param run Function that runs a task
+ * @param ctx Passed to run
+ */
+void worker_pool_init(struct worker_pool *pool, size_t threads, pool_run run,
+		      void *ctx);
+
+/**
+ * @brief Queues a task behind the previous tasks of its key.
+ *
+ * Only one thread may submit. The task must stay valid until it has run,
+ * see worker_pool_wait().
+ */
+void worker_pool_submit(struct worker_pool *pool, struct pool_task *task);
+
+/**
+ * @brief Returns once every submitted task has run.
+ *
+ * The calling thread is worker 0 meanwhile: it runs tasks too.
+ */
+void worker_pool_wait(struct worker_pool *pool);
+
+/**
+ * @brief Waits for every task, then stops and joins the threads.
+ */
+void worker_pool_destroy(struct worker_pool *pool);
+
+
+#endif
@@ -0,0 +1,49 @@
+#include "../src/command_registry.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const struct command *find(const char *name)
+{
+	return find_command((struct token) { .ptr = name, .len = strlen(name) });
+}
+
+int main()
+{
+	const char *registered[] = { "login", "join", "logout" };
+
+	for (size_t i = 0; i < sizeof(registered) / sizeof(char *); i++) {
+		const struct command *command = find(registered[i]);
+
+		// catches a COMMANDS entry with wrong key characters
+		assert(command);
+		assert(strcmp(command->name, registered[i]) == 0);
+		assert(command->name_len == strlen(registered[i]));
+	}
+
+	assert(find("login")->vtable == &command_login_vtable);
+	assert(find("logout")->vtable == &command_logout_vtable);
+
+	const char *unknown[] = {
+		"", "l", "lo", "logi", "loginx", "logoff", "logoutnow",
+		"jump", "quit", "a command name much longer than any other",
+	};
+
+	for (size_t i = 0; i < sizeof(unknown) / sizeof(char *); i++)
+		assert(find(unknown[i]) == NULL);
+
+	// the key keeps 16 bits of the length, this one has the key of join
+	size_t long_len = (1 << 16) + strlen("join");
+	char *long_name = calloc(long_len, sizeof(char));
+
+	assert(long_name);
+	memcpy(long_name, "join", strlen("join"));
+	assert(find_command((struct token) {
+		.ptr = long_name, .len = long_len }) == NULL);
+
+	free(long_name);
+
+	return EXIT_SUCCESS;
+}
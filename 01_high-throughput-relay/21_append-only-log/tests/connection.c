@@ -0,0 +1,196 @@
+#include "../src/connection.h"
+#include "../src/dynamic_dispatch.h"
+#include "../src/intern.h"
+#include "../src/output_sink.h"
+#include "../src/payload.h"
+#include "../src/wire_format.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void feed(struct connection *c, struct line_target *t, const char *data)
+{
+	assert(connection_feed(c, data, strlen(data), t));
+}
+
+static void test_chunks_of_any_size()
+{
+	const char stream[] = "/join general\n@alice hi\r\n\n/logout\nbye";
+	struct output_sink expected, actual;
+
+	sink_init(&expected, SINK_MEMORY, 16);
+	sink_literal(&expected, "Command: join\n  Arguments: [channel: general]\n"
+				"Direct message to alice: hi\n"
+				"Command: logout\n  Arguments: []\n"
+				"Global message: bye\n");
+
+	// the same output, however the stream is cut
+	for (size_t chunk = 1; chunk < sizeof(stream); chunk++) {
+		struct connection *c = connection_new(-1);
+		struct line_target t = { .buf = new_buffer() };
+
+		sink_init(&actual, SINK_MEMORY, 16);
+		t.out = &actual;
+
+		for (size_t i = 0; i < sizeof(stream) - 1; i += chunk) {
+			size_t len = sizeof(stream) - 1 - i;
+
+			if (len > chunk)
+				len = chunk;
+
+			assert(connection_feed(c, stream + i, len, &t));
+		}
+
+		connection_finish(c, &t);
+
+		assert(t.processed == 4);
+		assert(actual.len == expected.len);
+		assert(memcmp(actual.buf, expected.buf, actual.len) == 0);
+
+		sink_destroy(&actual);
+		destroy(t.buf);
+		connection_free(c);
+	}
+
+	sink_destroy(&expected);
+}
+
+static void test_only_partial_lines_are_copied()
+{
+	struct connection *c = connection_new(-1);
+	struct output_sink out;
+	struct line_target t = { .buf = new_buffer(), .out = &out };
+
+	sink_init(&out, SINK_MEMORY, 16);
+
+	feed(c, &t, "/join a\n/join b\n");
+	assert(c->partial == NULL && t.processed == 2);
+
+	feed(c, &t, "/join c\n/jo");
+	assert(c->partial_len == 3 && t.processed == 3);
+
+	feed(c, &t, "in d\n");
+	assert(c->partial_len == 0 && t.processed == 4);
+
+	sink_destroy(&out);
+	destroy(t.buf);
+	connection_free(c);
+}
+
+static void test_too_long_line()
+{
+	struct connection *c = connection_new(-1);
+	struct output_sink out;
+	struct line_target t = { .buf = new_buffer(), .out = &out };
+	char *chunk = malloc(CONNECTION_MAX_LINE / 2);
+
+	assert(chunk);
+	memset(chunk, 'x', CONNECTION_MAX_LINE / 2);
+	sink_init(&out, SINK_MEMORY, 16);
+
+	assert(connection_feed(c, chunk, CONNECTION_MAX_LINE / 2, &t));
+	assert(connection_feed(c, chunk, CONNECTION_MAX_LINE / 2, &t));
+	assert(!connection_feed(c, "x", 1, &t));
+
+	free(chunk);
+	sink_destroy(&out);
+	destroy(t.buf);
+	connection_free(c);
+}
+
+/* lines, and the frames of the same lines, in one stream */
+static void test_frames_of_any_size()
+{
+	const char *lines[] = {
+		"/login alice secret", "/join abcdefghij", "/logout",
+	};
+	struct output_sink stream, expected, actual;
+
+	sink_init(&stream, SINK_MEMORY, 16);
+	sink_init(&expected, SINK_MEMORY, 16);
+
+	for (size_t i = 0; i < 3; i++) {
+		struct payload p;
+
+		// a 10 byte name has a newline for length, frames ignore it
+		assert(parse_payload(&p, lines[i], strlen(lines[i]), NULL));
+		assert(encode_payload(&p, &stream));
+		sink_string(&stream, lines[i]);
+		sink_literal(&stream, "\n");
+
+		for (size_t copy = 0; copy < 2; copy++)
+			p.vtable->process(&p, &expected);
+
+		p.vtable->destroy(&p);
+	}
+
+	for (size_t chunk = 1; chunk <= stream.len; chunk++) {
+		struct connection *c = connection_new(-1);
+		struct line_target t = { .buf = new_buffer() };
+
+		sink_init(&actual, SINK_MEMORY, 16);
+		t.out = &actual;
+
+		for (size_t i = 0; i < stream.len; i += chunk) {
+			size_t len = stream.len - i;
+
+			if (len > chunk)
+				len = chunk;
+
+			assert(connection_feed(c, stream.buf + i, len, &t));
+		}
+
+		connection_finish(c, &t);
+
+		assert(t.processed == 6);
+		assert(actual.len == expected.len);
+		assert(memcmp(actual.buf, expected.buf, actual.len) == 0);
+
+		sink_destroy(&actual);
+		destroy(t.buf);
+		connection_free(c);
+	}
+
+	sink_destroy(&stream);
+	sink_destroy(&expected);
+}
+
+static void test_malformed_frame()
+{
+	struct connection *c = connection_new(-1);
+	struct output_sink out;
+	struct line_target t = { .buf = new_buffer(), .out = &out };
+
+	sink_init(&out, SINK_MEMORY, 16);
+
+	// a header cut at the end of a stream is dropped silently
+	assert(connection_feed(c, "\x03", 1, &t));
+	connection_finish(c, &t);
+	assert(t.processed == 0);
+
+	// a body length no varint has
+	assert(connection_feed(c, "\x04\x80\x80", 3, &t));
+	assert(!connection_feed(c, "\x80\x80\x80", 3, &t));
+
+	sink_destroy(&out);
+	destroy(t.buf);
+	connection_free(c);
+}
+
+int main()
+{
+	// as if alice had logged in, receivers of clients must be known
+	intern("alice", 5);
+
+	test_chunks_of_any_size();
+	test_only_partial_lines_are_copied();
+	test_too_long_line();
+	test_frames_of_any_size();
+	test_malformed_frame();
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include "../src/dynamic_dispatch.h"
+#include "../src/intern.h"
+#include "../src/output_sink.h"
+#include "../src/payload.h"
+#include "../src/payload_log.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* small, so that a few hundred payloads take several segments */
+#define SEGMENT_SIZE 4096
+
+#define PAYLOAD_COUNT 1000
+
+/* where each test keeps its segments */
+#define DIR_TEMPLATE "/tmp/payload_log_XXXXXX"
+
+static const char *lines[] = {
+	"/login alice secret",
+	"/join general",
+	"#general @bob hello there",
+	"everyone hears this",
+	"/logout",
+};
+
+#define LINE_COUNT (sizeof(lines) / sizeof(*lines))
+
+static void make_dir(char dir[sizeof(DIR_TEMPLATE)])
+{
+	strcpy(dir, DIR_TEMPLATE);
+	assert(mkdtemp(dir));
+}
+
+static void remove_dir(const char *dir)
+{
+	char path[PATH_MAX];
+
+	for (size_t i = 0;; i++) {
+		snprintf(path, sizeof(path), "%s/%08zu.log", dir, i);
+
+		if (unlink(path) == -1)
+			break;
+	}
+
+	assert(rmdir(dir) == 0);
+}
+
+/* appends payloads first to first + count of the cycle of lines */
+static void append_lines(struct payload_log *log, size_t first,
+			 size_t count)
+{
+	for (size_t i = first; i < first + count; i++) {
+		const char *line = lines[i % LINE_COUNT];
+		struct payload p;
+
+		assert(parse_payload(&p, line, strlen(line), NULL));
+		assert(payload_log_append(log, &p));
+		p.vtable->destroy(&p);
+
+		// a commit every few payloads, like rounds of a server
+		if (i % 7 == 0)
+			payload_log_commit(log);
+	}
+}
+
+/* replayed payloads are the lines, in order */
+static void check_replay(const char *dir, size_t count)
+{
+	struct payload_buffer *buf = new_buffer();
+	struct output_sink expected, actual;
+
+	sink_init(&expected, SINK_MEMORY, 16);
+	sink_init(&actual, SINK_MEMORY, 16);
+
+	assert(payload_log_replay(buf, dir) > 1);
+	assert(buf->len == count);
+
+	for (size_t i = 0; i < count; i++) {
+		const char *line = lines[i % LINE_COUNT];
+		struct payload p;
+
+		assert(parse_payload(&p, line, strlen(line), NULL));
+		p.vtable->process(&p, &expected);
+		p.vtable->destroy(&p);
+
+		process_next(buf, &actual);
+	}
+
+	assert(actual.len == expected.len);
+	assert(memcmp(actual.buf, expected.buf, actual.len) == 0);
+
+	sink_destroy(&expected);
+	sink_destroy(&actual);
+	destroy(buf);
+}
+
+static void test_append_and_replay()
+{
+	struct payload_log log;
+	char dir[sizeof(DIR_TEMPLATE)];
+
+	make_dir(dir);
+
+	assert(payload_log_open(&log, dir, SEGMENT_SIZE));
+	append_lines(&log, 0, PAYLOAD_COUNT);
+	assert(payload_log_close(&log));
+	check_replay(dir, PAYLOAD_COUNT);
+
+	// a second run goes on in segments of its own
+	assert(payload_log_open(&log, dir, SEGMENT_SIZE));
+	append_lines(&log, PAYLOAD_COUNT, PAYLOAD_COUNT);
+	assert(payload_log_close(&log));
+	check_replay(dir, 2 * PAYLOAD_COUNT);
+
+	remove_dir(dir);
+}
+
+static void test_one_sync_per_group()
+{
+	struct payload_log log;
+	char dir[sizeof(DIR_TEMPLATE)];
+
+	make_dir(dir);
+	assert(payload_log_open(&log, dir, PAYLOAD_LOG_SEGMENT_SIZE));
+
+	// however many payloads, one commit is one fdatasync()
+	for (size_t i = 0; i < PAYLOAD_COUNT; i++) {
+		const char *line = lines[i % LINE_COUNT];
+		struct payload p;
+
+		assert(parse_payload(&p, line, strlen(line), NULL));
+		assert(payload_log_append(&log, &p));
+		p.vtable->destroy(&p);
+	}
+
+	assert(payload_log_sync(&log));
+	assert(log.sync_count == 1);
+
+	// commits that arrive while a group is being synced share the next
+	// sync, at most one each
+	append_lines(&log, 0, PAYLOAD_COUNT);
+	assert(payload_log_sync(&log));
+	assert(log.sync_count <= 2 + PAYLOAD_COUNT / 7);
+
+	assert(payload_log_close(&log));
+	remove_dir(dir);
+}
+
+/* a batch cut short by a crash ends its segment, not the log */
+static void test_torn_batch()
+{
+	struct payload_log log;
+	char dir[sizeof(DIR_TEMPLATE)], path[PATH_MAX];
+
+	make_dir(dir);
+
+	assert(payload_log_open(&log, dir, SEGMENT_SIZE));
+	append_lines(&log, 0, PAYLOAD_COUNT);
+	assert(payload_log_close(&log));
+
+	struct payload_buffer *buf = new_buffer();
+	size_t segments = payload_log_replay(buf, dir);
+	size_t before = buf->len;
+
+	destroy(buf);
+
+	// the last byte of the first batch of the first segment
+	struct log_batch batch;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%08zu.log", dir, (size_t) 0);
+	assert((fd = open(path, O_RDWR)) != -1);
+	assert(pread(fd, &batch, sizeof(batch), 0) == sizeof(batch));
+	assert(pwrite(fd, "\xff", 1, sizeof(batch) + batch.len - 1) == 1);
+	close(fd);
+
+	buf = new_buffer();
+	assert(payload_log_replay(buf, dir) == segments);
+	assert(buf->len > 0 && buf->len < before);
+	destroy(buf);
+
+	remove_dir(dir);
+}
+
+int main()
+{
+	test_append_and_replay();
+	test_one_sync_per_group();
+	test_torn_batch();
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include "../src/session_table.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+
+#define USERS 20000
+#define CHURN 200000
+
+/* number of sessions of a user, and whether fd is one of them */
+static size_t sessions_of(const struct session_table *t, uint32_t user,
+			  int fd, bool *has_fd)
+{
+	size_t count = 0;
+
+	*has_fd = false;
+
+	for (size_t i = session_find(t, user); i != SESSION_NONE;
+	     i = session_find_next(t, i)) {
+		assert(t->slots[i].user == user);
+		*has_fd |= t->slots[i].fd == fd;
+		count++;
+	}
+
+	return count;
+}
+
+static void test_login_and_logout()
+{
+	struct session_table t;
+	bool has_fd;
+
+	session_table_init(&t, 0);
+	assert(session_find(&t, 1) == SESSION_NONE);
+
+	// one user, from two connections
+	session_login(&t, 1, 10);
+	session_login(&t, 1, 11);
+	session_login(&t, 2, 12);
+
+	assert(sessions_of(&t, 1, 11, &has_fd) == 2 && has_fd);
+	assert(sessions_of(&t, 2, 12, &has_fd) == 1 && has_fd);
+
+	assert(session_logout(&t, 1, 10));
+	assert(!session_logout(&t, 1, 10));
+	assert(!session_logout(&t, 2, 11));
+
+	assert(sessions_of(&t, 1, 10, &has_fd) == 1 && !has_fd);
+	assert(t.len == 2);
+
+	session_table_destroy(&t);
+}
+
+/* a table that grows many times, then logins and logouts at random */
+static void test_churn()
+{
+	struct session_table t;
+	int *fd = malloc(sizeof(int) * USERS);
+	bool has_fd;
+
+	assert(fd);
+	session_table_init(&t, 0);
+
+	for (uint32_t user = 0; user < USERS; user++) {
+		fd[user] = user;
+		session_login(&t, user, fd[user]);
+	}
+
+	srand(7);
+
+	// a user logs out, and back in from another connection
+	for (int i = 0; i < CHURN; i++) {
+		uint32_t user = rand() % USERS;
+
+		assert(session_logout(&t, user, fd[user]));
+		fd[user] = USERS + i;
+		session_login(&t, user, fd[user]);
+	}
+
+	assert(t.len == USERS);
+
+	for (uint32_t user = 0; user < USERS; user++)
+		assert(sessions_of(&t, user, fd[user], &has_fd) == 1 &&
+		       has_fd);
+
+	for (uint32_t user = 0; user < USERS; user += 2)
+		assert(session_logout(&t, user, fd[user]));
+
+	for (uint32_t user = 0; user < USERS; user++)
+		assert(sessions_of(&t, user, fd[user], &has_fd) == user % 2);
+
+	free(fd);
+	session_table_destroy(&t);
+}
+
+static void test_presized()
+{
+	struct session_table t;
+
+	session_table_init(&t, 1000000);
+
+	size_t slot_count = t.mask + 1;
+
+	for (uint32_t user = 0; user < 1000000; user++)
+		session_login(&t, user, 3);
+
+	// no rehash on the way
+	assert(t.mask + 1 == slot_count);
+
+	session_table_destroy(&t);
+}
+
+int main()
+{
+	test_login_and_logout();
+	test_churn();
+	test_presized();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,722 @@
+#include "../src/connection.h"
+#include "../src/dynamic_dispatch.h"
+#include "../src/intern.h"
+#include "../src/output_sink.h"
+#include "../src/payload.h"
+#include "../src/payload_log.h"
+#include "../src/tcp_client.h"
+#include "../src/tcp_server.h"
+#include "../src/wire_format.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+#define CLIENT_COUNT 300
+
+/* clients of test_order_per_sender(), and lines each of them sends */
+#define SENDERS 10
+#define ORDERED_LINES 300
+
+/* worker threads of the servers, every test runs with each count */
+static size_t threads;
+
+/* longer than a read of either backend */
+#define LONG_LINE 50000
+
+static size_t count_occurrences(const struct output_sink *out,
+				const char *needle)
+{
+	size_t count = 0;
+	size_t len = strlen(needle);
+
+	for (size_t i = 0; i + len <= out->len; i++)
+		if (memcmp(out->buf + i, needle, len) == 0)
+			count++;
+
+	return count;
+}
+
+/* a client is closed after its socket is drained, nothing is left then */
+static void poll_until_closed(struct tcp_server *server,
+			      struct output_sink *out)
+{
+	do
+		tcp_server_poll(server, out, 100);
+	while (server->connection_count > 0);
+}
+
+static void test_many_clients(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+	int clients[CLIENT_COUNT];
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+
+	for (int i = 0; i < CLIENT_COUNT; i++) {
+		char line[64];
+
+		assert((clients[i] = tcp_connect("127.0.0.1", port)) != -1);
+		assert(send_all(clients[i], line,
+				sprintf(line, "/join channel%d\n", i)));
+	}
+
+	// every client is open, and each of them has sent a line
+	while (server.payload_count < CLIENT_COUNT)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(server.connection_count == CLIENT_COUNT);
+
+	// the last line has no newline, it ends with the connection
+	for (int i = 0; i < CLIENT_COUNT; i++) {
+		assert(send_all(clients[i], "@alice hi\r\nbye", 14));
+		close(clients[i]);
+	}
+
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 3 * CLIENT_COUNT);
+	assert(count_occurrences(&out, "Command: join") == CLIENT_COUNT);
+	assert(count_occurrences(&out, "Direct message to alice: hi\n") ==
+	       CLIENT_COUNT);
+	assert(count_occurrences(&out, "Global message: bye\n") ==
+	       CLIENT_COUNT);
+
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+static void test_split_lines(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	int client = tcp_connect("127.0.0.1", tcp_server_port(&server));
+	assert(client != -1);
+
+	// half a line is not a payload yet
+	assert(send_all(client, "/login alice pa", 15));
+	while (server.connection_count == 0)
+		tcp_server_poll(&server, &out, 100);
+	tcp_server_poll(&server, &out, 100);
+	assert(server.payload_count == 0);
+
+	assert(send_all(client, "ss\n\n/join gen", 13));
+	assert(send_all(client, "eral\n", 5));
+
+	// a line received in several chunks
+	char *long_line = malloc(LONG_LINE);
+	assert(long_line);
+
+	memset(long_line, 'x', LONG_LINE - 1);
+	long_line[LONG_LINE - 1] = '\n';
+	assert(send_all(client, long_line, LONG_LINE));
+	close(client);
+
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 3);
+	assert(count_occurrences(&out, "[username: alice, password pass]") ==
+	       1);
+	assert(count_occurrences(&out, "[channel: general]") == 1);
+	assert(count_occurrences(&out, "Global message: xxx") == 1);
+
+	free(long_line);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+static void test_too_long_line(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	int client = tcp_connect("127.0.0.1", tcp_server_port(&server));
+	char *line = malloc(CONNECTION_MAX_LINE + 1);
+
+	assert(client != -1 && line);
+	memset(line, 'x', CONNECTION_MAX_LINE + 1);
+
+	// the server drops the client instead of buffering forever
+	send_all(client, line, CONNECTION_MAX_LINE + 1);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 0);
+
+	close(client);
+	free(line);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* bytes a client received so far, without waiting */
+static size_t receive_now(int fd, char *buf, size_t cap)
+{
+	ssize_t n = recv(fd, buf, cap - 1, MSG_DONTWAIT);
+
+	n = n > 0 ? n : 0;
+	buf[n] = '\0';
+
+	return n;
+}
+
+static void test_group_messages(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+	int alice, bob, carol;
+	char received[256];
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+
+	assert((alice = tcp_connect("127.0.0.1", port)) != -1);
+	assert((bob = tcp_connect("127.0.0.1", port)) != -1);
+	assert((carol = tcp_connect("127.0.0.1", port)) != -1);
+
+	// joining twice changes nothing
+	assert(send_all(alice, "/join general\n/join general\n", 28));
+	assert(send_all(bob, "/join general\n", 14));
+	assert(send_all(carol, "/join random\n", 13));
+	while (server.payload_count < 4)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(send_all(carol, "#general #random hi\n", 20));
+	while (server.payload_count < 5)
+		tcp_server_poll(&server, &out, 100);
+
+	// sent before the server returns, loopback delivers at once
+	const char general[] = "Group message to general: hi\n";
+	const char random[] = "Group message to random: hi\n";
+
+	assert(receive_now(alice, received, sizeof(received)) ==
+	       sizeof(general) - 1);
+	assert(strcmp(received, general) == 0);
+	assert(receive_now(bob, received, sizeof(received)) ==
+	       sizeof(general) - 1);
+	assert(strcmp(received, general) == 0);
+	assert(receive_now(carol, received, sizeof(received)) ==
+	       sizeof(random) - 1);
+	assert(strcmp(received, random) == 0);
+
+	// a closed client leaves its channels
+	close(bob);
+	while (server.connection_count > 2)
+		tcp_server_poll(&server, &out, 100);
+
+	size_t count;
+	channel_members(&server.relay.channels, intern("general", 7), &count);
+	assert(count == 1);
+
+	close(alice);
+	close(carol);
+	poll_until_closed(&server, &out);
+
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+static void test_direct_messages(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+	int alice_home, alice_phone, bob;
+	char received[256];
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+
+	assert((alice_home = tcp_connect("127.0.0.1", port)) != -1);
+	assert((alice_phone = tcp_connect("127.0.0.1", port)) != -1);
+	assert((bob = tcp_connect("127.0.0.1", port)) != -1);
+
+	assert(send_all(alice_home, "/login alice a\n", 15));
+	assert(send_all(alice_phone, "/login alice a\n", 15));
+	assert(send_all(bob, "/login bob b\n@alice hi\n", 23));
+	while (server.payload_count < 4)
+		tcp_server_poll(&server, &out, 100);
+
+	const char hi[] = "Direct message to alice: hi\n";
+
+	assert(receive_now(alice_home, received, sizeof(received)) ==
+	       sizeof(hi) - 1);
+	assert(strcmp(received, hi) == 0);
+	assert(receive_now(alice_phone, received, sizeof(received)) ==
+	       sizeof(hi) - 1);
+	assert(receive_now(bob, received, sizeof(received)) == 0);
+
+	// the phone logs out, then logs in as bob
+	assert(send_all(alice_phone, "/logout\n@alice @bob yo\n", 23));
+	while (server.payload_count < 6)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(receive_now(alice_home, received, sizeof(received)) > 0);
+	assert(receive_now(alice_phone, received, sizeof(received)) == 0);
+	assert(strcmp(received, "") == 0);
+	assert(receive_now(bob, received, sizeof(received)) > 0);
+	assert(strcmp(received, "Direct message to bob: yo\n") == 0);
+
+	assert(send_all(alice_phone, "/login bob b\n", 13));
+	close(alice_home);
+	while (server.payload_count < 7 || server.connection_count > 2)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(session_find(&server.relay.sessions, intern("alice", 5)) ==
+	       SESSION_NONE);
+	assert(server.relay.sessions.len == 2);
+
+	close(alice_phone);
+	close(bob);
+	poll_until_closed(&server, &out);
+
+	assert(server.relay.sessions.len == 0);
+
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* appends the frame of a line, as a binary client sends it */
+static void encode_line(struct output_sink *frames, const char *line)
+{
+	struct payload p;
+
+	assert(parse_payload(&p, line, strlen(line), NULL));
+	assert(encode_payload(&p, frames));
+	p.vtable->destroy(&p);
+}
+
+/* text and binary clients, in one server */
+static void test_binary_clients(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out, frames;
+	int alice, bob;
+	char received[256];
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+	sink_init(&frames, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+
+	assert((alice = tcp_connect("127.0.0.1", port)) != -1);
+	assert((bob = tcp_connect("127.0.0.1", port)) != -1);
+
+	encode_line(&frames, "/login bob b");
+	encode_line(&frames, "/join general");
+	encode_line(&frames, "@alice hi from bob");
+
+	assert(send_all(alice, "/login alice a\n", 15));
+	while (server.payload_count < 1)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(send_all(bob, frames.buf, frames.len));
+	while (server.payload_count < 4)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(send_all(alice, "#general hi from alice\n", 23));
+	while (server.payload_count < 5)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(receive_now(alice, received, sizeof(received)) > 0);
+	assert(strcmp(received, "Direct message to alice: hi from bob\n") == 0);
+	assert(receive_now(bob, received, sizeof(received)) > 0);
+	assert(strcmp(received, "Group message to general: hi from alice\n") ==
+	       0);
+
+	// the output does not tell them apart
+	assert(count_occurrences(&out, "Command: login") == 2);
+	assert(count_occurrences(&out, "Command: join") == 1);
+
+	close(alice);
+	close(bob);
+	poll_until_closed(&server, &out);
+
+	sink_destroy(&frames);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* what the server received is what the log replays */
+static void test_logged_payloads(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct payload_log log;
+	struct output_sink out;
+	char dir[] = "/tmp/tcp_server_log_XXXXXX";
+	int client;
+
+	assert(mkdtemp(dir));
+	assert(payload_log_open(&log, dir, PAYLOAD_LOG_SEGMENT_SIZE));
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+	server.log = &log;
+
+	assert((client = tcp_connect("127.0.0.1", tcp_server_port(&server))) !=
+	       -1);
+	assert(send_all(client, "/join general\n#general hi\n/logout", 33));
+	close(client);
+	poll_until_closed(&server, &out);
+	tcp_server_close(&server);
+
+	assert(payload_log_close(&log));
+
+	struct payload_buffer *buf = new_buffer();
+	struct output_sink replayed;
+
+	sink_init(&replayed, SINK_MEMORY, 16);
+	assert(payload_log_replay(buf, dir) == 1);
+	assert(buf->len == 3);
+
+	while (buf->process_base < buf->len)
+		process_next(buf, &replayed);
+
+	assert(replayed.len == out.len);
+	assert(memcmp(replayed.buf, out.buf, out.len) == 0);
+
+	char path[sizeof(dir) + 16];
+
+	snprintf(path, sizeof(path), "%s/%08d.log", dir, 0);
+	assert(unlink(path) == 0 && rmdir(dir) == 0);
+
+	sink_destroy(&replayed);
+	destroy(buf);
+	sink_destroy(&out);
+}
+
+/* appends what a client received so far, without waiting */
+static void receive_into(int fd, struct output_sink *received)
+{
+	char chunk[4096];
+	ssize_t n;
+
+	while ((n = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT)) > 0)
+		sink_write(received, chunk, n);
+}
+
+/* lines of one sender reach the reader in the order they were sent */
+static void test_order_per_sender(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out, received;
+	int reader, senders[SENDERS];
+	int next[SENDERS] = { 0 };
+	char line[64];
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+	sink_init(&received, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+
+	assert((reader = tcp_connect("127.0.0.1", port)) != -1);
+	assert(send_all(reader, "/login reader r\n", 16));
+	while (server.payload_count < 1)
+		tcp_server_poll(&server, &out, 100);
+
+	for (int i = 0; i < SENDERS; i++)
+		assert((senders[i] = tcp_connect("127.0.0.1", port)) != -1);
+
+	// interleaved, so that rounds have lines of several senders
+	for (int n = 0; n < ORDERED_LINES; n++) {
+		for (int i = 0; i < SENDERS; i++)
+			assert(send_all(senders[i], line,
+					sprintf(line, "@reader %d %d\n", i, n)));
+
+		tcp_server_poll(&server, &out, 0);
+		receive_into(reader, &received);
+	}
+
+	while (server.payload_count < 1 + SENDERS * ORDERED_LINES) {
+		tcp_server_poll(&server, &out, 100);
+		receive_into(reader, &received);
+	}
+
+	// null-terminated, to be read line by line
+	sink_write(&received, "", 1);
+
+	for (char *l = received.buf; *l; l = strchr(l, '\n') + 1) {
+		int i, n;
+
+		assert(sscanf(l, "Direct message to reader: %d %d", &i, &n) ==
+		       2);
+		assert(i >= 0 && i < SENDERS && n == next[i]);
+		next[i]++;
+	}
+
+	for (int i = 0; i < SENDERS; i++) {
+		assert(next[i] == ORDERED_LINES);
+		close(senders[i]);
+	}
+
+	close(reader);
+	poll_until_closed(&server, &out);
+
+	sink_destroy(&received);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* a member that never reads is disconnected, not waited for */
+static void test_slow_member(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+	int sender, member;
+	int small = 4096;
+	char line[1024];
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+
+	assert((member = tcp_connect("127.0.0.1", port)) != -1);
+	setsockopt(member, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+	assert((sender = tcp_connect("127.0.0.1", port)) != -1);
+
+	assert(send_all(member, "/join flood\n", 12));
+	while (server.payload_count < 1)
+		tcp_server_poll(&server, &out, 100);
+
+	memset(line, 'x', sizeof(line));
+	memcpy(line, "#flood ", 7);
+	line[sizeof(line) - 1] = '\n';
+
+	while (server.connection_count == 2) {
+		assert(send_all(sender, line, sizeof(line)));
+		tcp_server_poll(&server, &out, 0);
+	}
+
+	close(member);
+	close(sender);
+	poll_until_closed(&server, &out);
+
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* output reaches a file descriptor, with io_uring through write requests */
+static void test_output_written(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+	int pipe_fds[2];
+	char written[256];
+
+	assert(pipe(pipe_fds) == 0);
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, pipe_fds[1], 64);
+
+	int client = tcp_connect("127.0.0.1", tcp_server_port(&server));
+	assert(client != -1);
+
+	assert(send_all(client, "/join general\n", 14));
+	while (server.payload_count < 1)
+		tcp_server_poll(&server, &out, 100);
+
+	assert(send_all(client, "/logout\n", 8));
+	close(client);
+	poll_until_closed(&server, &out);
+
+	// the last output is written by close at the latest
+	tcp_server_close(&server);
+	sink_destroy(&out);
+	close(pipe_fds[1]);
+
+	const char expected[] =
+		"Command: join\n  Arguments: [channel: general]\n"
+		"Command: logout\n  Arguments: []\n";
+	size_t len = 0;
+	ssize_t n;
+
+	while ((n = read(pipe_fds[0], written + len,
+			 sizeof(written) - len)) > 0)
+		len += n;
+
+	assert(len == sizeof(expected) - 1);
+	assert(memcmp(written, expected, len) == 0);
+
+	close(pipe_fds[0]);
+}
+
+/* lines no parser would accept, each alone on its line */
+static const char *malformed_lines[] = {
+	"/login onlyuser",
+	"/login alice ",
+	"/login",
+	"/join",
+	"/",
+	"/nosuchcommand",
+	"@alice",
+	"#general",
+	"@ hi",
+	"#general @bob",
+	"@nobody hi",   // receivers nobody logged in or joined as
+	"#nowhere hi",
+};
+
+#define MALFORMED_COUNT (sizeof(malformed_lines) / sizeof(*malformed_lines))
+
+static void test_malformed_lines(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	uint16_t port = tcp_server_port(&server);
+	int client = tcp_connect("127.0.0.1", port);
+	assert(client != -1);
+
+	// the client is ignored line by line, not the server taken down
+	for (size_t i = 0; i < MALFORMED_COUNT; i++) {
+		assert(send_all(client, malformed_lines[i],
+				strlen(malformed_lines[i])));
+		assert(send_all(client, "\n", 1));
+	}
+
+	assert(send_all(client, "/join general\n", 14));
+	close(client);
+
+	while (server.payload_count < 1)
+		tcp_server_poll(&server, &out, 100);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 1);
+
+	// and every other client is still served
+	client = tcp_connect("127.0.0.1", port);
+	assert(client != -1);
+	assert(send_all(client, "@alice hi\n", 10));
+	close(client);
+
+	while (server.payload_count < 2)
+		tcp_server_poll(&server, &out, 100);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == 2);
+	assert(count_occurrences(&out, "[channel: general]") == 1);
+	assert(count_occurrences(&out, "Direct message to alice: hi\n") == 1);
+	assert(interned_id("nobody", 6) == INTERN_NONE);
+
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+/* sends what the socket takes without blocking, returns how much */
+static size_t send_some(int fd, const char *data, size_t len)
+{
+	ssize_t n = send(fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+	return n > 0 ? (size_t) n : 0;
+}
+
+#define FLOOD_LINE "/join general\n"
+#define FLOOD_LINE_LEN (sizeof(FLOOD_LINE) - 1)
+#define FLOOD_LINES 50000
+
+static void test_flood_does_not_starve(const struct tcp_backend *backend)
+{
+	struct tcp_server server;
+	struct output_sink out;
+	size_t flood_len = FLOOD_LINES * FLOOD_LINE_LEN;
+	char *flood = malloc(flood_len);
+
+	assert(flood);
+	assert(tcp_server_open(&server, 0, backend, threads));
+	sink_init(&out, SINK_MEMORY, 16);
+
+	for (size_t i = 0; i < FLOOD_LINES; i++)
+		memcpy(flood + i * FLOOD_LINE_LEN, FLOOD_LINE, FLOOD_LINE_LEN);
+
+	uint16_t port = tcp_server_port(&server);
+	int flooder = tcp_connect("127.0.0.1", port);
+	int other = tcp_connect("127.0.0.1", port);
+
+	assert(flooder != -1 && other != -1);
+	while (server.connection_count < 2)
+		tcp_server_poll(&server, &out, 100);
+
+	// more than one turn of the flooder waits in its socket, and a single
+	// line in the other one
+	size_t sent = send_some(flooder, flood, flood_len);
+
+	assert(sent > CONNECTION_READ_BUDGET + FLOOD_LINE_LEN);
+	assert(send_all(other, "@bob hi\n", 8));
+
+	while (count_occurrences(&out, "Direct message to bob") == 0)
+		tcp_server_poll(&server, &out, 100);
+
+	// the other client did not wait for the flood to be read
+	assert(server.payload_count < sent / FLOOD_LINE_LEN + 1);
+
+	while (sent < flood_len) {
+		tcp_server_poll(&server, &out, 0);
+		sent += send_some(flooder, flood + sent, flood_len - sent);
+	}
+
+	close(flooder);
+	close(other);
+	poll_until_closed(&server, &out);
+
+	assert(server.payload_count == FLOOD_LINES + 1);
+	assert(count_occurrences(&out, "Command: join") == FLOOD_LINES);
+
+	free(flood);
+	sink_destroy(&out);
+	tcp_server_close(&server);
+}
+
+int main()
+{
+	// receivers of the messages below, as if they had logged in before
+	intern("alice", 5);
+	intern("bob", 3);
+
+	const struct tcp_backend *backends[] = {
+		&epoll_backend, &uring_backend,
+	};
+
+	// on the server's thread only, then with workers of their own
+	for (threads = 0; threads <= 3; threads += 3) {
+		for (size_t i = 0; i < sizeof(backends) / sizeof(*backends);
+		     i++) {
+			test_many_clients(backends[i]);
+			test_split_lines(backends[i]);
+			test_too_long_line(backends[i]);
+			test_malformed_lines(backends[i]);
+			test_output_written(backends[i]);
+			test_group_messages(backends[i]);
+			test_direct_messages(backends[i]);
+			test_binary_clients(backends[i]);
+			test_logged_payloads(backends[i]);
+			test_order_per_sender(backends[i]);
+			test_slow_member(backends[i]);
+			test_flood_does_not_starve(backends[i]);
+		}
+	}
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,193 @@
+#include "../src/arena.h"
+#include "../src/intern.h"
+#include "../src/output_sink.h"
+#include "../src/payload.h"
+#include "../src/wire_format.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void process(const struct payload *p, struct output_sink *out)
+{
+	out->len = 0;
+	p->vtable->process(p, out);
+}
+
+/* parsed from text and from its frame, a line prints the same */
+static void check_round_trip(const char *line, struct arena *arena)
+{
+	struct payload text, binary;
+	struct output_sink frame, expected, actual;
+
+	sink_init(&frame, SINK_MEMORY, 16);
+	sink_init(&expected, SINK_MEMORY, 16);
+	sink_init(&actual, SINK_MEMORY, 16);
+
+	assert(parse_payload(&text, line, strlen(line), arena));
+	assert(encode_payload(&text, &frame));
+	assert(is_wire_frame(frame.buf[0]));
+
+	// the header knows the whole length, and not before it is complete
+	assert(wire_frame_len(frame.buf, frame.len) == frame.len);
+	assert(wire_frame_len(frame.buf, 1) == 0);
+
+	assert(parse_payload_binary(&binary, frame.buf, frame.len, arena));
+	assert(binary.vtable == text.vtable);
+
+	process(&text, &expected);
+	process(&binary, &actual);
+	assert(actual.len == expected.len);
+	assert(memcmp(actual.buf, expected.buf, actual.len) == 0);
+
+	// frames go through parse_payload too
+	assert(parse_payload(&binary, frame.buf, frame.len, arena));
+	process(&binary, &actual);
+	assert(actual.len == expected.len);
+
+	// heap payloads are freed by their vtable
+	assert(parse_payload_binary(&binary, frame.buf, frame.len, NULL));
+	binary.vtable->destroy(&binary);
+
+	sink_destroy(&frame);
+	sink_destroy(&expected);
+	sink_destroy(&actual);
+}
+
+static void test_round_trip()
+{
+	struct arena arena;
+	char *long_line = malloc(20001);
+
+	assert(long_line);
+	arena_init(&arena, ARENA_CHUNK_SIZE);
+
+	const char *lines[] = {
+		"/login alice secret",
+		"/join general",
+		"/logout",
+		"hello everyone",
+		"@alice hi",
+		"#general @bob #random three receivers",
+		"@a #b c",
+	};
+
+	for (size_t i = 0; i < sizeof(lines) / sizeof(char *); i++)
+		check_round_trip(lines[i], &arena);
+
+	// bodies of two and three varint bytes
+	memset(long_line, 'x', 20000);
+	memcpy(long_line, "#general ", 9);
+
+	for (size_t len = 100; len <= 20000; len *= 10) {
+		long_line[len] = '\0';
+		check_round_trip(long_line, &arena);
+		long_line[len] = 'x';
+	}
+
+	free(long_line);
+	arena_destroy(&arena);
+}
+
+static bool decodes(const char *frame, size_t len)
+{
+	struct payload p;
+	struct arena arena;
+
+	arena_init(&arena, ARENA_CHUNK_SIZE);
+
+	bool is_valid = parse_payload_binary(&p, frame, len, &arena);
+
+	arena_destroy(&arena);
+
+	return is_valid;
+}
+
+static void test_malformed_frames()
+{
+	// never a 6 byte varint, even if the frame could be long enough
+	assert(wire_frame_len("\x04\x80\x80\x80\x80\x80", 6) ==
+	       WIRE_FRAME_INVALID);
+	assert(wire_frame_len("\x04\x80\x80\x80\x80", 5) == 0);
+	assert(wire_frame_len("\x04\xff\xff\xff\xff\x0f", 6) ==
+	       6 + (size_t) UINT32_MAX);
+	assert(wire_frame_len("\x04\xff\xff\xff\xff\x10", 6) ==
+	       WIRE_FRAME_INVALID);
+
+	assert(decodes("\x03\x00", 2));
+	assert(decodes("\x02\x02\x01g", 4));
+	assert(decodes("\x01\x04\x01" "a" "\x01" "b", 6));
+
+	// trailing bytes, or fields beyond the body
+	assert(!decodes("\x03\x01x", 3));
+	assert(!decodes("\x02\x03\x01gx", 5));
+	assert(!decodes("\x02\x02\x05g", 4));
+	assert(!decodes("\x01\x03\x01" "a" "\x01", 5));
+
+	// empty names and passwords
+	assert(!decodes("\x02\x01\x00", 3));
+	assert(!decodes("\x01\x03\x01" "a" "\x00", 5));
+	assert(!decodes("\x04\x04\x01\x01" "ab", 6));
+
+	// more receivers than the body could hold, or cut short
+	assert(!decodes("\x04\x03\x7f\x02" "a", 5));
+	assert(!decodes("\x04\x05\x02\x02" "a" "\x08" "b", 7));
+
+	// what no line could hold: a newline or a NUL in content, forging a
+	// line of its own or cut short by strlen()
+	assert(!decodes("\x04\x0a\x00" "hi\nforged", 12));
+	assert(!decodes("\x04\x04\x00" "a\0b", 6));
+	assert(!decodes("\x04\x05\x01\x02" "a" "b\n", 7));
+
+	// anywhere in longer content, which is checked a block at a time
+	char frame[3 + 40];
+	struct payload p;
+
+	memcpy(frame, "\x04\x29\x00", 3);
+	memset(frame + 3, 'x', 40);
+	assert(decodes(frame, sizeof(frame)));
+
+	for (size_t i = 3; i < sizeof(frame); i++) {
+		frame[i] = '\n';
+		assert(!decodes(frame, sizeof(frame)));
+		frame[i] = '\0';
+		assert(!decodes(frame, sizeof(frame)));
+		frame[i] = 'x';
+	}
+
+	// nothing is left behind on the heap either
+	frame[sizeof(frame) - 1] = '\n';
+	assert(!parse_payload_binary(&p, frame, sizeof(frame), NULL));
+
+	// spaces and control bytes in names and passwords
+	assert(!decodes("\x02\x04\x03" "a b", 6));
+	assert(!decodes("\x02\x04\x03" "a\nb", 6));
+	assert(!decodes("\x02\x02\x01" "\x7f", 4));
+	assert(!decodes("\x01\x05\x01" "a" "\x02" "b\0", 7));
+	assert(!decodes("\x01\x05\x02" "a\t" "\x01" "b", 7));
+	assert(!decodes("\x04\x07\x01\x06" "a b" "hi", 9));
+	assert(!decodes("\x04\x05\x01\x02" "\n" "hi", 7));
+
+	// a name may still hold what a token can, like @ and #
+	assert(decodes("\x04\x06\x01\x04" "@b" "hi", 8));
+
+	// and lines are held to the same names as frames
+	assert(!parse_payload(&p, "@a\tb hi", 7, NULL));
+	assert(!parse_payload(&p, "/join a\x01", 8, NULL));
+	assert(!parse_payload(&p, "/login alice se\x7f", 16, NULL));
+
+	// a message may be empty, or have no receiver
+	assert(decodes("\x04\x03\x01\x02" "a", 5));
+	assert(decodes("\x04\x01\x00", 3));
+}
+
+int main()
+{
+	test_round_trip();
+	test_malformed_frames();
+
+	intern_reset();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include "../src/worker_pool.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+
+#define KEYS 64
+#define TASKS_PER_KEY 2000
+#define THREADS 4
+
+struct numbered_task {
+	struct pool_task task;
+	int n;  /**< Position among the tasks of its key */
+};
+
+struct order_check {
+	int next[KEYS];     /**< Only touched by the worker running the key */
+	_Atomic int running[KEYS];
+	atomic_int ran_by_worker[THREADS + 1];
+};
+
+static void check_order(struct pool_task *task, size_t worker, void *ctx)
+{
+	struct numbered_task *t = (struct numbered_task *) task;
+	struct order_check *check = ctx;
+
+	// never two tasks of the same key at once
+	assert(atomic_fetch_add(&check->running[t->task.key], 1) == 0);
+
+	assert(t->n == check->next[t->task.key]);
+	check->next[t->task.key]++;
+	atomic_fetch_add(&check->ran_by_worker[worker], 1);
+
+	atomic_fetch_sub(&check->running[t->task.key], 1);
+}
+
+static void test_order_within_key(size_t threads)
+{
+	struct worker_pool pool;
+	struct order_check check = { 0 };
+	struct numbered_task *tasks =
+		malloc(sizeof(struct numbered_task) * KEYS * TASKS_PER_KEY);
+
+	assert(tasks);
+	worker_pool_init(&pool, threads, check_order, &check);
+
+	// keys interleaved, as lines of many clients would be
+	for (int n = 0; n < TASKS_PER_KEY; n++) {
+		for (int key = 0; key < KEYS; key++) {
+			struct numbered_task *t = &tasks[n * KEYS + key];
+
+			*t = (struct numbered_task) {
+				.task.key = key,
+				.n = n,
+			};
+			worker_pool_submit(&pool, &t->task);
+		}
+
+		if (n % 500 == 0)
+			worker_pool_wait(&pool);
+	}
+
+	worker_pool_wait(&pool);
+
+	int total = 0;
+
+	for (int key = 0; key < KEYS; key++)
+		assert(check.next[key] == TASKS_PER_KEY);
+
+	for (size_t i = 0; i <= threads; i++)
+		total += check.ran_by_worker[i];
+
+	assert(total == KEYS * TASKS_PER_KEY);
+
+	worker_pool_destroy(&pool);
+	free(tasks);
+}
+
+/* every key's home is worker 0, the others only run what they steal */
+static void test_stealing()
+{
+	struct worker_pool pool;
+	struct order_check check = { 0 };
+	struct numbered_task *tasks =
+		malloc(sizeof(struct numbered_task) * KEYS * TASKS_PER_KEY);
+
+	assert(tasks);
+	worker_pool_init(&pool, THREADS, check_order, &check);
+
+	for (int n = 0; n < TASKS_PER_KEY; n++) {
+		for (int key = 0; key < KEYS; key += THREADS + 1) {
+			struct numbered_task *t = &tasks[n * KEYS + key];
+
+			*t = (struct numbered_task) {
+				.task.key = key,
+				.n = n,
+			};
+			worker_pool_submit(&pool, &t->task);
+		}
+	}
+
+	worker_pool_wait(&pool);
+
+	for (int key = 0; key < KEYS; key += THREADS + 1)
+		assert(check.next[key] == TASKS_PER_KEY);
+
+	worker_pool_destroy(&pool);
+	free(tasks);
+}
+
+int main()
+{
+	test_order_within_key(0);
+	test_order_within_key(1);
+	test_order_within_key(THREADS);
+	test_stealing();
+
+	return EXIT_SUCCESS;
+}